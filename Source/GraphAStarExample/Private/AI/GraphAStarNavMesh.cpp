@@ -3,7 +3,16 @@
 
 #include "GraphAStarNavMesh.h"
 #include "HexGrid/HexGrid.h"
+#include "HexGrid/HexGridQueryLibrary.h"
+#include "HexPathQueryCapture.h"
+#include "HexParallelSearch.h"
+#include "HexDeterministicSearch.h"
 #include "AIModule/Public/GraphAStar.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeRWLock.h"
+#include "HAL/FileManager.h"
+#include "Algo/Reverse.h"
 
 DEFINE_LOG_CATEGORY(LogGraphAStarExample_NavMesh)
 
@@ -13,6 +22,19 @@ DEFINE_LOG_CATEGORY(LogGraphAStarExample_NavMesh)
 // Remember, if the HexGrid is a nullptr we will never use this code
 // but we fallback to the RecastNavMesh implementation of it.
 
+FGridPathFilter::FGridPathFilter(const AGraphAStarNavMesh &InNavMeshRef, const FHexCompiledFilterProfile *InProfile, const AHexGrid *InGrid)
+	: NavMeshRef(InNavMeshRef), Grid(InGrid ? *InGrid : *InNavMeshRef.HexGrid), Profile(InProfile)
+{
+	// The occupancy grid only tracks the agents on the HexGrid
+	CongestionWeight = &Grid == InNavMeshRef.HexGrid ? InNavMeshRef.CongestionCostWeight : 0.f;
+}
+
+FGridPathFilter::FGridPathFilter(const AGraphAStarNavMesh &InNavMeshRef, const FHexCompiledFilterProfilePtr &InProfile, const AHexGrid *InGrid)
+	: FGridPathFilter(InNavMeshRef, InProfile.Get(), InGrid)
+{
+	PinnedProfile = InProfile;
+}
+
 float FGridPathFilter::GetHeuristicScale() const
 {
 	// For the sake of simplicity we just return 1.f
@@ -21,17 +43,35 @@ float FGridPathFilter::GetHeuristicScale() const
 
 float FGridPathFilter::GetHeuristicCost(const int32 StartNodeRef, const int32 EndNodeRef) const
 {
-	return GetTraversalCost(StartNodeRef, EndNodeRef);
+	// Only the tile, a portal between the two would make it overestimate other paths
+	return GetTileCost(EndNodeRef);
 }
 
 float FGridPathFilter::GetTraversalCost(const int32 StartNodeRef, const int32 EndNodeRef) const
 {
-	// If EndNodeRef is a valid index of the GridTiles array we return the tile cost, 
+	const float TileCost{ GetTileCost(EndNodeRef) };
+
+	// Not a neighbour, so we are going through a portal and we pay for it too
+	if (Grid.HasPortals() && Grid.HasTileData(StartNodeRef) && Grid.HasTileData(EndNodeRef)
+		&& FHPackedCoord::Distance(Grid.GetPackedCoord(StartNodeRef), Grid.GetPackedCoord(EndNodeRef)) != 1)
+	{
+		return TileCost + FMath::Max(Grid.FindPortalCost(StartNodeRef, EndNodeRef), 0.f);
+	}
+	return TileCost;
+}
+
+float FGridPathFilter::GetTileCost(const int32 TileIndex) const
+{
+	// If TileIndex is a tile with tile data we return the tile cost,
 	// if not we return 1 because the traversal cost need to be > 0 or the FGraphAStar will stop the execution
 	// look at GraphAStar.h line 244: ensure(NewTraversalCost > 0);
-	if (NavMeshRef.HexGrid->GridTiles.IsValidIndex(EndNodeRef))
+	if (Grid.HasTileData(TileIndex))
 	{
-		return NavMeshRef.HexGrid->GridTiles[EndNodeRef].Cost;
+		// The profile already baked the multipliers into a per tile cost, the blend the cost layers too
+		const float TileCost{ BlendedCostData ? BlendedCostData[TileIndex] : Profile ? Profile->TileCosts[TileIndex] : Grid.GetTileCost(TileIndex) };
+
+		// Agents on the tile make it more expensive, a single atomic read
+		return CongestionWeight > 0.f ? TileCost + CongestionWeight * NavMeshRef.GetTileOccupancy(TileIndex) : TileCost;
 	}
 	else
 	{
@@ -41,13 +81,23 @@ float FGridPathFilter::GetTraversalCost(const int32 StartNodeRef, const int32 En
 
 bool FGridPathFilter::IsTraversalAllowed(const int32 NodeA, const int32 NodeB) const
 {
-	// If NodeB is a valid index of the GridTiles array we return bIsBlocking, 
+	// If NodeB is a tile with tile data we return bIsBlocking,
 	// if not we assume we can traverse so we return true.
 	// Here you can make a more complex operation like use a line trace to see
 	// there is some obstacles (like an enemy), in our example we just use a simple implementation
-	if (NavMeshRef.HexGrid->GridTiles.IsValidIndex(NodeB))
+	if (Grid.HasTileData(NodeB))
 	{
-		return !NavMeshRef.HexGrid->GridTiles[NodeB].bIsBlocking;
+		// Agents bigger than a tile need room around it too, the clearance field tells it with a single read
+		if (FootprintRadius > 0 && Grid.GetTileClearance(NodeB) <= FootprintRadius)
+		{
+			return false;
+		}
+
+		if (Profile)
+		{
+			return Profile->TileCosts[NodeB] != FHexCompiledFilterProfile::BlockedCost;
+		}
+		return !Grid.IsTileBlocking(NodeB);
 	}
 	else
 	{
@@ -61,9 +111,457 @@ bool FGridPathFilter::WantsPartialSolution() const
 	// Just return true
 	return true;
 }
+
+void FGridPathFilter::SetBlendedCosts(const TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> &InBlendedCosts)
+{
+	// A blend built for an older version of the grid could be shorter, the tiles are better than a wrong read
+	if (InBlendedCosts.IsValid() && InBlendedCosts->Num() == Grid.GetNumTileData())
+	{
+		BlendedCosts = InBlendedCosts;
+		BlendedCostData = BlendedCosts->GetData();
+	}
+	else
+	{
+		BlendedCosts.Reset();
+		BlendedCostData = nullptr;
+	}
+}
 //==== END OF FGridPathFilter functions implementation ====
 
 
+//==== Filter profiles ====
+
+void FHexCompiledFilterProfile::CompileTile(const AHexGrid &Grid, const int32 TileIndex)
+{
+	const uint8 TileClass{ Grid.GetTileClass(TileIndex) };
+	const EHexTileTraversal Traversal{ Traversals[TileClass] };
+	const bool bBlocked{ (Traversal == EHexTileTraversal::Blocked) || (Traversal == EHexTileTraversal::Default && Grid.IsTileBlocking(TileIndex)) };
+
+	// FGraphAStar wants a traversal cost > 0
+	TileCosts[TileIndex] = bBlocked ? BlockedCost : FMath::Max(Grid.GetTileCost(TileIndex) * Multipliers[TileClass], KINDA_SMALL_NUMBER);
+}
+
+void AGraphAStarNavMesh::RebuildFilterProfiles()
+{
+	for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+	{
+		RebuildFilterProfiles(*NavGrid);
+	}
+}
+
+void AGraphAStarNavMesh::RebuildFilterProfiles(FHexNavGrid &NavGrid)
+{
+	AHexGrid *Grid{ NavGrid.Grid };
+
+	// Built aside, running queries keep the profiles they pinned
+	TArray<FHexCompiledFilterProfilePtr> Profiles;
+	Profiles.Reserve(FilterProfiles.Num());
+
+	for (const FHexFilterProfile &FilterProfile : FilterProfiles)
+	{
+		const TSharedRef<FHexCompiledFilterProfile, ESPMode::ThreadSafe> CompiledRef{ MakeShared<FHexCompiledFilterProfile, ESPMode::ThreadSafe>() };
+		FHexCompiledFilterProfile &Compiled{ *CompiledRef };
+		Compiled.Name = FilterProfile.Name;
+		Compiled.FilterClass = FilterProfile.FilterClass;
+		Compiled.CostBlend->Weights = FilterProfile.CostLayerWeights;
+
+		// First a lookup table with an entry for each possible TileClass...
+		for (int32 TileClass{ 0 }; TileClass < 256; ++TileClass)
+		{
+			Compiled.Multipliers[TileClass] = 1.f;
+			Compiled.Traversals[TileClass] = EHexTileTraversal::Default;
+		}
+		for (const FHexTileClassRule &Rule : FilterProfile.Rules)
+		{
+			Compiled.Multipliers[Rule.TileClass] = Rule.CostMultiplier;
+			Compiled.Traversals[Rule.TileClass] = Rule.Traversal;
+		}
+
+		// ...then the final cost of every tile, this is the only thing the pathfinder will read.
+		Compiled.TileCosts.SetNumUninitialized(Grid->GetNumTileData());
+		for (int32 TileIndex{ 0 }; TileIndex < Grid->GetNumTileData(); ++TileIndex)
+		{
+			Compiled.CompileTile(*Grid, TileIndex);
+		}
+
+		FGridPathFilter StaticFilter(*this, &Compiled, Grid);
+		StaticFilter.CongestionWeight = 0.f;
+		Compiled.JumpPointData.Build(*Grid, StaticFilter);
+		Profiles.Add(CompiledRef);
+	}
+
+	const TSharedRef<FHexJumpPointData, ESPMode::ThreadSafe> DefaultJumpPointData{ MakeShared<FHexJumpPointData, ESPMode::ThreadSafe>() };
+	FGridPathFilter StaticFilter(*this, nullptr, Grid);
+	StaticFilter.CongestionWeight = 0.f;
+	DefaultJumpPointData->Build(*Grid, StaticFilter);
+
+	SwapCompiledData(NavGrid, MoveTemp(Profiles), DefaultJumpPointData);
+
+	// The compiled profiles are new, their blends are empty and the preview trees point to the old ones
+	UpdateCostBlends(NavGrid);
+	ClearPathPreviews();
+
+	// Load time preprocessing, the profiles have just been recompiled so their old hierarchies are gone anyway
+	if (bUseContractionHierarchy)
+	{
+		BuildContractionHierarchies(NavGrid);
+	}
+}
+
+void AGraphAStarNavMesh::SwapCompiledData(FHexNavGrid &NavGrid, TArray<FHexCompiledFilterProfilePtr> &&Profiles, TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> &&DefaultJumpPointData)
+{
+	// The old data is freed by the last query that pinned it, out of the lock
+	TArray<FHexCompiledFilterProfilePtr> OldProfiles;
+	TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> OldJumpPointData;
+	{
+		FScopeLock Lock(&CompiledDataLock);
+		OldProfiles = MoveTemp(NavGrid.CompiledFilterProfiles);
+		OldJumpPointData = MoveTemp(NavGrid.DefaultJumpPointData);
+		NavGrid.CompiledFilterProfiles = MoveTemp(Profiles);
+		NavGrid.DefaultJumpPointData = MoveTemp(DefaultJumpPointData);
+	}
+}
+
+TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> AGraphAStarNavMesh::GetJumpPointData(const FHexCompiledFilterProfilePtr &Profile) const
+{
+	return GetJumpPointData(*GetPrimaryNavGrid(), Profile);
+}
+
+TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> AGraphAStarNavMesh::GetJumpPointData(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfilePtr &Profile) const
+{
+	// The data of a profile lives as long as the profile
+	if (Profile)
+	{
+		return TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe>(Profile, &Profile->JumpPointData);
+	}
+
+	FScopeLock Lock(&CompiledDataLock);
+	return NavGrid.DefaultJumpPointData;
+}
+
+FHexCompiledFilterProfilePtr AGraphAStarNavMesh::FindFilterProfile(TSubclassOf<UNavigationQueryFilter> FilterClass) const
+{
+	const FHexNavGrid *NavGrid{ GetPrimaryNavGrid() };
+	return NavGrid ? FindFilterProfile(*NavGrid, FilterClass) : nullptr;
+}
+
+FHexCompiledFilterProfilePtr AGraphAStarNavMesh::FindFilterProfile(const FHexNavGrid &NavGrid, TSubclassOf<UNavigationQueryFilter> FilterClass) const
+{
+	if (!FilterClass)
+	{
+		return nullptr;
+	}
+
+	FHexCompiledFilterProfilePtr Compiled;
+	{
+		FScopeLock Lock(&CompiledDataLock);
+		if (const FHexCompiledFilterProfilePtr *Found{ NavGrid.CompiledFilterProfiles.FindByPredicate([&FilterClass](const FHexCompiledFilterProfilePtr &Profile)
+		{
+			return Profile->FilterClass == FilterClass;
+		}) })
+		{
+			Compiled = *Found;
+		}
+	}
+
+	return IsFilterProfileUpToDate(NavGrid, Compiled.Get()) ? Compiled : nullptr;
+}
+
+FHexCompiledFilterProfilePtr AGraphAStarNavMesh::FindFilterProfile(const FSharedConstNavQueryFilter &QueryFilter) const
+{
+	const FHexNavGrid *NavGrid{ GetPrimaryNavGrid() };
+	return NavGrid ? FindFilterProfile(*NavGrid, QueryFilter) : nullptr;
+}
+
+FHexCompiledFilterProfilePtr AGraphAStarNavMesh::FindFilterProfile(const FHexNavGrid &NavGrid, const FSharedConstNavQueryFilter &QueryFilter) const
+{
+	if (!QueryFilter.IsValid())
+	{
+		return nullptr;
+	}
+
+	// The query only carries the filter instance, the navigation data caches one instance for each filter class
+	// so we can match it against the classes of our profiles. This is done once per query, not per expansion.
+	FHexCompiledFilterProfilePtr Compiled;
+	{
+		FScopeLock Lock(&CompiledDataLock);
+		if (const FHexCompiledFilterProfilePtr *Found{ NavGrid.CompiledFilterProfiles.FindByPredicate([this, &QueryFilter](const FHexCompiledFilterProfilePtr &Profile)
+		{
+			return Profile->FilterClass && GetQueryFilter(Profile->FilterClass) == QueryFilter;
+		}) })
+		{
+			Compiled = *Found;
+		}
+	}
+
+	return IsFilterProfileUpToDate(NavGrid, Compiled.Get()) ? Compiled : nullptr;
+}
+
+bool AGraphAStarNavMesh::IsFilterProfileUpToDate(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfile *Compiled) const
+{
+	if (!Compiled)
+	{
+		return false;
+	}
+
+	// Tiles have been added or removed after the last RebuildFilterProfiles, better the default rules than a crash.
+	if (Compiled->TileCosts.Num() != NavGrid.Grid->GetNumTileData())
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("Filter profile %s is out of date, call RebuildFilterProfiles()"), *Compiled->Name.ToString());
+		return false;
+	}
+	return true;
+}
+
+void AGraphAStarNavMesh::UpdateCostBlends(FHexNavGrid &NavGrid)
+{
+	const AHexGrid &Grid{ *NavGrid.Grid };
+	const auto IsStale = [&Grid](const FHexCostBlend &Blend)
+	{
+		return Blend.Weights.Num() > 0 ? !Blend.Costs.IsValid() || Blend.LayersVersion != Grid.GetCostLayersVersion() || Blend.GridVersion != Grid.GetGridVersion()
+			: Blend.Costs.IsValid();
+	};
+
+	// The blend is shared by all the copies of a profile, only the game thread writes it
+	for (const FHexCompiledFilterProfilePtr &Compiled : NavGrid.CompiledFilterProfiles)
+	{
+		if (IsStale(*Compiled->CostBlend))
+		{
+			UpdateCostBlend(NavGrid, *Compiled->CostBlend, Compiled->TileCosts);
+		}
+	}
+
+	// The default weights are a property, they can change at any time
+	FHexCostBlend &DefaultBlend{ NavGrid.DefaultCostBlend };
+	bool bWeightsChanged{ DefaultBlend.Weights.Num() != DefaultCostLayerWeights.Num() };
+	for (int32 Index{ 0 }; !bWeightsChanged && Index < DefaultCostLayerWeights.Num(); ++Index)
+	{
+		bWeightsChanged = DefaultBlend.Weights[Index].Layer != DefaultCostLayerWeights[Index].Layer
+			|| DefaultBlend.Weights[Index].Weight != DefaultCostLayerWeights[Index].Weight;
+	}
+	if (bWeightsChanged)
+	{
+		DefaultBlend.Weights = DefaultCostLayerWeights;
+	}
+
+	if (bWeightsChanged || IsStale(DefaultBlend))
+	{
+		// Same costs of FGridPathFilter without a profile, blocked tiles get the blocked marker
+		TArray<float> BaseCosts;
+		BaseCosts.SetNumUninitialized(Grid.GetNumTileData());
+		for (int32 TileIndex{ 0 }; TileIndex < Grid.GetNumTileData(); ++TileIndex)
+		{
+			BaseCosts[TileIndex] = Grid.IsTileBlocking(TileIndex) ? FHexCompiledFilterProfile::BlockedCost : Grid.GetTileCost(TileIndex);
+		}
+		UpdateCostBlend(NavGrid, DefaultBlend, BaseCosts);
+	}
+}
+
+void AGraphAStarNavMesh::UpdateCostBlend(const FHexNavGrid &NavGrid, FHexCostBlend &Blend, TArrayView<const float> BaseCosts)
+{
+	TSharedPtr<TArray<float>, ESPMode::ThreadSafe> Costs;
+	if (Blend.Weights.Num() > 0)
+	{
+		Costs = MakeShared<TArray<float>, ESPMode::ThreadSafe>();
+		NavGrid.Grid->BlendCostLayers(Blend.Weights, BaseCosts, *Costs);
+	}
+
+	// Running queries keep the old snapshot
+	{
+		FScopeLock Lock(&CostBlendLock);
+		Blend.Costs = Costs;
+	}
+	Blend.LayersVersion = NavGrid.Grid->GetCostLayersVersion();
+	Blend.GridVersion = NavGrid.Grid->GetGridVersion();
+}
+
+TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> AGraphAStarNavMesh::GetBlendedCosts(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfile *Profile) const
+{
+	FScopeLock Lock(&CostBlendLock);
+	return Profile ? Profile->CostBlend->Costs : NavGrid.DefaultCostBlend.Costs;
+}
+//==== END OF Filter profiles ====
+
+
+//==== Contraction hierarchies ====
+
+void AGraphAStarNavMesh::BuildContractionHierarchies()
+{
+	for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+	{
+		BuildContractionHierarchies(*NavGrid);
+	}
+}
+
+void AGraphAStarNavMesh::BuildContractionHierarchies(FHexNavGrid &NavGrid)
+{
+	AHexGrid *Grid{ NavGrid.Grid };
+
+	// Static costs only, congestion changes every frame. The profiles are immutable, each one gets a new copy
+	TArray<FHexCompiledFilterProfilePtr> Profiles;
+	Profiles.Reserve(NavGrid.CompiledFilterProfiles.Num());
+	for (const FHexCompiledFilterProfilePtr &OldCompiled : NavGrid.CompiledFilterProfiles)
+	{
+		const TSharedRef<FHexCompiledFilterProfile, ESPMode::ThreadSafe> Compiled{ MakeShared<FHexCompiledFilterProfile, ESPMode::ThreadSafe>(*OldCompiled) };
+		FGridPathFilter StaticFilter(*this, &Compiled.Get(), Grid);
+		StaticFilter.CongestionWeight = 0.f;
+		Compiled->ContractionHierarchy = FHexContractionHierarchy::FindOrBuildShared(*Grid, StaticFilter);
+		Compiled->ContractionHierarchyVersion = Grid->GetGridVersion();
+		Profiles.Add(Compiled);
+	}
+
+	// Built once per process for each map and cost model, the other worlds on the same map get the same copy
+	FGridPathFilter StaticFilter(*this, nullptr, Grid);
+	StaticFilter.CongestionWeight = 0.f;
+	TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> DefaultHierarchy{ FHexContractionHierarchy::FindOrBuildShared(*Grid, StaticFilter) };
+
+	SwapCompiledData(NavGrid, MoveTemp(Profiles), CopyTemp(NavGrid.DefaultJumpPointData));
+	{
+		FScopeLock Lock(&CompiledDataLock);
+		NavGrid.DefaultContractionHierarchy = MoveTemp(DefaultHierarchy);
+		NavGrid.DefaultContractionHierarchyVersion = Grid->GetGridVersion();
+	}
+}
+
+TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> AGraphAStarNavMesh::GetContractionHierarchy(const FHexCompiledFilterProfilePtr &Profile) const
+{
+	const FHexNavGrid *NavGrid{ GetPrimaryNavGrid() };
+	return NavGrid ? GetContractionHierarchy(*NavGrid, Profile) : nullptr;
+}
+
+TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> AGraphAStarNavMesh::GetContractionHierarchy(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfilePtr &Profile) const
+{
+	TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Hierarchy;
+	int32 BuiltGridVersion{ INDEX_NONE };
+	if (Profile)
+	{
+		Hierarchy = Profile->ContractionHierarchy;
+		BuiltGridVersion = Profile->ContractionHierarchyVersion;
+	}
+	else
+	{
+		FScopeLock Lock(&CompiledDataLock);
+		Hierarchy = NavGrid.DefaultContractionHierarchy;
+		BuiltGridVersion = NavGrid.DefaultContractionHierarchyVersion;
+	}
+
+	// Built for an older version of the grid, the caller falls back to the regular search
+	return Hierarchy && Hierarchy->IsBuilt() && BuiltGridVersion == NavGrid.Grid->GetGridVersion() ? Hierarchy : nullptr;
+}
+
+FString AGraphAStarNavMesh::GetPreprocessingFileName(const FString &FileName)
+{
+	return FPaths::IsRelative(FileName) ? FPaths::ProjectSavedDir() / TEXT("HexPreprocessing") / FileName : FileName;
+}
+
+bool AGraphAStarNavMesh::SaveContractionHierarchies(const FString &FileName) const
+{
+	if (!HexGrid || !GetContractionHierarchy(nullptr))
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("AGraphAStarNavMesh::SaveContractionHierarchies(...) nothing to save, call BuildContractionHierarchies()"));
+		return false;
+	}
+
+	TUniquePtr<FArchive> Writer{ IFileManager::Get().CreateFileWriter(*GetPreprocessingFileName(FileName)) };
+	if (!Writer)
+	{
+		return false;
+	}
+
+	// The default cost model is saved with NAME_None. Only the HexGrid, the file describes a single grid.
+	const FHexNavGrid &NavGrid{ *GetPrimaryNavGrid() };
+	TArray<TPair<FName, TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe>>> Entries;
+	Entries.Emplace(NAME_None, GetContractionHierarchy(NavGrid, nullptr));
+	for (const FHexCompiledFilterProfilePtr &Compiled : NavGrid.CompiledFilterProfiles)
+	{
+		if (TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Hierarchy{ GetContractionHierarchy(NavGrid, Compiled) })
+		{
+			Entries.Emplace(Compiled->Name, MoveTemp(Hierarchy));
+		}
+	}
+
+	int32 NumEntries{ Entries.Num() };
+	*Writer << NumEntries;
+	for (TPair<FName, TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe>> &Entry : Entries)
+	{
+		*Writer << Entry.Key;
+		*Writer << const_cast<FHexContractionHierarchy &>(*Entry.Value);
+	}
+	return Writer->Close();
+}
+
+bool AGraphAStarNavMesh::LoadContractionHierarchies(const FString &FileName)
+{
+	if (!HexGrid)
+	{
+		return false;
+	}
+
+	TUniquePtr<FArchive> Reader{ IFileManager::Get().CreateFileReader(*GetPreprocessingFileName(FileName)) };
+	if (!Reader)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("AGraphAStarNavMesh::LoadContractionHierarchies(...) can't open %s"), *FileName);
+		return false;
+	}
+
+	FHexNavGrid &NavGrid{ *GetPrimaryNavGrid() };
+	int32 NumLoaded{ 0 };
+	int32 NumEntries{ 0 };
+	*Reader << NumEntries;
+	for (int32 EntryIndex{ 0 }; EntryIndex < NumEntries && !Reader->IsError(); ++EntryIndex)
+	{
+		FName Name;
+		FHexContractionHierarchy Hierarchy;
+		*Reader << Name;
+		*Reader << Hierarchy;
+
+		const int32 ProfileIndex{ Name.IsNone() ? INDEX_NONE : NavGrid.CompiledFilterProfiles.IndexOfByPredicate([&Name](const FHexCompiledFilterProfilePtr &Profile)
+		{
+			return Profile->Name == Name;
+		}) };
+		if (!Name.IsNone() && ProfileIndex == INDEX_NONE)
+		{
+			continue;
+		}
+		const FHexCompiledFilterProfile *Compiled{ ProfileIndex != INDEX_NONE ? NavGrid.CompiledFilterProfiles[ProfileIndex].Get() : nullptr };
+
+		// The costs must be the same of the save, otherwise the paths would be wrong
+		FGridPathFilter StaticFilter(*this, Compiled);
+		StaticFilter.CongestionWeight = 0.f;
+		if (Reader->IsError() || !Hierarchy.IsConsistent(HexGrid->GetNumTiles())
+			|| Hierarchy.Fingerprint != FHexContractionHierarchy::ComputeFingerprint(*HexGrid, StaticFilter))
+		{
+			UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("AGraphAStarNavMesh::LoadContractionHierarchies(...) %s doesn't match the grid, skipped"), *Name.ToString());
+			continue;
+		}
+
+		// Another world could have loaded or built the same data already, then that copy is used
+		TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Shared{ FHexContractionHierarchy::Share(*HexGrid, MoveTemp(Hierarchy)) };
+		if (Compiled)
+		{
+			// A new copy of the profile, the queries could be reading the current one
+			const TSharedRef<FHexCompiledFilterProfile, ESPMode::ThreadSafe> NewCompiled{ MakeShared<FHexCompiledFilterProfile, ESPMode::ThreadSafe>(*Compiled) };
+			NewCompiled->ContractionHierarchy = MoveTemp(Shared);
+			NewCompiled->ContractionHierarchyVersion = HexGrid->GetGridVersion();
+
+			FHexCompiledFilterProfilePtr OldCompiled;
+			FScopeLock Lock(&CompiledDataLock);
+			OldCompiled = MoveTemp(NavGrid.CompiledFilterProfiles[ProfileIndex]);
+			NavGrid.CompiledFilterProfiles[ProfileIndex] = NewCompiled;
+		}
+		else
+		{
+			FScopeLock Lock(&CompiledDataLock);
+			NavGrid.DefaultContractionHierarchy = MoveTemp(Shared);
+			NavGrid.DefaultContractionHierarchyVersion = HexGrid->GetGridVersion();
+		}
+		++NumLoaded;
+	}
+	return NumLoaded > 0;
+}
+//==== END OF Contraction hierarchies ====
+
+
 FPathFindingResult AGraphAStarNavMesh::FindPath(const FNavAgentProperties &AgentProperties, const FPathFindingQuery &Query)
 {
 	// =================================================================================================
@@ -73,6 +571,8 @@ FPathFindingResult AGraphAStarNavMesh::FindPath(const FNavAgentProperties &Agent
 	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASPathfinding);
 	CSV_SCOPED_TIMING_STAT_EXCLUSIVE(Pathfinding);
 
+	const double QueryStartTime{ FPlatformTime::Seconds() };
+
 	// Because we are in a static function we don't have a "this" pointer and we can't access to class member variables like HexGrid
 	// but luckily the FPathFindingQuery contain a pointer to the ANavigationData object.
 	const ANavigationData *Self = Query.NavData.Get();
@@ -87,6 +587,9 @@ FPathFindingResult AGraphAStarNavMesh::FindPath(const FNavAgentProperties &Agent
 		return ENavigationQueryResult::Error;
 	}
 
+	// The game thread can't add or remove a grid while we search it
+	FRWScopeLock NavGridsReadLock(GraphAStarNavMesh->NavGridsLock, SLT_ReadOnly);
+
 	// This struct contains the result of our search and the Path that the AI will follow
 	FPathFindingResult Result(ENavigationQueryResult::Error);
 
@@ -97,6 +600,13 @@ FPathFindingResult AGraphAStarNavMesh::FindPath(const FNavAgentProperties &Agent
 	{
 		Result.Path = Query.PathInstanceToFill;
 		NavMeshPath->ResetForRepath();
+
+		// We are going to fill it with new tiles
+		GraphAStarNavMesh->UnregisterHexPath(*NavMeshPath);
+		NavMeshPath->PrefixCosts.Reset();
+		NavMeshPath->CurrentPathCost = 0.f;
+		NavMeshPath->PathCode.Reset();
+		// bPathPointsDecoded stays: a path someone is following gets the points of the new tiles right away
 	}
 	else
 	{
@@ -126,29 +636,32 @@ FPathFindingResult AGraphAStarNavMesh::FindPath(const FNavAgentProperties &Agent
 			// Reset the PathPoints array
 			Result.Path->GetPathPoints().Reset();
 
-			// The pathfinder need a starting and ending point, so we create two temporary
-			// cube coordinates from the Query start and ending location
-			FHCubeCoord StartCCoord{ GraphAStarNavMesh->HexGrid->WorldToHex(Query.StartLocation) };
-			FHCubeCoord EndCCoord{ GraphAStarNavMesh->HexGrid->WorldToHex(Query.EndLocation) };
-			
-			// and than we search in the HexGrid CubeCoordinates array for the index of items 
-			// equals to our temp coordinates.
-			const int32 StartIdx{ GraphAStarNavMesh->HexGrid->GridCoordinates.IndexOfByKey(StartCCoord) };
-			const int32 EndIdx{ GraphAStarNavMesh->HexGrid->GridCoordinates.IndexOfByKey(EndCCoord)};
+			// The pathfinder need a starting and ending point, so we ask the navmesh which grid is under the
+			// Query start and ending location and the index of the tile (with a single grid it's always the HexGrid).
+			int32 StartIdx{ INDEX_NONE };
+			int32 EndIdx{ INDEX_NONE };
+			const FHexNavGrid *StartNavGrid{ GraphAStarNavMesh->FindNavGridAt(Query.StartLocation, StartIdx) };
+			const FHexNavGrid *EndNavGrid{ GraphAStarNavMesh->FindNavGridAt(Query.EndLocation, EndIdx) };
 
 			// We need the index because the FGraphAStar work with indexes!
 
-			// Here we will store the path generated from the pathfinder
+			// Here we will store the path generated from the pathfinder, and the grid of each part of it
 			TArray<int32> PathIndices;
-			
-			// Initialization of the pathfinder, as you can see we pass our GraphAStarNavMesh as parameter,
-			// so internally it can use the functions we implemented.
-			FGraphAStar<AGraphAStarNavMesh> Pathfinder(*GraphAStarNavMesh);
+			TArray<FGridSegment> Segments;
 
-			// and run the A* algorithm, the FGraphAStar::FindPath function want a starting index, an ending index,
-			// the FGridPathFilter which want our GraphAStarNavMesh as parameter and a reference to the array where
-			// all the indices of our path will be stored
-			EGraphAStarResult AStarResult{ Pathfinder.FindPath(StartIdx, EndIdx, FGridPathFilter(*GraphAStarNavMesh), PathIndices) };
+			EGraphAStarResult AStarResult{ SearchFail };
+			if (StartNavGrid && EndNavGrid && StartNavGrid != EndNavGrid)
+			{
+				// Start and end on different grids, we have to follow the grid connections
+				AStarResult = GraphAStarNavMesh->SearchGrids(*StartNavGrid, StartIdx, *EndNavGrid, EndIdx, Query.QueryFilter, PathIndices, Segments, AgentProperties.AgentRadius);
+			}
+			else if (StartNavGrid && EndNavGrid)
+			{
+				FGridSegment &Segment{ Segments.AddDefaulted_GetRef() };
+				Segment.NavGrid = StartNavGrid;
+				AStarResult = GraphAStarNavMesh->SearchGrid(*StartNavGrid, Query.QueryFilter, StartIdx, EndIdx, PathIndices, Segment.Profile, AgentProperties.AgentRadius);
+				Segment.NumTiles = PathIndices.Num();
+			}
 
 			// The FGraphAStar::FindPath return a EGraphAStarResult enum, we need to assign the right
 			// value to the FPathFindingResult (that is returned by AGraphAStarNavMesh::FindPath) based on this.
@@ -172,7 +685,7 @@ FPathFindingResult AGraphAStarNavMesh::FindPath(const FNavAgentProperties &Agent
 				// from these indexes and pass them to the PathPoints array of the Path
 				// that the AI will follow.
 				case SearchSuccess:
-
+				{
 					// Search succeeded
 					Result.Result = ENavigationQueryResult::Success;
 					
@@ -180,89 +693,1872 @@ FPathFindingResult AGraphAStarNavMesh::FindPath(const FNavAgentProperties &Agent
 					// we need to add it manually the the Path::PathPoints array
 					Result.Path->GetPathPoints().Add(FNavPathPoint(Query.StartLocation));
 
-					// Let's traverse the PathIndices array and build the FNavPathPoints we 
-					// need to add to the Path.
-					for (const int32 &PathIndex : PathIndices)
-					{
-						// Get a temporary Cube Coordinate from our HexGrid
-						FHCubeCoord GridCoord{ GraphAStarNavMesh->HexGrid->GridCoordinates[PathIndex] };
+					// Cost from the start to each tile, so GetCostFromIndex doesn't have to walk the path
+					NavMeshPath->PrefixCosts.Reset(PathIndices.Num() + 1);
+					NavMeshPath->PrefixCosts.Add(0.f);
 
-						// Create a temporary FNavPathPoint
-						FNavPathPoint PathPoint{};
+					TArray<FHexPathGridSpan> Spans;
+					Spans.Reserve(Segments.Num());
 
-						// Because we can create HexGrid with only Cube Coordinates and no tiles
-						// we look if the current index we are using is a valid index for the GridTiles array
-						if (GraphAStarNavMesh->HexGrid->GridTiles.IsValidIndex(PathIndex))
+					// Let's traverse the PathIndices array, one grid at a time, and sum the costs of the steps.
+					int32 Step{ 0 };
+					for (const FGridSegment &Segment : Segments)
+					{
+						AHexGrid &SegmentGrid{ *Segment.NavGrid->Grid };
+						FGridPathFilter PathFilter(*GraphAStarNavMesh, Segment.Profile, &SegmentGrid);
+						PathFilter.SetBlendedCosts(GraphAStarNavMesh->GetBlendedCosts(*Segment.NavGrid, Segment.Profile.Get()));
+
+						for (int32 SegmentStep{ 0 }; SegmentStep < Segment.NumTiles; ++SegmentStep, ++Step)
 						{
-							// If the index is valid (so we have a HexGrid with tiles) we compute the Location
-							// of the PathPoint, we use the World Space coordinates of the current Cube Coordinate
-							// as a base location and we add an offset to the Z.
-							// How to compute the Z axis of the path is up to you, this is only an example!
-							PathPoint.Location = GraphAStarNavMesh->HexGrid->HexToWorld(GridCoord) +
-								FVector(0.f, 0.f, GraphAStarNavMesh->HexGrid->GridTiles[PathIndex].Cost +
-								GraphAStarNavMesh->PathPointZOffset);
+							const int32 PathIndex{ PathIndices[Step] };
+
+							// The first tile of a grid we reached with a connection costs the connection plus the tile
+							const float StepCost{ (&Segment != &Segments[0] && SegmentStep == 0) ? Segment.HopCost + PathFilter.GetTraversalCost(PathIndex, PathIndex)
+								: PathFilter.GetTraversalCost(Step > 0 ? PathIndices[Step - 1] : StartIdx, PathIndex) };
+							NavMeshPath->PrefixCosts.Add(NavMeshPath->PrefixCosts.Last() + StepCost);
 						}
-						else
+
+						Spans.Add(FHexPathGridSpan{ &SegmentGrid, Segment.NumTiles });
+					}
+					NavMeshPath->CurrentPathCost = NavMeshPath->PrefixCosts.Last();
+
+					// 3 bits per step version of the path, it's what the path keeps: the tiles, their grids and the cost model
+					if (!NavMeshPath->PathCode.Encode(*StartNavGrid->Grid, StartIdx, PathIndices, Spans))
+					{
+						// Every step of a search is a neighbour, a portal or a connection, the grid changed under us
+						UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("AGraphAStarNavMesh::FindPath(...) the path can't be encoded, a step isn't a link of its grid"));
+						Result.Path->GetPathPoints().Reset();
+						NavMeshPath->PrefixCosts.Reset();
+						NavMeshPath->CurrentPathCost = 0.f;
+						Result.Result = ENavigationQueryResult::Error;
+						break;
+					}
+					for (const FGridSegment &Segment : Segments)
+					{
+						if (Segment.Profile.IsValid())
 						{
-							// If the current PathIndex isn't a valid index for the GridTiles array
-							// (so we assume our HexGrid is only a "logical" grid with only cube coordinates and no tiles)
-							// we simply transform the coordinates from cube space to world space and pass it to the PathPoint
-							PathPoint.Location = GraphAStarNavMesh->HexGrid->HexToWorld(GridCoord);
+							NavMeshPath->PathCode.FilterClass = Segment.Profile->FilterClass;
+							break;
 						}
-
-						// We finally add the computed PathPoint to the Path::PathPoints array
-						Result.Path->GetPathPoints().Add(FNavPathPoint(PathPoint));
 					}
 
+					// The points are decoded when a follower asks for them, a new path has only its start and its end
+					GraphAStarNavMesh->AddPathPoints(*NavMeshPath, PathIndices, Spans);
+
+					// Remember which tiles the path traverse, so a tile edit will invalidate only the paths that care about it.
+					GraphAStarNavMesh->RegisterHexPath(Result.Path);
+
 					// We finished to create the Path so mark it as Ready.
 					Result.Path->MarkReady();
 					break;
+				}
 			}
 			// =========================== END OF OUR CODE ============================================================
 		}
 	}
 
+	// Path query capture, only when someone called StartPathQueryCapture
+	if (GraphAStarNavMesh && GraphAStarNavMesh->HexGrid)
+	{
+		if (const TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> Capture{ GraphAStarNavMesh->GetQueryCapture() })
+		{
+			const FHexCompiledFilterProfilePtr Profile{ GraphAStarNavMesh->FindFilterProfile(Query.QueryFilter) };
+			Capture->RecordQuery(Query.StartLocation, Query.EndLocation, Profile ? Profile->FilterClass : nullptr, AgentProperties,
+				GraphAStarNavMesh->HexGrid->GetGridVersion(), uint8(Result.Result), Result.IsSuccessful() && NavMeshPath ? NavMeshPath->GetNumSteps() : 0,
+				float((FPlatformTime::Seconds() - QueryStartTime) * 1000.0));
+		}
+	}
+
 	return Result;
 }
 
 
-void AGraphAStarNavMesh::SetHexGrid(AHexGrid *HGrid)
+int32 AGraphAStarNavMesh::GetFootprintRadius(const AHexGrid &Grid, const float AgentRadius)
 {
-	if (HGrid)
-	{
-		// If the pointer is valid we will use our implementation of the FindPath function
-		HexGrid = HGrid;
-		FindPathImplementation = FindPath;
-	}
-	else
-	{
-		// If the pointer is not valid we will fallback to the default RecastNavMesh implementation
-		// of the FindPath function (the standard navigation behavior)
-		// You can also use FindPathImplementation = ARecastNavMesh::FindPath;
-		// but i start from the assumption that we are inheriting from ARecastNavMesh
-		HexGrid = nullptr;
-		FindPathImplementation = Super::FindPath;
-	}
+	// The agent stands on the center of its tile, it reaches the next ring as soon as it's wider than half the spacing
+	const float Spacing{ FMath::Max(Grid.GetTileSpacing(), KINDA_SMALL_NUMBER) };
+	return FMath::Clamp(FMath::CeilToInt(AgentRadius / Spacing - 0.5f), 0, AHexGrid::MaxTileClearance - 1);
 }
 
+EGraphAStarResult AGraphAStarNavMesh::SearchGrid(const FHexNavGrid &NavGrid, const FSharedConstNavQueryFilter &QueryFilter, const int32 StartIdx, const int32 EndIdx,
+	TArray<int32> &OutPath, FHexCompiledFilterProfilePtr &OutProfile, const float AgentRadius) const
+{
+	// The query filter class (e.g. the FilterClass of the MoveTo node) selects the cost model of the agent.
+	OutProfile = FindFilterProfile(NavGrid, QueryFilter);
+	FGridPathFilter PathFilter(*this, OutProfile, NavGrid.Grid);
+	PathFilter.FootprintRadius = bUseAgentClearance ? GetFootprintRadius(*NavGrid.Grid, AgentRadius) : 0;
+
+	// Pinned for the whole search, a tile edit publishes a new copy
+	const TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> JumpPointData{ GetJumpPointData(NavGrid, OutProfile) };
+
+	// Lockstep clients must find the same path, the occupancy and the cost layers are local state of each machine
+	if (bDeterministicSearch)
+	{
+		PathFilter.CongestionWeight = 0.f;
+		FHexDeterministicSearch DeterministicSearch(*NavGrid.Grid, PathFilter, *JumpPointData);
+		return DeterministicSearch.FindPath(StartIdx, EndIdx, OutPath);
+	}
+
+	// Cost layers blended for this cost model, the query keeps the snapshot alive until it ends
+	PathFilter.SetBlendedCosts(GetBlendedCosts(NavGrid, OutProfile.Get()));
+
+	// The preprocessed data only knows the tile costs seen by a single tile agent
+	const bool bStaticCosts{ PathFilter.CongestionWeight <= 0.f && PathFilter.FootprintRadius == 0 && !PathFilter.HasBlendedCosts() };
+
+	const TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Hierarchy{ bUseContractionHierarchy ? GetContractionHierarchy(NavGrid, OutProfile) : nullptr };
+
+	// Occupancy costs and cost layers change every frame, the preprocessed data can't know them
+	if (Hierarchy && bStaticCosts)
+	{
+		return Hierarchy->FindPath(StartIdx, EndIdx, OutPath);
+	}
+
+	// Long queries are split between the worker threads, the short ones aren't worth the synchronization
+	const AHexGrid &Grid{ *NavGrid.Grid };
+	if (bUseParallelSearch && Grid.IsValidRef(StartIdx) && Grid.IsValidRef(EndIdx)
+		&& FHPackedCoord::Distance(Grid.GetPackedCoord(StartIdx), Grid.GetPackedCoord(EndIdx)) >= ParallelSearchMinDistance)
+	{
+		const int32 NumWorkers{ ParallelSearchWorkers > 0 ? ParallelSearchWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1 };
+		FHexParallelSearch ParallelSearch(Grid, PathFilter, *JumpPointData, NumWorkers);
+		if (ParallelSearch.FindPath(StartIdx, EndIdx, OutPath) == SearchSuccess)
+		{
+			return SearchSuccess;
+		}
+
+		// The goal can't be reached, the serial search below builds the partial path
+		OutPath.Reset();
+	}
+
+	if (bUseJumpPointSearch && bStaticCosts)
+	{
+		// Same contract of FGraphAStar::FindPath, it just skips the uniform regions
+		FHexJumpPointSearch JumpPointSearch(*NavGrid.Grid, PathFilter, *JumpPointData);
+		return JumpPointSearch.FindPath(StartIdx, EndIdx, OutPath);
+	}
+
+	// Initialization of the pathfinder, as you can see we pass the grid as parameter,
+	// so internally it can use the functions it implements (GetNeighbourCount, GetNeighbour...).
+	FGraphAStar<AHexGrid> Pathfinder(*NavGrid.Grid);
+
+	// and run the A* algorithm, the FGraphAStar::FindPath function want a starting index, an ending index,
+	// the FGridPathFilter which want our GraphAStarNavMesh as parameter and a reference to the array where
+	// all the indices of our path will be stored
+	return Pathfinder.FindPath(StartIdx, EndIdx, PathFilter, OutPath);
+}
+
+bool AGraphAStarNavMesh::FindDeterministicTilePath(int32 StartTile, int32 GoalTile, TSubclassOf<UNavigationQueryFilter> FilterClass,
+	TArray<int32> &OutTiles, int64 &OutFixedCost) const
+{
+	OutTiles.Reset();
+	OutFixedCost = 0;
+
+	const FHexNavGrid *NavGrid{ GetPrimaryNavGrid() };
+	if (!NavGrid)
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASPathfinding);
+
+	const FHexCompiledFilterProfilePtr Profile{ FilterClass ? FindFilterProfile(*NavGrid, GetQueryFilter(FilterClass)) : nullptr };
+	FGridPathFilter PathFilter(*this, Profile, NavGrid->Grid);
+	PathFilter.CongestionWeight = 0.f;
+
+	const TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> JumpPointData{ GetJumpPointData(*NavGrid, Profile) };
+	FHexDeterministicSearch DeterministicSearch(*NavGrid->Grid, PathFilter, *JumpPointData);
+	if (DeterministicSearch.FindPath(StartTile, GoalTile, OutTiles) != SearchSuccess)
+	{
+		OutTiles.Reset();
+		return false;
+	}
+
+	OutFixedCost = DeterministicSearch.GetPathCost();
+	return true;
+}
+
+EGraphAStarResult AGraphAStarNavMesh::SearchGrids(const FHexNavGrid &StartNavGrid, const int32 StartIdx, const FHexNavGrid &EndNavGrid, const int32 EndIdx,
+	const FSharedConstNavQueryFilter &QueryFilter, TArray<int32> &OutPath, TArray<FGridSegment> &OutSegments, const float AgentRadius) const
+{
+	OutPath.Reset();
+	OutSegments.Reset();
+
+	const int32 StartSlot{ GetNavGridSlot(StartNavGrid.Grid) };
+	const int32 EndSlot{ GetNavGridSlot(EndNavGrid.Grid) };
+	if (StartSlot == INDEX_NONE || EndSlot == INDEX_NONE || !StartNavGrid.Grid->IsValidRef(StartIdx) || !EndNavGrid.Grid->IsValidRef(EndIdx))
+	{
+		return SearchFail;
+	}
+
+	// Breadth first on the grids, the route that crosses the fewest connections
+	TArray<int32> PreviousSlots;
+	PreviousSlots.Init(INDEX_NONE, NavGrids.Num());
+	PreviousSlots[StartSlot] = StartSlot;
+	TArray<int32> Frontier{ StartSlot };
+	for (int32 Head{ 0 }; Head < Frontier.Num() && PreviousSlots[EndSlot] == INDEX_NONE; ++Head)
+	{
+		for (const FGridLink &Link : GridLinks)
+		{
+			if (Link.FromSlot == Frontier[Head] && PreviousSlots[Link.ToSlot] == INDEX_NONE)
+			{
+				PreviousSlots[Link.ToSlot] = Frontier[Head];
+				Frontier.Add(Link.ToSlot);
+			}
+		}
+	}
+
+	if (PreviousSlots[EndSlot] == INDEX_NONE)
+	{
+		return GoalUnreachable;
+	}
+
+	TArray<int32> Route;
+	for (int32 Slot{ EndSlot }; Slot != StartSlot; Slot = PreviousSlots[Slot])
+	{
+		Route.Add(Slot);
+	}
+	Route.Add(StartSlot);
+	Algo::Reverse(Route);
+
+	// Then a regular search on each grid of the route, from where we are to the connection with the next grid
+	int32 CurrentIdx{ StartIdx };
+	float HopCost{ 0.f };
+	TArray<int32> SegmentPath;
+	for (int32 RouteIndex{ 0 }; RouteIndex < Route.Num(); ++RouteIndex)
+	{
+		const FHexNavGrid &NavGrid{ *NavGrids[Route[RouteIndex]] };
+
+		FGridSegment Segment;
+		Segment.NavGrid = &NavGrid;
+		Segment.HopCost = HopCost;
+
+		// The tile we arrived on with the connection is part of the path
+		if (RouteIndex > 0)
+		{
+			OutPath.Add(CurrentIdx);
+			++Segment.NumTiles;
+		}
+
+		if (RouteIndex == Route.Num() - 1)
+		{
+			SegmentPath.Reset();
+			const EGraphAStarResult SegmentResult{ CurrentIdx == EndIdx ? SearchSuccess
+				: SearchGrid(NavGrid, QueryFilter, CurrentIdx, EndIdx, SegmentPath, Segment.Profile, AgentRadius) };
+			if (SegmentResult != SearchSuccess)
+			{
+				return SegmentResult;
+			}
+
+			OutPath.Append(SegmentPath);
+			Segment.NumTiles += SegmentPath.Num();
+			OutSegments.Add(Segment);
+			return SearchSuccess;
+		}
+
+		// Links to the next grid of the route, we try the closest first
+		TArray<const FGridLink *> Candidates;
+		for (const FGridLink &Link : GridLinks)
+		{
+			if (Link.FromSlot == Route[RouteIndex] && Link.ToSlot == Route[RouteIndex + 1])
+			{
+				Candidates.Add(&Link);
+			}
+		}
+
+		const FHPackedCoord Current{ NavGrid.Grid->GetPackedCoord(CurrentIdx) };
+		Candidates.Sort([&NavGrid, &Current](const FGridLink &A, const FGridLink &B)
+		{
+			return FHPackedCoord::Distance(Current, NavGrid.Grid->GetPackedCoord(A.FromTile)) < FHPackedCoord::Distance(Current, NavGrid.Grid->GetPackedCoord(B.FromTile));
+		});
+
+		EGraphAStarResult SegmentResult{ GoalUnreachable };
+		const FGridLink *UsedLink{ nullptr };
+		for (const FGridLink *Link : Candidates)
+		{
+			SegmentPath.Reset();
+			SegmentResult = CurrentIdx == Link->FromTile ? SearchSuccess
+				: SearchGrid(NavGrid, QueryFilter, CurrentIdx, Link->FromTile, SegmentPath, Segment.Profile, AgentRadius);
+			if (SegmentResult == SearchSuccess)
+			{
+				UsedLink = Link;
+				break;
+			}
+		}
+
+		if (!UsedLink)
+		{
+			return SegmentResult;
+		}
+
+		OutPath.Append(SegmentPath);
+		Segment.NumTiles += SegmentPath.Num();
+		OutSegments.Add(Segment);
+
+		CurrentIdx = UsedLink->ToTile;
+		HopCost = UsedLink->Cost;
+	}
+
+	return SearchFail;
+}
+
+
+void AGraphAStarNavMesh::SetHexGrid(AHexGrid *HGrid)
+{
+	if (HGrid)
+	{
+		// If the pointer is valid we will use our implementation of the FindPath function
+		if (HexGrid != HGrid)
+		{
+			StopPathQueryCaptureOnGridsChange();
+
+			// The old HexGrid goes away, the new one could be registered as a secondary grid already
+			if (HexGrid)
+			{
+				RemoveNavGridAt(0);
+			}
+			const int32 Slot{ GetNavGridSlot(HGrid) };
+			if (Slot != INDEX_NONE)
+			{
+				RemoveNavGridAt(Slot);
+			}
+
+			HexGrid = HGrid;
+			AddNavGrid(HGrid, true);
+
+			// Occupancy is relinked on the new grid at the next tick
+			TileOccupancy.Reset();
+		}
+		else
+		{
+			// Coordinates or tiles could be filled by hand, make sure the shared data the searches read is in sync
+			HexGrid->RebuildPackedCoordinates();
+			RebuildFilterProfiles(*GetPrimaryNavGrid());
+		}
+
+		FindPathImplementation = FindPath;
+		RaycastImplementation = HexRaycast;
+		RebuildGridRouting();
+	}
+	else
+	{
+		// If the pointer is not valid we will fallback to the default RecastNavMesh implementation
+		// of the FindPath function (the standard navigation behavior), every registered grid is removed.
+		// You can also use FindPathImplementation = ARecastNavMesh::FindPath;
+		// but i start from the assumption that we are inheriting from ARecastNavMesh
+		StopPathQueryCapture();
+		while (NavGrids.Num() > 0)
+		{
+			RemoveNavGridAt(NavGrids.Num() - 1);
+		}
+		HexGrid = nullptr;
+		FindPathImplementation = Super::FindPath;
+		RaycastImplementation = ARecastNavMesh::NavMeshRaycast;
+		RebuildGridRouting();
+	}
+}
+
+
+void AGraphAStarNavMesh::UnbindHexGrid(AHexGrid *Grid)
+{
+	if (Grid)
+	{
+		Grid->OnTilesChangedNative.RemoveAll(this);
+	}
+}
+
+
+void AGraphAStarNavMesh::OnHexTilesChanged(const FHexGridChange &Change, AHexGrid *ChangedGrid)
+{
+	const int32 Slot{ GetNavGridSlot(ChangedGrid) };
+	if (Slot == INDEX_NONE)
+	{
+		return;
+	}
+	FHexNavGrid &NavGrid{ *NavGrids[Slot] };
+
+	// The replay needs to see the same grids of each query
+	if (const TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> Capture{ GetQueryCapture() })
+	{
+		Capture->RecordTileChange(*ChangedGrid, Change);
+	}
+
+	// Tiles changed, not moved, so we only recompile the dirty entries of each profile.
+	// The queries could be reading the current profiles, the dirty entries are patched on copies that replace them.
+	TArray<FHexCompiledFilterProfilePtr> Profiles;
+	Profiles.Reserve(NavGrid.CompiledFilterProfiles.Num());
+	for (const FHexCompiledFilterProfilePtr &OldCompiled : NavGrid.CompiledFilterProfiles)
+	{
+		if (!IsFilterProfileUpToDate(NavGrid, OldCompiled.Get()))
+		{
+			Profiles.Add(OldCompiled);
+			continue;
+		}
+
+		const TSharedRef<FHexCompiledFilterProfile, ESPMode::ThreadSafe> Compiled{ MakeShared<FHexCompiledFilterProfile, ESPMode::ThreadSafe>(*OldCompiled) };
+		for (const int32 TileIndex : Change.DirtyTiles)
+		{
+			Compiled->CompileTile(*ChangedGrid, TileIndex);
+		}
+
+		FGridPathFilter StaticFilter(*this, &Compiled.Get(), ChangedGrid);
+		StaticFilter.CongestionWeight = 0.f;
+		Compiled->JumpPointData.Update(*ChangedGrid, StaticFilter, Change.DirtyTiles);
+		Profiles.Add(Compiled);
+	}
+
+	const TSharedRef<FHexJumpPointData, ESPMode::ThreadSafe> DefaultJumpPointData{ MakeShared<FHexJumpPointData, ESPMode::ThreadSafe>(*NavGrid.DefaultJumpPointData) };
+	FGridPathFilter StaticFilter(*this, nullptr, ChangedGrid);
+	StaticFilter.CongestionWeight = 0.f;
+	DefaultJumpPointData->Update(*ChangedGrid, StaticFilter, Change.DirtyTiles);
+
+	SwapCompiledData(NavGrid, MoveTemp(Profiles), DefaultJumpPointData);
+
+	if (bInvalidatePathsOnTileChange)
+	{
+		InvalidatePathsOnTiles(NavGrid, Change.DirtyTiles);
+	}
+}
+
+
+//==== Grid registry ====
+
+void AGraphAStarNavMesh::RegisterHexGrid(AHexGrid *Grid)
+{
+	if (!Grid || GetNavGridSlot(Grid) != INDEX_NONE)
+	{
+		return;
+	}
+
+	// The first grid is the HexGrid
+	if (!HexGrid)
+	{
+		SetHexGrid(Grid);
+		return;
+	}
+
+	StopPathQueryCaptureOnGridsChange();
+	AddNavGrid(Grid, false);
+	RebuildGridRouting();
+}
+
+void AGraphAStarNavMesh::UnregisterHexGrid(AHexGrid *Grid)
+{
+	const int32 Slot{ GetNavGridSlot(Grid) };
+	if (Slot == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (Slot > 0)
+	{
+		StopPathQueryCaptureOnGridsChange();
+		RemoveNavGridAt(Slot);
+		RebuildGridRouting();
+		return;
+	}
+
+	// The HexGrid, the next grid takes its place
+	if (NavGrids.Num() == 1)
+	{
+		SetHexGrid(nullptr);
+		return;
+	}
+
+	StopPathQueryCapture();
+	RemoveNavGridAt(0);
+	HexGrid = NavGrids[0]->Grid;
+	TileOccupancy.Reset();
+	RebuildGridRouting();
+}
+
+void AGraphAStarNavMesh::RefreshHexGrids()
+{
+	for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+	{
+		NavGrid->Grid->RebuildPackedCoordinates();
+		RebuildFilterProfiles(*NavGrid);
+	}
+	RebuildGridRouting();
+}
+
+void AGraphAStarNavMesh::AddGridConnection(const FHexGridConnection &Connection)
+{
+	StopPathQueryCaptureOnGridsChange();
+	GridConnections.Add(Connection);
+	RebuildGridRouting();
+}
+
+void AGraphAStarNavMesh::ClearGridConnections()
+{
+	StopPathQueryCaptureOnGridsChange();
+	GridConnections.Reset();
+	RebuildGridRouting();
+}
+
+void AGraphAStarNavMesh::GetHexGrids(TArray<AHexGrid *> &OutGrids) const
+{
+	OutGrids.Reset(NavGrids.Num());
+	for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+	{
+		OutGrids.Add(NavGrid->Grid);
+	}
+}
+
+FHexNavGrid &AGraphAStarNavMesh::AddNavGrid(AHexGrid *Grid, const bool bPrimary)
+{
+	Grid->OnTilesChangedNative.AddUObject(this, &AGraphAStarNavMesh::OnHexTilesChanged, Grid);
+
+	TUniquePtr<FHexNavGrid> NavGrid{ MakeUnique<FHexNavGrid>() };
+	NavGrid->Grid = Grid;
+	FHexNavGrid &Added{ *NavGrid };
+	{
+		// The array can reallocate and the slots of the routing move, the queries see no routing until it's rebuilt
+		FRWScopeLock WriteLock(NavGridsLock, SLT_Write);
+		if (bPrimary)
+		{
+			NavGrids.Insert(MoveTemp(NavGrid), 0);
+		}
+		else
+		{
+			NavGrids.Add(MoveTemp(NavGrid));
+		}
+		GridLookupCells.Reset();
+		GridLinks.Reset();
+	}
+
+	// Coordinates or tiles could be filled by hand, make sure the shared data the searches read is in sync
+	Grid->RebuildPackedCoordinates();
+	RebuildFilterProfiles(Added);
+	return Added;
+}
+
+void AGraphAStarNavMesh::RemoveNavGridAt(const int32 Slot)
+{
+	UnbindHexGrid(NavGrids[Slot]->Grid);
+
+	// The preview trees point to the grid and its profiles
+	ClearPathPreviews();
+
+	// No query is using it once we have the write lock, its paths index goes with it
+	FRWScopeLock WriteLock(NavGridsLock, SLT_Write);
+	FScopeLock Lock(&TilePathsLock);
+	NavGrids.RemoveAt(Slot);
+	GridLookupCells.Reset();
+	GridLinks.Reset();
+}
+
+int32 AGraphAStarNavMesh::GetNavGridSlot(const AHexGrid *Grid) const
+{
+	return NavGrids.IndexOfByPredicate([Grid](const TUniquePtr<FHexNavGrid> &NavGrid) { return NavGrid->Grid == Grid; });
+}
+
+const FHexNavGrid *AGraphAStarNavMesh::FindNavGrid(const AHexGrid *Grid) const
+{
+	const int32 Slot{ GetNavGridSlot(Grid) };
+	return Slot != INDEX_NONE ? NavGrids[Slot].Get() : nullptr;
+}
+
+void AGraphAStarNavMesh::RebuildGridRouting()
+{
+	// Built aside and swapped under the write lock, the queries keep using the old routing meanwhile
+	TArray<FBox> Bounds;
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<2>>> LookupCells;
+	TArray<FGridLink> Links;
+
+	// Each grid goes in all the cells its bounds overlap
+	for (int32 Slot{ 0 }; Slot < NavGrids.Num(); ++Slot)
+	{
+		const FBox &GridBounds{ Bounds.Add_GetRef(NavGrids[Slot]->Grid->GetGridBounds()) };
+		if (!GridBounds.IsValid)
+		{
+			continue;
+		}
+
+		const FIntPoint MinCell(FMath::FloorToInt(GridBounds.Min.X / GridLookupCellSize), FMath::FloorToInt(GridBounds.Min.Y / GridLookupCellSize));
+		const FIntPoint MaxCell(FMath::FloorToInt(GridBounds.Max.X / GridLookupCellSize), FMath::FloorToInt(GridBounds.Max.Y / GridLookupCellSize));
+		for (int32 X{ MinCell.X }; X <= MaxCell.X; ++X)
+		{
+			for (int32 Y{ MinCell.Y }; Y <= MaxCell.Y; ++Y)
+			{
+				LookupCells.FindOrAdd(FIntPoint(X, Y)).Add(Slot);
+			}
+		}
+	}
+
+	// Resolve the connections to slots and tile indices, the searches don't touch actors or coordinates
+	for (const FHexGridConnection &Connection : GridConnections)
+	{
+		FGridLink Link;
+		Link.FromSlot = GetNavGridSlot(Connection.FromGrid);
+		Link.ToSlot = GetNavGridSlot(Connection.ToGrid);
+		Link.FromTile = Connection.FromGrid ? Connection.FromGrid->GetCoordIndex(Connection.FromTile) : INDEX_NONE;
+		Link.ToTile = Connection.ToGrid ? Connection.ToGrid->GetCoordIndex(Connection.ToTile) : INDEX_NONE;
+		Link.Cost = Connection.Cost;
+
+		// Links inside a grid are portals, see AHexGrid::AddPortal
+		if (Link.FromSlot == INDEX_NONE || Link.ToSlot == INDEX_NONE || Link.FromSlot == Link.ToSlot
+			|| Link.FromTile == INDEX_NONE || Link.ToTile == INDEX_NONE)
+		{
+			continue;
+		}
+
+		Links.Add(Link);
+		if (Connection.bTwoWay)
+		{
+			Swap(Link.FromSlot, Link.ToSlot);
+			Swap(Link.FromTile, Link.ToTile);
+			Links.Add(Link);
+		}
+	}
+
+	FRWScopeLock WriteLock(NavGridsLock, SLT_Write);
+	for (int32 Slot{ 0 }; Slot < NavGrids.Num(); ++Slot)
+	{
+		NavGrids[Slot]->Bounds = Bounds[Slot];
+	}
+	GridLookupCells = MoveTemp(LookupCells);
+	GridLinks = MoveTemp(Links);
+}
+
+const FHexNavGrid *AGraphAStarNavMesh::FindNavGridAt(const FVector &Location, int32 &OutTileIndex) const
+{
+	OutTileIndex = INDEX_NONE;
+
+	// A single grid takes every query, like before there were more grids
+	if (NavGrids.Num() == 1)
+	{
+		AHexGrid *Grid{ NavGrids[0]->Grid };
+		OutTileIndex = Grid->GetCoordIndex(Grid->WorldToHex(Location));
+		return NavGrids[0].Get();
+	}
+
+	const FIntPoint Cell(FMath::FloorToInt(Location.X / GridLookupCellSize), FMath::FloorToInt(Location.Y / GridLookupCellSize));
+	const TArray<int32, TInlineAllocator<2>> *Slots{ GridLookupCells.Find(Cell) };
+	if (!Slots)
+	{
+		return nullptr;
+	}
+
+	// Grids can overlap (the floors of a building), the closest in height wins
+	const FHexNavGrid *Found{ nullptr };
+	float FoundDistanceZ{ TNumericLimits<float>::Max() };
+	for (const int32 Slot : *Slots)
+	{
+		const FHexNavGrid &NavGrid{ *NavGrids[Slot] };
+		if (!NavGrid.Bounds.IsInsideXY(Location))
+		{
+			continue;
+		}
+
+		const int32 TileIndex{ NavGrid.Grid->GetCoordIndex(NavGrid.Grid->WorldToHex(Location)) };
+		const float DistanceZ{ FMath::Abs(Location.Z - NavGrid.Bounds.GetCenter().Z) };
+		if (TileIndex != INDEX_NONE && DistanceZ < FoundDistanceZ)
+		{
+			Found = &NavGrid;
+			FoundDistanceZ = DistanceZ;
+			OutTileIndex = TileIndex;
+		}
+	}
+	return Found;
+}
+//==== END OF Grid registry ====
+
+
+//==== ANavigationData queries ====
+
+namespace
+{
+	/* Bigger than any grid (the radius is clamped to 25), it only bounds the queries with a huge radius */
+	constexpr int32 MaxQueryTileRadius{ 64 };
+
+	/* Radius in tiles of the hexagon that contains a circle of the given world radius */
+	int32 GetTileRadius(const AHexGrid &Grid, const float Distance)
+	{
+		const float Spacing{ FMath::Max(Grid.GetTileSpacing(), KINDA_SMALL_NUMBER) };
+		return FMath::Clamp(FMath::CeilToInt(Distance / Spacing) + 1, 0, MaxQueryTileRadius);
+	}
+
+	/* The tiles around Center, nearest rings first */
+	void GetTilesAround(const AHexGrid &Grid, const FHCubeCoord &Center, const int32 TileRadius, TArray<int32> &OutTiles)
+	{
+		OutTiles.SetNumUninitialized(UHexGridQueryLibrary::GetRangeCapacity(TileRadius));
+		OutTiles.SetNum(UHexGridQueryLibrary::Spiral(Grid, Center, TileRadius, OutTiles), false);
+	}
+}
+
+bool AGraphAStarNavMesh::ProjectPoint(const FVector &Point, FNavLocation &OutLocation, const FVector &Extent, FSharedConstNavQueryFilter Filter, const UObject *Querier) const
+{
+	int32 TileIndex{ INDEX_NONE };
+	const FHexNavGrid *NavGrid{ HexGrid ? FindNavGridAt(Point, TileIndex) : nullptr };
+	if (!NavGrid)
+	{
+		return !bSkipRecastGeneration && Super::ProjectPoint(Point, OutLocation, Extent, Filter, Querier);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASQuery);
+	return ProjectPointToGrid(*NavGrid, Point, Extent, Filter, OutLocation);
+}
+
+bool AGraphAStarNavMesh::ProjectPointToGrid(const FHexNavGrid &NavGrid, const FVector &Point, const FVector &Extent, const FSharedConstNavQueryFilter &Filter, FNavLocation &OutLocation) const
+{
+	AHexGrid &Grid{ *NavGrid.Grid };
+	const FGridPathFilter PathFilter(*this, FindFilterProfile(NavGrid, Filter), &Grid);
+
+	// The grid is flat, if the point is too high (or too low) no tile can take it
+	const FHCubeCoord Center{ Grid.WorldToHex(Point) };
+	const FVector CenterLocation{ Grid.HexToWorld(Center) };
+	if (FMath::Abs(Point.Z - CenterLocation.Z) > Extent.Z)
+	{
+		return false;
+	}
+
+	// Most of the times the tile under the point is good and the point keeps its XY,
+	// like a projection on the Recast polygons
+	const int32 TileIndex{ Grid.GetCoordIndex(Center) };
+	if (TileIndex != INDEX_NONE && PathFilter.IsTraversalAllowed(TileIndex, TileIndex))
+	{
+		OutLocation = FNavLocation(FVector(Point.X, Point.Y, CenterLocation.Z));
+		return true;
+	}
+
+	// Otherwise the center of the closest traversable tile inside the extent
+	TArray<int32> Candidates;
+	GetTilesAround(Grid, Center, GetTileRadius(Grid, FMath::Max(Extent.X, Extent.Y)), Candidates);
+
+	float BestDistanceSq{ TNumericLimits<float>::Max() };
+	for (const int32 Candidate : Candidates)
+	{
+		if (!PathFilter.IsTraversalAllowed(Candidate, Candidate))
+		{
+			continue;
+		}
+
+		const FVector TileLocation{ Grid.HexToWorld(Grid.GetTileCoord(Candidate)) };
+		const FVector Delta{ TileLocation - Point };
+		if (FMath::Abs(Delta.X) <= Extent.X && FMath::Abs(Delta.Y) <= Extent.Y && Delta.SizeSquared2D() < BestDistanceSq)
+		{
+			BestDistanceSq = Delta.SizeSquared2D();
+			OutLocation = FNavLocation(TileLocation);
+		}
+	}
+	return BestDistanceSq < TNumericLimits<float>::Max();
+}
+
+void AGraphAStarNavMesh::BatchProjectPoints(TArray<FNavigationProjectionWork> &Workload, const FVector &Extent, FSharedConstNavQueryFilter Filter, const UObject *Querier) const
+{
+	if (!HexGrid)
+	{
+		Super::BatchProjectPoints(Workload, Extent, Filter, Querier);
+		return;
+	}
+
+	for (FNavigationProjectionWork &Work : Workload)
+	{
+		Work.bResult = ProjectPoint(Work.Point, Work.OutLocation, Extent, Filter, Querier);
+	}
+}
+
+void AGraphAStarNavMesh::BatchProjectPoints(TArray<FNavigationProjectionWork> &Workload, FSharedConstNavQueryFilter Filter, const UObject *Querier) const
+{
+	if (!HexGrid)
+	{
+		Super::BatchProjectPoints(Workload, Filter, Querier);
+		return;
+	}
+
+	// Each work item brings its own projection box, the default extent for the ones without it
+	for (FNavigationProjectionWork &Work : Workload)
+	{
+		if (Work.ProjectionLimit.IsValid)
+		{
+			const FVector Point(Work.Point.X, Work.Point.Y, Work.ProjectionLimit.GetCenter().Z);
+			Work.bResult = ProjectPoint(Point, Work.OutLocation, Work.ProjectionLimit.GetExtent(), Filter, Querier);
+		}
+		else
+		{
+			Work.bResult = ProjectPoint(Work.Point, Work.OutLocation, GetDefaultQueryExtent(), Filter, Querier);
+		}
+	}
+}
+
+FNavLocation AGraphAStarNavMesh::GetRandomPoint(FSharedConstNavQueryFilter Filter, const UObject *Querier) const
+{
+	if (!HexGrid)
+	{
+		return Super::GetRandomPoint(Filter, Querier);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASQuery);
+
+	int32 NumTiles{ 0 };
+	for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+	{
+		NumTiles += NavGrid->Grid->GetNumTiles();
+	}
+
+	// A random tile of the union of the grids, blocked tiles are thrown away and we try again.
+	// A few tries are enough unless most of the tiles are blocked, then we pick from the full list of traversable tiles.
+	constexpr int32 MaxTries{ 16 };
+	for (int32 Try{ 0 }; Try < MaxTries && NumTiles > 0; ++Try)
+	{
+		int32 Pick{ FMath::RandHelper(NumTiles) };
+		for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+		{
+			AHexGrid &Grid{ *NavGrid->Grid };
+			if (Pick >= Grid.GetNumTiles())
+			{
+				Pick -= Grid.GetNumTiles();
+				continue;
+			}
+
+			const FGridPathFilter PathFilter(*this, FindFilterProfile(*NavGrid, Filter), &Grid);
+			if (PathFilter.IsTraversalAllowed(Pick, Pick))
+			{
+				return FNavLocation(Grid.HexToWorld(Grid.GetTileCoord(Pick)));
+			}
+			break;
+		}
+	}
+
+	TArray<TPair<AHexGrid *, int32>> Traversable;
+	for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+	{
+		AHexGrid &Grid{ *NavGrid->Grid };
+		const FGridPathFilter PathFilter(*this, FindFilterProfile(*NavGrid, Filter), &Grid);
+		for (int32 TileIndex{ 0 }; TileIndex < Grid.GetNumTiles(); ++TileIndex)
+		{
+			if (PathFilter.IsTraversalAllowed(TileIndex, TileIndex))
+			{
+				Traversable.Emplace(&Grid, TileIndex);
+			}
+		}
+	}
+
+	if (Traversable.Num() == 0)
+	{
+		return FNavLocation();
+	}
+
+	const TPair<AHexGrid *, int32> &Picked{ Traversable[FMath::RandHelper(Traversable.Num())] };
+	return FNavLocation(Picked.Key->HexToWorld(Picked.Key->GetTileCoord(Picked.Value)));
+}
+
+bool AGraphAStarNavMesh::GetRandomReachablePointInRadius(const FVector &Origin, float Radius, FNavLocation &OutResult, FSharedConstNavQueryFilter Filter, const UObject *Querier) const
+{
+	int32 StartTile{ INDEX_NONE };
+	const FHexNavGrid *NavGrid{ HexGrid ? FindNavGridAt(Origin, StartTile) : nullptr };
+	if (!NavGrid || StartTile == INDEX_NONE)
+	{
+		return !bSkipRecastGeneration && Super::GetRandomReachablePointInRadius(Origin, Radius, OutResult, Filter, Querier);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASQuery);
+
+	AHexGrid &Grid{ *NavGrid->Grid };
+	const FGridPathFilter PathFilter(*this, FindFilterProfile(*NavGrid, Filter), &Grid);
+	if (!PathFilter.IsTraversalAllowed(StartTile, StartTile))
+	{
+		return false;
+	}
+
+	// Breadth first flood from the start tile through the traversable neighbours (portals too),
+	// tiles whose center is outside of the radius stop the flood
+	const float RadiusSq{ FMath::Square(Radius) };
+	TBitArray<> Visited(false, Grid.GetNumTiles());
+	Visited[StartTile] = true;
+
+	TArray<int32> Reached;
+	Reached.Add(StartTile);
+	for (int32 Head{ 0 }; Head < Reached.Num(); ++Head)
+	{
+		const int32 Tile{ Reached[Head] };
+		const int32 NumNeighbours{ Grid.GetNeighbourCount(Tile) };
+		for (int32 NeiIndex{ 0 }; NeiIndex < NumNeighbours; ++NeiIndex)
+		{
+			const int32 Neighbour{ Grid.GetNeighbour(Tile, NeiIndex) };
+			if (!Grid.IsValidRef(Neighbour) || Visited[Neighbour])
+			{
+				continue;
+			}
+			Visited[Neighbour] = true;
+
+			if (PathFilter.IsTraversalAllowed(Tile, Neighbour)
+				&& FVector::DistSquared2D(Grid.HexToWorld(Grid.GetTileCoord(Neighbour)), Origin) <= RadiusSq)
+			{
+				Reached.Add(Neighbour);
+			}
+		}
+	}
+
+	const int32 Picked{ Reached[FMath::RandHelper(Reached.Num())] };
+	OutResult = FNavLocation(Grid.HexToWorld(Grid.GetTileCoord(Picked)));
+	return true;
+}
+
+bool AGraphAStarNavMesh::GetRandomPointInNavigableRadius(const FVector &Origin, float Radius, FNavLocation &OutResult, FSharedConstNavQueryFilter Filter, const UObject *Querier) const
+{
+	int32 CenterTile{ INDEX_NONE };
+	const FHexNavGrid *NavGrid{ HexGrid ? FindNavGridAt(Origin, CenterTile) : nullptr };
+	if (!NavGrid)
+	{
+		return !bSkipRecastGeneration && Super::GetRandomPointInNavigableRadius(Origin, Radius, OutResult, Filter, Querier);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASQuery);
+
+	AHexGrid &Grid{ *NavGrid->Grid };
+	const FGridPathFilter PathFilter(*this, FindFilterProfile(*NavGrid, Filter), &Grid);
+
+	TArray<int32> Candidates;
+	GetTilesAround(Grid, Grid.WorldToHex(Origin), GetTileRadius(Grid, Radius), Candidates);
+
+	// Keep the traversable tiles inside the circle in place, then pick one
+	const float RadiusSq{ FMath::Square(Radius) };
+	int32 NumValid{ 0 };
+	for (const int32 Candidate : Candidates)
+	{
+		if (PathFilter.IsTraversalAllowed(Candidate, Candidate)
+			&& FVector::DistSquared2D(Grid.HexToWorld(Grid.GetTileCoord(Candidate)), Origin) <= RadiusSq)
+		{
+			Candidates[NumValid++] = Candidate;
+		}
+	}
+
+	if (NumValid == 0)
+	{
+		return false;
+	}
+
+	OutResult = FNavLocation(Grid.HexToWorld(Grid.GetTileCoord(Candidates[FMath::RandHelper(NumValid)])));
+	return true;
+}
+
+bool AGraphAStarNavMesh::HexRaycast(const ANavigationData *Self, const FVector &RayStart, const FVector &RayEnd, FVector &HitLocation, FSharedConstNavQueryFilter QueryFilter, const UObject *Querier)
+{
+	// Static for the same reason of FindPath, the instance comes as a parameter
+	const AGraphAStarNavMesh *NavMesh{ Cast<const AGraphAStarNavMesh>(Self) };
+	if (!NavMesh)
+	{
+		return ARecastNavMesh::NavMeshRaycast(Self, RayStart, RayEnd, HitLocation, QueryFilter, Querier);
+	}
+	FRWScopeLock NavGridsReadLock(NavMesh->NavGridsLock, SLT_ReadOnly);
+
+	int32 StartTile{ INDEX_NONE };
+	const FHexNavGrid *NavGrid{ NavMesh->HexGrid ? NavMesh->FindNavGridAt(RayStart, StartTile) : nullptr };
+	if (!NavGrid || StartTile == INDEX_NONE)
+	{
+		if (NavMesh->bSkipRecastGeneration)
+		{
+			// Same answer of Recast for a ray that doesn't start on the navmesh
+			HitLocation = RayStart;
+			return true;
+		}
+		return ARecastNavMesh::NavMeshRaycast(Self, RayStart, RayEnd, HitLocation, QueryFilter, Querier);
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASQuery);
+
+	AHexGrid &Grid{ *NavGrid->Grid };
+	const FGridPathFilter PathFilter(*NavMesh, NavMesh->FindFilterProfile(*NavGrid, QueryFilter), &Grid);
+	if (!PathFilter.IsTraversalAllowed(StartTile, StartTile))
+	{
+		HitLocation = RayStart;
+		return true;
+	}
+
+	// We march along the ray in steps of half a tile so we don't jump over a tile (only its corners),
+	// every time the sample enters a new tile that tile must be traversable
+	const auto TileAt = [&Grid, &RayStart, &RayEnd](const float Alpha)
+	{
+		return Grid.GetCoordIndex(Grid.WorldToHex(FMath::Lerp(RayStart, RayEnd, Alpha)));
+	};
+
+	const float RayLength{ FVector::Dist2D(RayStart, RayEnd) };
+	const int32 NumSteps{ FMath::Max(FMath::CeilToInt(2.f * RayLength / FMath::Max(Grid.GetTileSpacing(), KINDA_SMALL_NUMBER)), 1) };
+
+	int32 PreviousTile{ StartTile };
+	float PreviousAlpha{ 0.f };
+	for (int32 Step{ 1 }; Step <= NumSteps; ++Step)
+	{
+		const float Alpha{ float(Step) / NumSteps };
+		const int32 Tile{ TileAt(Alpha) };
+		if (Tile != PreviousTile)
+		{
+			if (Tile == INDEX_NONE || !PathFilter.IsTraversalAllowed(PreviousTile, Tile))
+			{
+				// A few bisection steps between the last good sample and this one find the border of the tile
+				float GoodAlpha{ PreviousAlpha };
+				float BadAlpha{ Alpha };
+				for (int32 Iteration{ 0 }; Iteration < 8; ++Iteration)
+				{
+					const float MidAlpha{ 0.5f * (GoodAlpha + BadAlpha) };
+					if (TileAt(MidAlpha) == PreviousTile)
+					{
+						GoodAlpha = MidAlpha;
+					}
+					else
+					{
+						BadAlpha = MidAlpha;
+					}
+				}
+				HitLocation = FMath::Lerp(RayStart, RayEnd, GoodAlpha);
+				return true;
+			}
+			PreviousTile = Tile;
+		}
+		PreviousAlpha = Alpha;
+	}
+
+	HitLocation = RayEnd;
+	return false;
+}
+
+void AGraphAStarNavMesh::ConditionalConstructGenerator()
+{
+	if (!bSkipRecastGeneration)
+	{
+		Super::ConditionalConstructGenerator();
+		return;
+	}
+
+	// Without a generator nothing builds the Recast tiles, the grids are the navigation data
+	if (NavDataGenerator.IsValid())
+	{
+		NavDataGenerator->CancelBuild();
+		NavDataGenerator.Reset();
+	}
+}
+
+#if WITH_EDITOR
+void AGraphAStarNavMesh::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (PropertyChangedEvent.GetPropertyName() == GET_MEMBER_NAME_CHECKED(AGraphAStarNavMesh, bSkipRecastGeneration))
+	{
+		ConditionalConstructGenerator();
+		if (!bSkipRecastGeneration)
+		{
+			RebuildAll();
+		}
+	}
+}
+#endif
+//==== END OF ANavigationData queries ====
+
+
+//==== Repath on tile change ====
+
+void AGraphAStarNavMesh::ForEachPathTile(const FHexNavMeshPath &Path, TFunctionRef<void(FHexNavGrid &, int32)> Func) const
+{
+	TArray<int32> PathIndices;
+	TArray<FHexPathGridSpan> Spans;
+	if (!HexGrid || !Path.PathCode.Decode(*HexGrid, PathIndices, Spans))
+	{
+		return;
+	}
+
+	int32 FirstTile{ 0 };
+	for (const FHexPathGridSpan &Span : Spans)
+	{
+		// The grid could have been unregistered in the meantime
+		const int32 Slot{ GetNavGridSlot(Span.Grid) };
+		for (int32 Step{ FirstTile }; Slot != INDEX_NONE && Step < FirstTile + Span.NumTiles; ++Step)
+		{
+			Func(*NavGrids[Slot], PathIndices[Step]);
+		}
+		FirstTile += Span.NumTiles;
+	}
+}
+
+void AGraphAStarNavMesh::RegisterHexPath(const FNavPathSharedPtr &Path) const
+{
+	const FHexNavMeshPath *HexPath{ Path.IsValid() ? Path->CastPath<FHexNavMeshPath>() : nullptr };
+	if (!HexPath)
+	{
+		return;
+	}
+
+	FScopeLock Lock(&TilePathsLock);
+
+	const FNavPathWeakPtr WeakPath{ Path };
+	ForEachPathTile(*HexPath, [&WeakPath](FHexNavGrid &NavGrid, const int32 TileIndex)
+	{
+		if (NavGrid.TilePaths.Num() < NavGrid.Grid->GetNumTiles())
+		{
+			NavGrid.TilePaths.SetNum(NavGrid.Grid->GetNumTiles());
+		}
+
+		if (NavGrid.TilePaths.IsValidIndex(TileIndex))
+		{
+			// Paths don't unregister when they die, so we clean the bucket while we are here.
+			TArray<FNavPathWeakPtr> &Bucket{ NavGrid.TilePaths[TileIndex] };
+			Bucket.RemoveAllSwap([](const FNavPathWeakPtr &Other) { return !Other.IsValid(); }, false);
+			Bucket.Add(WeakPath);
+		}
+	});
+}
+
+void AGraphAStarNavMesh::UnregisterHexPath(FHexNavMeshPath &Path) const
+{
+	FScopeLock Lock(&TilePathsLock);
+
+	Path.bInvalidationPending = false;
+
+	ForEachPathTile(Path, [&Path](FHexNavGrid &NavGrid, const int32 TileIndex)
+	{
+		if (NavGrid.TilePaths.IsValidIndex(TileIndex))
+		{
+			NavGrid.TilePaths[TileIndex].RemoveAllSwap([&Path](const FNavPathWeakPtr &Other)
+			{
+				return !Other.IsValid() || Other.HasSameObject(static_cast<const FNavigationPath *>(&Path));
+			}, false);
+		}
+	});
+}
+
+void AGraphAStarNavMesh::InvalidatePathsOnTiles(FHexNavGrid &NavGrid, const TArray<int32> &DirtyTiles)
+{
+	const bool bDelayed{ PathInvalidationDelay > 0.f };
+
+	// Collect the affected paths first, a path crossing many dirty tiles must be invalidated once.
+	TArray<FNavPathSharedPtr> AffectedPaths;
+	TSet<const FNavigationPath *> VisitedPaths;
+	{
+		FScopeLock Lock(&TilePathsLock);
+
+		for (const int32 TileIndex : DirtyTiles)
+		{
+			if (!NavGrid.TilePaths.IsValidIndex(TileIndex))
+			{
+				continue;
+			}
+
+			for (const FNavPathWeakPtr &WeakPath : NavGrid.TilePaths[TileIndex])
+			{
+				FNavPathSharedPtr Path{ WeakPath.Pin() };
+				if (!Path.IsValid() || !Path->IsUpToDate())
+				{
+					continue;
+				}
+
+				bool bAlreadyVisited{ false };
+				VisitedPaths.Add(Path.Get(), &bAlreadyVisited);
+				if (bAlreadyVisited)
+				{
+					continue;
+				}
+
+				// Already queued by a previous edit, its invalidation covers this one too
+				FHexNavMeshPath *HexPath{ Path->CastPath<FHexNavMeshPath>() };
+				if (HexPath->bInvalidationPending)
+				{
+					continue;
+				}
+				HexPath->bInvalidationPending = bDelayed;
+
+				AffectedPaths.Add(MoveTemp(Path));
+			}
+		}
+	}
+
+	for (const FNavPathSharedPtr &Path : AffectedPaths)
+	{
+		if (bDelayed)
+		{
+			// Still registered, so the edits of the next frames keep finding it until the invalidation runs
+			FHexPendingPathInvalidation &Pending{ PendingPathInvalidations.AddDefaulted_GetRef() };
+			Pending.Path = Path;
+			Pending.InvalidationTime = GetWorldTimeStamp() + PathInvalidationDelay;
+		}
+		else
+		{
+			InvalidateHexPath(Path);
+		}
+	}
+}
+
+void AGraphAStarNavMesh::InvalidateHexPath(const FNavPathSharedPtr &Path)
+{
+	// The path will register again with its new tiles when it's recomputed.
+	UnregisterHexPath(*Path->CastPath<FHexNavMeshPath>());
+
+	// Engine path observers (the PathFollowingComponent) receive ENavPathEvent::Invalidated
+	// and the path asks us a repath because of bDoAutoUpdateOnInvalidation.
+	Path->Invalidate();
+}
+
+void AGraphAStarNavMesh::FlushCostBlends()
+{
+	const TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> Capture{ GetQueryCapture() };
+	for (const TUniquePtr<FHexNavGrid> &NavGrid : NavGrids)
+	{
+		UpdateCostBlends(*NavGrid);
+
+		// The layers the next queries will see
+		if (Capture)
+		{
+			Capture->RecordCostLayers(*NavGrid->Grid);
+		}
+	}
+}
+
+void AGraphAStarNavMesh::TickActor(float DeltaTime, enum ELevelTick TickType, FActorTickFunction &ThisTickFunction)
+{
+	Super::TickActor(DeltaTime, TickType, ThisTickFunction);
+
+	UpdateOccupancy();
+
+	// Gameplay updated the cost layers during the frame, the next queries get the new blends
+	FlushCostBlends();
+
+	// Spread the delayed invalidations across frames, so a big edit doesn't repath everyone in the same tick.
+	const float Now{ GetWorldTimeStamp() };
+	int32 NumProcessed{ 0 };
+	while (NumProcessed < PendingPathInvalidations.Num()
+		&& PendingPathInvalidations[NumProcessed].InvalidationTime <= Now
+		&& (MaxPathInvalidationsPerTick <= 0 || NumProcessed < MaxPathInvalidationsPerTick))
+	{
+		FNavPathSharedPtr Path{ PendingPathInvalidations[NumProcessed].Path.Pin() };
+		++NumProcessed;
+
+		if (!Path.IsValid())
+		{
+			continue;
+		}
+
+		// A repath in the meantime already sees the edit
+		bool bStillPending;
+		{
+			FScopeLock Lock(&TilePathsLock);
+			bStillPending = Path->CastPath<FHexNavMeshPath>()->bInvalidationPending;
+		}
+		if (bStillPending)
+		{
+			InvalidateHexPath(Path);
+		}
+	}
+
+	if (NumProcessed > 0)
+	{
+		PendingPathInvalidations.RemoveAt(0, NumProcessed, false);
+	}
+}
+//==== END OF Repath on tile change ====
+
+
+//==== Path codes ====
+
+FVector AGraphAStarNavMesh::GetTilePathLocation(const int32 TileIndex) const
+{
+	return GetTilePathLocation(*HexGrid, TileIndex);
+}
+
+FVector AGraphAStarNavMesh::GetTilePathLocation(AHexGrid &Grid, const int32 TileIndex) const
+{
+	// Get a temporary Cube Coordinate from our grid
+	const FHCubeCoord GridCoord{ Grid.GetTileCoord(TileIndex) };
+
+	// Because we can create HexGrid with only Cube Coordinates and no tiles
+	// we look if the current index we are using is a tile with tile data
+	if (Grid.HasTileData(TileIndex))
+	{
+		// If the index is valid (so we have a grid with tiles) we compute the Location
+		// of the PathPoint, we use the World Space coordinates of the current Cube Coordinate
+		// as a base location and we add an offset to the Z.
+		// How to compute the Z axis of the path is up to you, this is only an example!
+		return Grid.HexToWorld(GridCoord) + FVector(0.f, 0.f, Grid.GetTileCost(TileIndex) + PathPointZOffset);
+	}
+
+	// If the current index has no tile data
+	// (so we assume our grid is only a "logical" grid with only cube coordinates and no tiles)
+	// we simply transform the coordinates from cube space to world space
+	return Grid.HexToWorld(GridCoord);
+}
+
+bool AGraphAStarNavMesh::DecodePathCode(const FHexPathCode &PathCode, TArray<int32> &OutPathIndices, TArray<FHexPathGridSpan> &OutSpans) const
+{
+	if (!HexGrid || !PathCode.Decode(*HexGrid, OutPathIndices, OutSpans))
+	{
+		return false;
+	}
+
+	// A grid that isn't ours has no tiles registered for the invalidation, don't use it
+	return !OutSpans.ContainsByPredicate([this](const FHexPathGridSpan &Span) { return GetNavGridSlot(Span.Grid) == INDEX_NONE; });
+}
+
+void AGraphAStarNavMesh::AddPathPoints(FHexNavMeshPath &Path, const TArray<int32> &PathIndices, const TArray<FHexPathGridSpan> &Spans) const
+{
+	if (PathIndices.Num() == 0 || Spans.Num() == 0)
+	{
+		return;
+	}
+
+	if (!Path.bPathPointsDecoded)
+	{
+		Path.GetPathPoints().Add(FNavPathPoint(GetTilePathLocation(*Spans.Last().Grid, PathIndices.Last())));
+		return;
+	}
+
+	Path.GetPathPoints().Reserve(PathIndices.Num() + 1);
+
+	int32 Step{ 0 };
+	for (const FHexPathGridSpan &Span : Spans)
+	{
+		for (int32 SpanStep{ 0 }; SpanStep < Span.NumTiles; ++SpanStep, ++Step)
+		{
+			// Compute the world location of the tile (see GetTilePathLocation) and add it to the Path::PathPoints array
+			Path.GetPathPoints().Add(FNavPathPoint(GetTilePathLocation(*Span.Grid, PathIndices[Step])));
+		}
+	}
+}
+
+bool AGraphAStarNavMesh::DecodePathPoints(FHexNavMeshPath &Path) const
+{
+	if (Path.bPathPointsDecoded || Path.GetPathPoints().Num() == 0)
+	{
+		return true;
+	}
+
+	TArray<int32> PathIndices;
+	TArray<FHexPathGridSpan> Spans;
+	if (!DecodePathCode(Path.PathCode, PathIndices, Spans))
+	{
+		return false;
+	}
+
+	// Keep the start, it's the location of the query and not a tile
+	Path.GetPathPoints().SetNum(1);
+	Path.bPathPointsDecoded = true;
+	AddPathPoints(Path, PathIndices, Spans);
+	return true;
+}
+
+bool FHexNavMeshPath::DecodePathPoints()
+{
+	const AGraphAStarNavMesh *NavMesh{ Cast<const AGraphAStarNavMesh>(GetNavigationDataUsed()) };
+	return NavMesh && NavMesh->DecodePathPoints(*this);
+}
+
+FNavPathSharedPtr AGraphAStarNavMesh::CreatePathFromCode(const FHexPathCode &PathCode, const FVector &StartLocation) const
+{
+	TArray<int32> PathIndices;
+	TArray<FHexPathGridSpan> Spans;
+	if (!DecodePathCode(PathCode, PathIndices, Spans))
+	{
+		return nullptr;
+	}
+
+	const FVector EndLocation{ PathIndices.Num() > 0 ? GetTilePathLocation(*Spans.Last().Grid, PathIndices.Last()) : StartLocation };
+	const FPathFindingQuery Query(nullptr, *this, StartLocation, EndLocation);
+	FNavPathSharedPtr Path{ CreatePathInstance<FHexNavMeshPath>(Query) };
+	FHexNavMeshPath *HexPath{ Path.IsValid() ? Path->CastPath<FHexNavMeshPath>() : nullptr };
+	if (!HexPath)
+	{
+		return nullptr;
+	}
+
+	// Same costs FindPath would sum for these tiles, with the cost model of the query that found them
+	HexPath->PrefixCosts.Reserve(PathIndices.Num() + 1);
+	HexPath->PrefixCosts.Add(0.f);
+
+	int32 Step{ 0 };
+	int32 PreviousSlot{ INDEX_NONE };
+	for (const FHexPathGridSpan &Span : Spans)
+	{
+		const int32 Slot{ GetNavGridSlot(Span.Grid) };
+		const FHexNavGrid &NavGrid{ *NavGrids[Slot] };
+		const FHexCompiledFilterProfilePtr Profile{ FindFilterProfile(NavGrid, PathCode.FilterClass) };
+		FGridPathFilter PathFilter(*this, Profile, Span.Grid);
+		PathFilter.SetBlendedCosts(GetBlendedCosts(NavGrid, Profile.Get()));
+
+		for (int32 SpanStep{ 0 }; SpanStep < Span.NumTiles; ++SpanStep, ++Step)
+		{
+			const int32 TileIndex{ PathIndices[Step] };
+			float StepCost{ 0.f };
+			const int32 FromTile{ Step > 0 ? PathIndices[Step - 1] : PathCode.StartIndex };
+			if (PreviousSlot != INDEX_NONE && SpanStep == 0)
+			{
+				// The connection we took, the cheapest one between these two tiles like the search would
+				float HopCost{ TNumericLimits<float>::Max() };
+				for (const FGridLink &Link : GridLinks)
+				{
+					if (Link.FromSlot == PreviousSlot && Link.FromTile == FromTile && Link.ToSlot == Slot && Link.ToTile == TileIndex)
+					{
+						HopCost = FMath::Min(HopCost, Link.Cost);
+					}
+				}
+
+				if (HopCost == TNumericLimits<float>::Max())
+				{
+					return nullptr;
+				}
+				StepCost = HopCost + PathFilter.GetTraversalCost(TileIndex, TileIndex);
+			}
+			else
+			{
+				StepCost = PathFilter.GetTraversalCost(FromTile, TileIndex);
+			}
+			HexPath->PrefixCosts.Add(HexPath->PrefixCosts.Last() + StepCost);
+		}
+		PreviousSlot = Slot;
+	}
+	HexPath->CurrentPathCost = HexPath->PrefixCosts.Last();
+	HexPath->PathCode = PathCode;
+
+	HexPath->GetPathPoints().Add(FNavPathPoint(StartLocation));
+	AddPathPoints(*HexPath, PathIndices, Spans);
+
+	RegisterHexPath(Path);
+	Path->MarkReady();
+	return Path;
+}
+//==== END OF Path codes ====
+
+
+//==== Path preview ====
+
+bool AGraphAStarNavMesh::PreviewPath(const FVector &StartLocation, const FVector &GoalLocation, TSubclassOf<UNavigationQueryFilter> FilterClass,
+	TArray<FVector> &OutPathPoints, float &OutPathCost)
+{
+	OutPathPoints.Reset();
+	OutPathCost = 0.f;
+
+	int32 StartIdx{ INDEX_NONE };
+	int32 GoalIdx{ INDEX_NONE };
+	const FHexNavGrid *NavGrid{ HexGrid ? FindNavGridAt(StartLocation, StartIdx) : nullptr };
+	if (!NavGrid || StartIdx == INDEX_NONE || FindNavGridAt(GoalLocation, GoalIdx) != NavGrid || GoalIdx == INDEX_NONE)
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASQuery);
+
+	AHexGrid &Grid{ *NavGrid->Grid };
+	const FHexCompiledFilterProfilePtr Profile{ FilterClass ? FindFilterProfile(*NavGrid, GetQueryFilter(FilterClass)) : nullptr };
+	const TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> BlendedCosts{ GetBlendedCosts(*NavGrid, Profile.Get()) };
+
+	// The tree of this start and cost model if we still have it, otherwise the least recently used one starts again
+	FHexPathPreview *Preview{ nullptr };
+	for (const TUniquePtr<FHexPathPreview> &Candidate : PathPreviews)
+	{
+		if (Candidate->IsValidFor(Grid, Profile, BlendedCosts, StartIdx))
+		{
+			Preview = Candidate.Get();
+			break;
+		}
+	}
+
+	if (!Preview)
+	{
+		if (PathPreviews.Num() < MaxPathPreviews)
+		{
+			Preview = PathPreviews.Add_GetRef(MakeUnique<FHexPathPreview>()).Get();
+		}
+		else
+		{
+			Preview = PathPreviews[0].Get();
+			for (const TUniquePtr<FHexPathPreview> &Candidate : PathPreviews)
+			{
+				if (Candidate->LastUsedFrame < Preview->LastUsedFrame)
+				{
+					Preview = Candidate.Get();
+				}
+			}
+		}
+		Preview->Reset(Grid, Profile, BlendedCosts, StartIdx);
+	}
+	Preview->LastUsedFrame = GFrameCounter;
+
+	// Occupancy changes every frame, with it the tree would be thrown away at each hover
+	FGridPathFilter PathFilter(*this, Profile, &Grid);
+	PathFilter.CongestionWeight = 0.f;
+	PathFilter.SetBlendedCosts(BlendedCosts);
+
+	TArray<int32> PathIndices;
+	if (Preview->FindPath(PathFilter, GoalIdx, PathIndices, OutPathCost) != SearchSuccess)
+	{
+		return false;
+	}
+
+	// Same points of FindPath
+	OutPathPoints.Reserve(PathIndices.Num() + 1);
+	OutPathPoints.Add(StartLocation);
+	for (const int32 PathIndex : PathIndices)
+	{
+		OutPathPoints.Add(GetTilePathLocation(Grid, PathIndex));
+	}
+	return true;
+}
+
+void AGraphAStarNavMesh::ClearPathPreviews()
+{
+	PathPreviews.Reset();
+}
+//==== END OF Path preview ====
+
+
+//==== Path query capture ====
+
+bool AGraphAStarNavMesh::StartPathQueryCapture(const FString &FileName)
+{
+	StopPathQueryCapture();
+
+	if (!HexGrid)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("AGraphAStarNavMesh::StartPathQueryCapture(...) no HexGrid to capture"));
+		return false;
+	}
+
+	const FString FullFileName{ FPaths::IsRelative(FileName) ? FPaths::ProjectSavedDir() / TEXT("HexPathCaptures") / FileName : FileName };
+	TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> Capture{ FHexPathQueryCapture::Start(FullFileName, *this) };
+	if (!Capture)
+	{
+		return false;
+	}
+
+	UE_LOG(LogGraphAStarExample_NavMesh, Log, TEXT("AGraphAStarNavMesh::StartPathQueryCapture(...) recording to %s"), *FullFileName);
+
+	FScopeLock Lock(&QueryCaptureLock);
+	QueryCapture = Capture;
+	return true;
+}
+
+void AGraphAStarNavMesh::StopPathQueryCapture()
+{
+	TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> Capture;
+	{
+		FScopeLock Lock(&QueryCaptureLock);
+		Swap(Capture, QueryCapture);
+	}
+
+	// A query still running could hold a reference, Stop closes the file anyway
+	if (Capture)
+	{
+		Capture->Stop();
+	}
+}
+
+bool AGraphAStarNavMesh::IsCapturingPathQueries() const
+{
+	FScopeLock Lock(&QueryCaptureLock);
+	return QueryCapture.IsValid();
+}
+
+void AGraphAStarNavMesh::StopPathQueryCaptureOnGridsChange()
+{
+	// The snapshot at the start of the capture is about the old grids
+	if (IsCapturingPathQueries())
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("AGraphAStarNavMesh: grids or connections changed, path query capture stopped"));
+		StopPathQueryCapture();
+	}
+}
+
+TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> AGraphAStarNavMesh::GetQueryCapture() const
+{
+	FScopeLock Lock(&QueryCaptureLock);
+	return QueryCapture;
+}
+//==== END OF Path query capture ====
+
+
+//==== Occupancy ====
+
+void AGraphAStarNavMesh::RegisterOccupant(AActor *Occupant)
+{
+	if (!Occupant || Occupants.Contains(Occupant))
+	{
+		return;
+	}
+
+	Occupants.Add(Occupant);
+	OccupantTiles.Add(INDEX_NONE);
+	OccupantNext.Add(INDEX_NONE);
+	OccupantPrev.Add(INDEX_NONE);
+}
+
+void AGraphAStarNavMesh::UnregisterOccupant(AActor *Occupant)
+{
+	const int32 Slot{ Occupants.IndexOfByKey(Occupant) };
+	if (Slot != INDEX_NONE)
+	{
+		RemoveOccupantAt(Slot);
+	}
+}
+
+void AGraphAStarNavMesh::RemoveOccupantAt(int32 Slot)
+{
+	UnlinkOccupant(Slot);
+
+	// Swap remove, so the last slot takes our place and we have to fix its links
+	const int32 LastSlot{ Occupants.Num() - 1 };
+	const int32 LastTile{ OccupantTiles[LastSlot] };
+	if (Slot != LastSlot)
+	{
+		UnlinkOccupant(LastSlot);
+	}
+
+	Occupants.RemoveAtSwap(Slot, 1, false);
+	OccupantTiles.RemoveAtSwap(Slot, 1, false);
+	OccupantNext.RemoveAtSwap(Slot, 1, false);
+	OccupantPrev.RemoveAtSwap(Slot, 1, false);
+
+	if (Slot != LastSlot)
+	{
+		LinkOccupant(Slot, LastTile);
+	}
+}
+
+void AGraphAStarNavMesh::LinkOccupant(int32 Slot, int32 TileIndex)
+{
+	OccupantTiles[Slot] = TileIndex;
+	OccupantPrev[Slot] = INDEX_NONE;
+	OccupantNext[Slot] = INDEX_NONE;
+
+	if (!TileOccupancy.IsValidIndex(TileIndex))
+	{
+		return;
+	}
+
+	// Push front
+	OccupantNext[Slot] = TileFirstOccupant[TileIndex];
+	if (OccupantNext[Slot] != INDEX_NONE)
+	{
+		OccupantPrev[OccupantNext[Slot]] = Slot;
+	}
+	TileFirstOccupant[TileIndex] = Slot;
+
+	FPlatformAtomics::InterlockedIncrement(&TileOccupancy[TileIndex]);
+}
+
+void AGraphAStarNavMesh::UnlinkOccupant(int32 Slot)
+{
+	const int32 TileIndex{ OccupantTiles[Slot] };
+	if (TileOccupancy.IsValidIndex(TileIndex))
+	{
+		if (OccupantPrev[Slot] != INDEX_NONE)
+		{
+			OccupantNext[OccupantPrev[Slot]] = OccupantNext[Slot];
+		}
+		else
+		{
+			TileFirstOccupant[TileIndex] = OccupantNext[Slot];
+		}
+
+		if (OccupantNext[Slot] != INDEX_NONE)
+		{
+			OccupantPrev[OccupantNext[Slot]] = OccupantPrev[Slot];
+		}
+
+		FPlatformAtomics::InterlockedDecrement(&TileOccupancy[TileIndex]);
+	}
+
+	OccupantTiles[Slot] = INDEX_NONE;
+	OccupantPrev[Slot] = INDEX_NONE;
+	OccupantNext[Slot] = INDEX_NONE;
+}
+
+void AGraphAStarNavMesh::UpdateOccupancy()
+{
+	if (!HexGrid)
+	{
+		return;
+	}
+
+	// New grid (or first tick), everybody is relinked below
+	const int32 NumNodes{ HexGrid->GetNumTiles() };
+	if (TileOccupancy.Num() != NumNodes)
+	{
+		TileOccupancy.Init(0, NumNodes);
+		TileFirstOccupant.Init(INDEX_NONE, NumNodes);
+		for (int32 Slot{ 0 }; Slot < Occupants.Num(); ++Slot)
+		{
+			OccupantTiles[Slot] = INDEX_NONE;
+			OccupantPrev[Slot] = INDEX_NONE;
+			OccupantNext[Slot] = INDEX_NONE;
+		}
+	}
+
+	// Forget the destroyed agents
+	for (int32 Slot{ Occupants.Num() - 1 }; Slot >= 0; --Slot)
+	{
+		if (!Occupants[Slot].IsValid())
+		{
+			RemoveOccupantAt(Slot);
+		}
+	}
+
+	// Gather the locations on the game thread...
+	OccupantLocations.SetNumUninitialized(Occupants.Num(), false);
+	for (int32 Slot{ 0 }; Slot < Occupants.Num(); ++Slot)
+	{
+		OccupantLocations[Slot] = Occupants[Slot]->GetActorLocation();
+	}
+
+	// ...convert them to tiles in parallel, it's pure math on the grid layout...
+	NewOccupantTiles.SetNumUninitialized(Occupants.Num(), false);
+	ParallelFor(Occupants.Num(), [this](int32 Slot)
+	{
+		NewOccupantTiles[Slot] = HexGrid->GetCoordIndex(HexGrid->WorldToHex(OccupantLocations[Slot]));
+	}, Occupants.Num() < 256);
+
+	// ...and move only the agents that changed tile.
+	for (int32 Slot{ 0 }; Slot < Occupants.Num(); ++Slot)
+	{
+		if (NewOccupantTiles[Slot] != OccupantTiles[Slot])
+		{
+			UnlinkOccupant(Slot);
+			LinkOccupant(Slot, NewOccupantTiles[Slot]);
+		}
+	}
+}
+
+int32 AGraphAStarNavMesh::GetTileOccupancy(int32 TileIndex) const
+{
+	return TileOccupancy.IsValidIndex(TileIndex) ? FPlatformAtomics::AtomicRead(&TileOccupancy[TileIndex]) : 0;
+}
+
+void AGraphAStarNavMesh::GetTileOccupants(int32 TileIndex, TArray<AActor *> &OutOccupants) const
+{
+	OutOccupants.Reset();
+	if (!TileFirstOccupant.IsValidIndex(TileIndex))
+	{
+		return;
+	}
+
+	for (int32 Slot{ TileFirstOccupant[TileIndex] }; Slot != INDEX_NONE; Slot = OccupantNext[Slot])
+	{
+		if (AActor *Occupant{ Occupants[Slot].Get() })
+		{
+			OutOccupants.Add(Occupant);
+		}
+	}
+}
+//==== END OF Occupancy ====
+
 
 //////////////////////////////////////////////////////////////////////////
 // FGraphAStar: TGraph
 // Functions implementation for our FGraphAStar struct
 int32 AGraphAStarNavMesh::GetNeighbourCount(FNodeRef NodeRef) const
 {
-	return 6;
+	// The grid is the real graph, we keep these for the code that searches the HexGrid through the navmesh
+	return HexGrid->GetNeighbourCount(NodeRef);
 }
 
 bool AGraphAStarNavMesh::IsValidRef(FNodeRef NodeRef) const
 {
-	return HexGrid->GridCoordinates.IsValidIndex(NodeRef);
+	return HexGrid->IsValidRef(NodeRef);
 }
 
 AGraphAStarNavMesh::FNodeRef
 AGraphAStarNavMesh::GetNeighbour(const FNodeRef NodeRef, const int32 NeiIndex) const
 {
-	FHCubeCoord Neigh{ HexGrid->GetNeighbor(HexGrid->GridCoordinates[NodeRef], HexGrid->GetDirection(NeiIndex)) };
-	return HexGrid->GridCoordinates.IndexOfByKey(Neigh);
+	return HexGrid->GetNeighbour(NodeRef, NeiIndex);
+}
+//////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////
+// Range queries
+bool AGraphAStarNavMesh::FindTilesInRange(const FHexRangeQuery &Query, FHexRangeResult &OutResult) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASRangeQuery);
+
+	OutResult.Reset();
+
+	if (!HexGrid)
+	{
+		return false;
+	}
+
+	// Same rules of the A* search, so a tile is in range only if FindPath could reach it within the budget.
+	const FGridPathFilter Filter(*this, FindFilterProfile(Query.FilterClass));
+
+	// Grid indices are compact so we can use dense arrays instead of maps.
+	const int32 NumNodes{ HexGrid->GetNumTiles() };
+	TArray<float> BestCost;
+	BestCost.Init(TNumericLimits<float>::Max(), NumNodes);
+	TArray<int32> Parents;
+	Parents.Init(INDEX_NONE, NumNodes);
+	TBitArray<> Settled(false, NumNodes);
+
+	struct FOpenNode
+	{
+		int32 NodeRef;
+		float Cost;
+	};
+	TArray<FOpenNode> OpenList;
+	const auto CheapestFirst{ [](const FOpenNode &A, const FOpenNode &B) { return A.Cost < B.Cost; } };
+
+	// Seed all the sources at cost 0, this is what makes it a multi-source search.
+	for (const int32 Source : Query.SourceIndices)
+	{
+		if (IsValidRef(Source) && BestCost[Source] > 0.f)
+		{
+			BestCost[Source] = 0.f;
+			OpenList.HeapPush(FOpenNode{ Source, 0.f }, CheapestFirst);
+		}
+	}
+
+	if (OpenList.Num() == 0)
+	{
+		return false;
+	}
+
+	while (OpenList.Num() > 0)
+	{
+		FOpenNode Current;
+		OpenList.HeapPop(Current, CheapestFirst, false);
+
+		// We don't update nodes in the heap, we push them again, so skip the stale entries.
+		if (Settled[Current.NodeRef])
+		{
+			continue;
+		}
+		Settled[Current.NodeRef] = true;
+
+		OutResult.TileIndices.Add(Current.NodeRef);
+		OutResult.Costs.Add(Current.Cost);
+		OutResult.ParentIndices.Add(Parents[Current.NodeRef]);
+
+		if (Query.MaxTiles > 0 && OutResult.TileIndices.Num() >= Query.MaxTiles)
+		{
+			break;
+		}
+
+		const int32 NeighbourCount{ GetNeighbourCount(Current.NodeRef) };
+		for (int32 NeiIndex{ 0 }; NeiIndex < NeighbourCount; ++NeiIndex)
+		{
+			const FNodeRef Neighbour{ GetNeighbour(Current.NodeRef, NeiIndex) };
+			if (!IsValidRef(Neighbour) || Settled[Neighbour] || !Filter.IsTraversalAllowed(Current.NodeRef, Neighbour))
+			{
+				continue;
+			}
+
+			const float NewCost{ Current.Cost + Filter.GetTraversalCost(Current.NodeRef, Neighbour) };
+			if (NewCost > Query.CostBudget || NewCost >= BestCost[Neighbour])
+			{
+				continue;
+			}
+
+			BestCost[Neighbour] = NewCost;
+			Parents[Neighbour] = Current.NodeRef;
+			OpenList.HeapPush(FOpenNode{ Neighbour, NewCost }, CheapestFirst);
+		}
+	}
+
+	return true;
+}
+
+void AGraphAStarNavMesh::FindTilesInRangeBatch(const TArray<FHexRangeQuery> &Queries, TArray<FHexRangeResult> &OutResults) const
+{
+	OutResults.SetNum(Queries.Num());
+
+	// Each query only reads the grid and writes its own result, so they can run on any worker thread.
+	ParallelFor(Queries.Num(), [this, &Queries, &OutResults](int32 QueryIndex)
+	{
+		FindTilesInRange(Queries[QueryIndex], OutResults[QueryIndex]);
+	});
 }
 //////////////////////////////////////////////////////////////////////////
@@ -13,3 +13,24 @@ AHGAIController::AHGAIController(const FObjectInitializer &ObjectInitializer /*=
 {
 
 }
+
+void AHGAIController::OnPossess(APawn *InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	if (UHGPathFollowingComponent *HGPathFollowing{ Cast<UHGPathFollowingComponent>(GetPathFollowingComponent()) })
+	{
+		HGPathFollowing->SetOccupant(GetPawn());
+	}
+}
+
+void AHGAIController::OnUnPossess()
+{
+	// Before Super, it clears the pawn
+	if (UHGPathFollowingComponent *HGPathFollowing{ Cast<UHGPathFollowingComponent>(GetPathFollowingComponent()) })
+	{
+		HGPathFollowing->SetOccupant(nullptr);
+	}
+
+	Super::OnUnPossess();
+}
@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HGCrowdFollowingSubsystem.h"
+#include "HGPathFollowingComponent.h"
+#include "GameFramework/NavMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+
+
+void UHGCrowdFollowingSubsystem::RegisterAgent(UHGPathFollowingComponent *Agent)
+{
+	if (!Agent || Agent->CrowdAgentIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	Agent->CrowdAgentIndex = Agents.Add(Agent);
+	CachedPaths.Add(nullptr);
+	SegmentIndices.Add(INDEX_NONE);
+	SegmentStarts.Add(FVector::ZeroVector);
+	SegmentEnds.Add(FVector::ZeroVector);
+	MoveVelocities.Add(FVector::ZeroVector);
+	ThinkTimes.Add(0.f);
+	ThinkIntervals.Add(0.f);
+
+	// From now on we tick it
+	Agent->SetComponentTickEnabled(false);
+}
+
+void UHGCrowdFollowingSubsystem::UnregisterAgent(UHGPathFollowingComponent *Agent)
+{
+	if (Agent && Agents.IsValidIndex(Agent->CrowdAgentIndex) && Agents[Agent->CrowdAgentIndex] == Agent)
+	{
+		RemoveAgentAt(Agent->CrowdAgentIndex);
+		Agent->SetComponentTickEnabled(true);
+	}
+}
+
+void UHGCrowdFollowingSubsystem::RemoveAgentAt(int32 AgentIndex)
+{
+	if (Agents[AgentIndex])
+	{
+		Agents[AgentIndex]->CrowdAgentIndex = INDEX_NONE;
+	}
+
+	// Swap remove keeps the arrays contiguous, only the last agent changes index.
+	Agents.RemoveAtSwap(AgentIndex, 1, false);
+	CachedPaths.RemoveAtSwap(AgentIndex, 1, false);
+	SegmentIndices.RemoveAtSwap(AgentIndex, 1, false);
+	SegmentStarts.RemoveAtSwap(AgentIndex, 1, false);
+	SegmentEnds.RemoveAtSwap(AgentIndex, 1, false);
+	MoveVelocities.RemoveAtSwap(AgentIndex, 1, false);
+	ThinkTimes.RemoveAtSwap(AgentIndex, 1, false);
+	ThinkIntervals.RemoveAtSwap(AgentIndex, 1, false);
+
+	if (Agents.IsValidIndex(AgentIndex) && Agents[AgentIndex])
+	{
+		Agents[AgentIndex]->CrowdAgentIndex = AgentIndex;
+	}
+}
+
+void UHGCrowdFollowingSubsystem::RefreshSegment(int32 AgentIndex)
+{
+	const UHGPathFollowingComponent *Agent{ Agents[AgentIndex] };
+	const FNavigationPath *Path{ Agent->Path.Get() };
+
+	CachedPaths[AgentIndex] = Path;
+	SegmentIndices[AgentIndex] = Agent->GetCurrentPathIndex();
+
+	// Read the points in place, no copy of FNavPathPoint
+	if (Path && Path->GetPathPoints().IsValidIndex(Agent->GetNextPathIndex()))
+	{
+		SegmentStarts[AgentIndex] = Path->GetPathPoints()[Agent->GetCurrentPathIndex()].Location;
+		SegmentEnds[AgentIndex] = Path->GetPathPoints()[Agent->GetNextPathIndex()].Location;
+	}
+}
+
+float UHGCrowdFollowingSubsystem::GetThinkInterval(float DistanceSquared) const
+{
+	if (DistanceSquared <= FMath::Square(NearDistance))
+	{
+		return 0.f;
+	}
+	if (DistanceSquared >= FMath::Square(FarDistance) || FarDistance <= NearDistance)
+	{
+		return FarThinkInterval;
+	}
+
+	const float Alpha{ (FMath::Sqrt(DistanceSquared) - NearDistance) / (FarDistance - NearDistance) };
+	return Alpha * FarThinkInterval;
+}
+
+void UHGCrowdFollowingSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HGCrowdFollowing);
+
+	UWorld *World{ GetWorld() };
+
+	// The LOD is based on the distance from the first local player camera, read once for everybody.
+	FVector ViewLocation{ FVector::ZeroVector };
+	bool bHasViewLocation{ false };
+	if (APlayerController *PlayerController{ World->GetFirstPlayerController() })
+	{
+		FRotator ViewRotation{};
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		bHasViewLocation = true;
+	}
+
+	for (int32 AgentIndex{ Agents.Num() - 1 }; AgentIndex >= 0; --AgentIndex)
+	{
+		UHGPathFollowingComponent *Agent{ Agents[AgentIndex] };
+
+		// Destroyed without EndPlay (GC), just drop it
+		if (!Agent)
+		{
+			RemoveAgentAt(AgentIndex);
+			continue;
+		}
+
+		if (Agent->GetStatus() != EPathFollowingStatus::Moving || !Agent->MovementComp)
+		{
+			continue;
+		}
+
+		const FNavigationPath *Path{ Agent->Path.Get() };
+		const bool bSegmentChanged{ Path != CachedPaths[AgentIndex] || Agent->GetCurrentPathIndex() != SegmentIndices[AgentIndex] };
+
+		// Not our turn to think, keep going with the last velocity
+		ThinkTimes[AgentIndex] += DeltaTime;
+		if (!bSegmentChanged && ThinkTimes[AgentIndex] < ThinkIntervals[AgentIndex])
+		{
+			Agent->MovementComp->RequestPathMove(MoveVelocities[AgentIndex]);
+			continue;
+		}
+		ThinkTimes[AgentIndex] = 0.f;
+
+		const FVector CurrentLocation{ Agent->MovementComp->GetActorFeetLocation() };
+
+		// Let the engine decide what to do if the path is gone, we are on the last segment
+		// (acceptance radius, deceleration...) or we are close to the end of the segment.
+		const bool bLastSegment{ !Path || Agent->GetNextPathIndex() >= Path->GetPathPoints().Num() - 1 };
+		const bool bNearSegmentEnd{ FVector::DistSquared2D(CurrentLocation, SegmentEnds[AgentIndex]) <= FMath::Square(SegmentReachRadius) };
+		if (!Path || !Path->IsValid() || bLastSegment || bNearSegmentEnd || bSegmentChanged)
+		{
+			Agent->UpdatePathSegment();
+
+			// Finished, aborted or waiting for a repath
+			if (Agent->GetStatus() != EPathFollowingStatus::Moving || !Agent->Path.IsValid() || !Agent->Path->IsValid())
+			{
+				continue;
+			}
+			RefreshSegment(AgentIndex);
+		}
+
+		// Same velocity of UPathFollowingComponent::FollowPathSegment, the movement component clamps it to its max speed.
+		MoveVelocities[AgentIndex] = (SegmentEnds[AgentIndex] - CurrentLocation) / FMath::Max(DeltaTime, KINDA_SMALL_NUMBER);
+		Agent->MovementComp->RequestPathMove(MoveVelocities[AgentIndex]);
+
+		ThinkIntervals[AgentIndex] = bHasViewLocation ? GetThinkInterval(FVector::DistSquared(ViewLocation, CurrentLocation)) : 0.f;
+
+#if ENABLE_DRAW_DEBUG
+		if (Agent->DrawDebug)
+		{
+			// Same drawing of the component FollowPathSegment, but batched
+			const TArray<FNavPathPoint> &PathPoints{ Agent->Path->GetPathPoints() };
+			for (int32 PointIndex{ 1 }; PointIndex < PathPoints.Num(); ++PointIndex)
+			{
+				DebugLines.Emplace(PathPoints[PointIndex - 1].Location, PathPoints[PointIndex].Location, FLinearColor::White, 0.f, 0.f, SDPG_World);
+			}
+
+			const FVector &Start{ SegmentStarts[AgentIndex] };
+			const FVector &End{ SegmentEnds[AgentIndex] };
+			DebugLines.Emplace(Start, Start + FVector(0.f, 0.f, 200.f), FLinearColor::Blue, 0.f, 0.f, SDPG_World);
+			DebugLines.Emplace(End, End + FVector(0.f, 0.f, 200.f), FLinearColor::Green, 0.f, 0.f, SDPG_World);
+		}
+#endif
+	}
+
+#if ENABLE_DRAW_DEBUG
+	// One call for the lines of the whole crowd
+	if (DebugLines.Num() > 0 && World->LineBatcher)
+	{
+		World->LineBatcher->DrawLines(DebugLines);
+		DebugLines.Reset();
+	}
+#endif
+}
+
+bool UHGCrowdFollowingSubsystem::IsTickable() const
+{
+	return Agents.Num() > 0 && !IsTemplate();
+}
+
+TStatId UHGCrowdFollowingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHGCrowdFollowingSubsystem, STATGROUP_Tickables);
+}
+
+UWorld *UHGCrowdFollowingSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
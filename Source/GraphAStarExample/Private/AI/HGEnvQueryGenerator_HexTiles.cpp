@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HGEnvQueryGenerator_HexTiles.h"
+#include "HGEnvQueryItemType_HexTile.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "HexGrid/HexGridQueryLibrary.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+
+#define LOCTEXT_NAMESPACE "HGEnvQueryGenerator"
+
+UHGEnvQueryGenerator_HexTiles::UHGEnvQueryGenerator_HexTiles(const FObjectInitializer &ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	ItemType = UHGEnvQueryItemType_HexTile::StaticClass();
+	GenerateAround = UEnvQueryContext_Querier::StaticClass();
+	Radius.DefaultValue = 3;
+	CostBudget.DefaultValue = 500.f;
+}
+
+void UHGEnvQueryGenerator_HexTiles::GenerateItems(FEnvQueryInstance &QueryInstance) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASEnvQuery);
+
+	UObject *QueryOwner{ QueryInstance.Owner.Get() };
+	const AGraphAStarNavMesh *NavMesh{ UHGEnvQueryItemType_HexTile::GetNavMesh(QueryOwner) };
+	if (!QueryOwner || !NavMesh || !NavMesh->HexGrid)
+	{
+		return;
+	}
+	const AHexGrid &Grid{ *NavMesh->HexGrid };
+
+	TArray<FVector> ContextLocations;
+	QueryInstance.PrepareContext(GenerateAround, ContextLocations);
+
+	TArray<int32> Centers;
+	for (const FVector &Location : ContextLocations)
+	{
+		const int32 TileIndex{ UHGEnvQueryItemType_HexTile::GetTileAt(*NavMesh, Location) };
+		if (TileIndex != INDEX_NONE)
+		{
+			Centers.AddUnique(TileIndex);
+		}
+	}
+
+	if (Centers.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<int32> Tiles;
+	if (Shape == EHexTileGeneratorShape::Reachable)
+	{
+		CostBudget.BindData(QueryOwner, QueryInstance.QueryID);
+
+		// A single flood from all the contexts, a tile is in once even if more contexts reach it
+		FHexRangeQuery Query;
+		Query.SourceIndices = Centers;
+		Query.CostBudget = CostBudget.GetValue();
+		Query.FilterClass = FilterClass;
+
+		FHexRangeResult Result;
+		NavMesh->FindTilesInRange(Query, Result);
+		Tiles = MoveTemp(Result.TileIndices);
+	}
+	else
+	{
+		Radius.BindData(QueryOwner, QueryInstance.QueryID);
+		const int32 TileRadius{ FMath::Max(Radius.GetValue(), 0) };
+
+		TArray<int32> ShapeTiles;
+		ShapeTiles.SetNumUninitialized(Shape == EHexTileGeneratorShape::Ring ? UHexGridQueryLibrary::GetRingCapacity(TileRadius) : UHexGridQueryLibrary::GetRangeCapacity(TileRadius));
+
+		// Shapes of different contexts can overlap, with a single context (the usual querier) there's nothing to merge
+		TBitArray<> Added;
+		if (Centers.Num() > 1)
+		{
+			Added.Init(false, Grid.GetNumTiles());
+		}
+
+		for (const int32 Center : Centers)
+		{
+			const int32 NumTiles{ Shape == EHexTileGeneratorShape::Ring
+				? UHexGridQueryLibrary::Ring(Grid, Grid.GetTileCoord(Center), TileRadius, ShapeTiles)
+				: UHexGridQueryLibrary::Range(Grid, Grid.GetTileCoord(Center), TileRadius, ShapeTiles) };
+
+			for (int32 ShapeIndex{ 0 }; ShapeIndex < NumTiles; ++ShapeIndex)
+			{
+				const int32 TileIndex{ ShapeTiles[ShapeIndex] };
+				if (bSkipBlockingTiles && Grid.IsTileBlocking(TileIndex))
+				{
+					continue;
+				}
+
+				if (Added.Num() > 0)
+				{
+					if (Added[TileIndex])
+					{
+						continue;
+					}
+					Added[TileIndex] = true;
+				}
+				Tiles.Add(TileIndex);
+			}
+		}
+	}
+
+	QueryInstance.ReserveItemData(Tiles.Num());
+	for (const int32 TileIndex : Tiles)
+	{
+		QueryInstance.AddItemData<UHGEnvQueryItemType_HexTile>(FNavLocation(NavMesh->GetTilePathLocation(TileIndex), NavNodeRef(TileIndex)));
+	}
+}
+
+FText UHGEnvQueryGenerator_HexTiles::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("HexTilesDescriptionTitle", "{0}: generate around {1}"),
+		Super::GetDescriptionTitle(), UEnvQueryTypes::DescribeContext(GenerateAround));
+}
+
+FText UHGEnvQueryGenerator_HexTiles::GetDescriptionDetails() const
+{
+	switch (Shape)
+	{
+	case EHexTileGeneratorShape::Ring:
+		return FText::Format(LOCTEXT("HexTilesDescriptionRing", "ring, radius: {0} tiles"), FText::FromString(Radius.ToString()));
+	case EHexTileGeneratorShape::Reachable:
+		return FText::Format(LOCTEXT("HexTilesDescriptionReachable", "reachable, cost budget: {0}"), FText::FromString(CostBudget.ToString()));
+	default:
+		return FText::Format(LOCTEXT("HexTilesDescriptionRange", "range, radius: {0} tiles"), FText::FromString(Radius.ToString()));
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HGEnvQueryItemType_HexTile.h"
+#include "GraphAStarNavMesh.h"
+#include "NavigationSystem.h"
+
+
+int32 UHGEnvQueryItemType_HexTile::GetTileIndex(const uint8 *RawData)
+{
+	const NavNodeRef NodeRef{ GetValue(RawData).NodeRef };
+	return NodeRef <= NavNodeRef(MAX_int32) ? int32(NodeRef) : INDEX_NONE;
+}
+
+AGraphAStarNavMesh *UHGEnvQueryItemType_HexTile::GetNavMesh(const UObject *WorldContextObject)
+{
+	UWorld *World{ GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) };
+	UNavigationSystemV1 *NavSys{ FNavigationSystem::GetCurrent<UNavigationSystemV1>(World) };
+	return NavSys ? Cast<AGraphAStarNavMesh>(NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate)) : nullptr;
+}
+
+int32 UHGEnvQueryItemType_HexTile::GetTileAt(const AGraphAStarNavMesh &NavMesh, const FVector &Location)
+{
+	// Items are indices of the HexGrid only (like the range queries), a tile of another registered grid doesn't count
+	int32 TileIndex{ INDEX_NONE };
+	const FHexNavGrid *NavGrid{ NavMesh.HexGrid ? NavMesh.FindNavGridAt(Location, TileIndex) : nullptr };
+	return NavGrid && NavGrid->Grid == NavMesh.HexGrid ? TileIndex : INDEX_NONE;
+}
@@ -0,0 +1,241 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HGEnvQueryTest_HexTile.h"
+#include "HGEnvQueryItemType_HexTile.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "HexGrid/HexFieldOfView.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+
+#define LOCTEXT_NAMESPACE "HGEnvQueryTest"
+
+UHGEnvQueryTest_HexTile::UHGEnvQueryTest_HexTile(const FObjectInitializer &ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// PathCost floods the grid, the others are a lookup for each item
+	Cost = EEnvTestCost::Medium;
+	ValidItemType = UHGEnvQueryItemType_HexTile::StaticClass();
+	Context = UEnvQueryContext_Querier::StaticClass();
+	SetWorkOnFloatValues(TestMode != EHexTileTest::LineOfSight);
+}
+
+void UHGEnvQueryTest_HexTile::RunTest(FEnvQueryInstance &QueryInstance) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Navigation_HGASEnvQuery);
+
+	UObject *QueryOwner{ QueryInstance.Owner.Get() };
+	const AGraphAStarNavMesh *NavMesh{ UHGEnvQueryItemType_HexTile::GetNavMesh(QueryOwner) };
+	if (!QueryOwner || !NavMesh || !NavMesh->HexGrid)
+	{
+		return;
+	}
+
+	FloatValueMin.BindData(QueryOwner, QueryInstance.QueryID);
+	const float MinThresholdValue{ FloatValueMin.GetValue() };
+
+	FloatValueMax.BindData(QueryOwner, QueryInstance.QueryID);
+	const float MaxThresholdValue{ FloatValueMax.GetValue() };
+
+	if (TestMode == EHexTileTest::Occupancy)
+	{
+		RunOccupancy(QueryInstance, *NavMesh, MinThresholdValue, MaxThresholdValue);
+		return;
+	}
+
+	TArray<FVector> ContextLocations;
+	if (!QueryInstance.PrepareContext(Context, ContextLocations))
+	{
+		return;
+	}
+
+	TArray<int32> ContextTiles;
+	for (const FVector &Location : ContextLocations)
+	{
+		const int32 TileIndex{ UHGEnvQueryItemType_HexTile::GetTileAt(*NavMesh, Location) };
+		if (TileIndex != INDEX_NONE)
+		{
+			ContextTiles.AddUnique(TileIndex);
+		}
+	}
+
+	if (ContextTiles.Num() == 0)
+	{
+		return;
+	}
+
+	switch (TestMode)
+	{
+	case EHexTileTest::PathCost:
+		RunPathCost(QueryInstance, *NavMesh, ContextTiles, MinThresholdValue, MaxThresholdValue);
+		break;
+	case EHexTileTest::Distance:
+		RunDistance(QueryInstance, *NavMesh->HexGrid, ContextTiles, MinThresholdValue, MaxThresholdValue);
+		break;
+	case EHexTileTest::LineOfSight:
+		BoolValue.BindData(QueryOwner, QueryInstance.QueryID);
+		RunLineOfSight(QueryInstance, *NavMesh->HexGrid, ContextTiles, BoolValue.GetValue());
+		break;
+	default:
+		break;
+	}
+}
+
+void UHGEnvQueryTest_HexTile::RunPathCost(FEnvQueryInstance &QueryInstance, const AGraphAStarNavMesh &NavMesh, const TArray<int32> &ContextTiles, const float MinThresholdValue, const float MaxThresholdValue) const
+{
+	const AHexGrid &Grid{ *NavMesh.HexGrid };
+
+	// With an upper threshold the tiles past it fail anyway, the flood doesn't need to go further.
+	// A score only test ignores FilterType (Range and a 0 maximum by default), it needs the whole flood
+	const bool bFilters{ TestPurpose != EEnvTestPurpose::Score };
+	const bool bHasMaximum{ bFilters && (FilterType == EEnvTestFilterType::Maximum || FilterType == EEnvTestFilterType::Range) };
+
+	FHexRangeQuery Query;
+	Query.SourceIndices = ContextTiles;
+	Query.CostBudget = bHasMaximum ? MaxThresholdValue : TNumericLimits<float>::Max();
+	Query.FilterClass = FilterClass;
+
+	FHexRangeResult Result;
+	NavMesh.FindTilesInRange(Query, Result);
+
+	// Scatter the flood on the grid indices, then each item is a single read
+	TArray<float> TileCosts;
+	TileCosts.Init(BIG_NUMBER, Grid.GetNumTiles());
+	for (int32 ResultIndex{ 0 }; ResultIndex < Result.TileIndices.Num(); ++ResultIndex)
+	{
+		TileCosts[Result.TileIndices[ResultIndex]] = Result.Costs[ResultIndex];
+	}
+
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const int32 TileIndex{ GetItemTile(QueryInstance, It.GetIndex()) };
+		const float PathCost{ TileCosts.IsValidIndex(TileIndex) ? TileCosts[TileIndex] : BIG_NUMBER };
+
+		// Only a filtering test has a budget, so past it the item fails either way. For a score only test it's really unreachable
+		if (bSkipUnreachable && PathCost >= BIG_NUMBER)
+		{
+			It.ForceItemState(EEnvItemStatus::Failed);
+			continue;
+		}
+
+		It.SetScore(TestPurpose, FilterType, PathCost, MinThresholdValue, MaxThresholdValue);
+	}
+}
+
+void UHGEnvQueryTest_HexTile::RunDistance(FEnvQueryInstance &QueryInstance, const AHexGrid &Grid, const TArray<int32> &ContextTiles, const float MinThresholdValue, const float MaxThresholdValue) const
+{
+	TArray<FHPackedCoord, TInlineAllocator<8>> ContextCoords;
+	for (const int32 ContextTile : ContextTiles)
+	{
+		ContextCoords.Add(Grid.GetPackedCoord(ContextTile));
+	}
+
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const int32 TileIndex{ GetItemTile(QueryInstance, It.GetIndex()) };
+		if (!Grid.IsValidRef(TileIndex))
+		{
+			It.ForceItemState(EEnvItemStatus::Failed);
+			continue;
+		}
+
+		const FHPackedCoord Coord{ Grid.GetPackedCoord(TileIndex) };
+		for (const FHPackedCoord &ContextCoord : ContextCoords)
+		{
+			It.SetScore(TestPurpose, FilterType, float(FHPackedCoord::Distance(Coord, ContextCoord)), MinThresholdValue, MaxThresholdValue);
+		}
+	}
+}
+
+void UHGEnvQueryTest_HexTile::RunOccupancy(FEnvQueryInstance &QueryInstance, const AGraphAStarNavMesh &NavMesh, const float MinThresholdValue, const float MaxThresholdValue) const
+{
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const int32 TileIndex{ GetItemTile(QueryInstance, It.GetIndex()) };
+		It.SetScore(TestPurpose, FilterType, float(NavMesh.GetTileOccupancy(TileIndex)), MinThresholdValue, MaxThresholdValue);
+	}
+}
+
+void UHGEnvQueryTest_HexTile::RunLineOfSight(FEnvQueryInstance &QueryInstance, const AHexGrid &Grid, const TArray<int32> &ContextTiles, const bool bWantsVisible) const
+{
+	// The fields only need to reach the farthest item
+	int32 FieldRadius{ 0 };
+	for (int32 ItemIndex{ 0 }; ItemIndex < QueryInstance.Items.Num(); ++ItemIndex)
+	{
+		const int32 TileIndex{ GetItemTile(QueryInstance, ItemIndex) };
+		if (Grid.IsValidRef(TileIndex))
+		{
+			const FHPackedCoord Coord{ Grid.GetPackedCoord(TileIndex) };
+			for (const int32 ContextTile : ContextTiles)
+			{
+				FieldRadius = FMath::Max(FieldRadius, FHPackedCoord::Distance(Coord, Grid.GetPackedCoord(ContextTile)));
+			}
+		}
+	}
+
+	// One shadowcast for each context, then each item is a bit lookup
+	TArray<FHexFieldOfView, TInlineAllocator<4>> FieldsOfView;
+	FieldsOfView.SetNum(ContextTiles.Num());
+	for (int32 ContextIndex{ 0 }; ContextIndex < ContextTiles.Num(); ++ContextIndex)
+	{
+		FieldsOfView[ContextIndex].Compute(Grid, ContextTiles[ContextIndex], FieldRadius);
+	}
+
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const int32 TileIndex{ GetItemTile(QueryInstance, It.GetIndex()) };
+		if (!Grid.IsValidRef(TileIndex))
+		{
+			It.ForceItemState(EEnvItemStatus::Failed);
+			continue;
+		}
+
+		const FHPackedCoord Coord{ Grid.GetPackedCoord(TileIndex) };
+		for (const FHexFieldOfView &FieldOfView : FieldsOfView)
+		{
+			It.SetScore(TestPurpose, FilterType, FieldOfView.IsVisible(Coord), bWantsVisible);
+		}
+	}
+}
+
+int32 UHGEnvQueryTest_HexTile::GetItemTile(const FEnvQueryInstance &QueryInstance, const int32 ItemIndex)
+{
+	return UHGEnvQueryItemType_HexTile::GetTileIndex(QueryInstance.RawData.GetData() + QueryInstance.Items[ItemIndex].DataOffset);
+}
+
+FText UHGEnvQueryTest_HexTile::GetDescriptionTitle() const
+{
+	const FText ModeDesc{ StaticEnum<EHexTileTest>()->GetDisplayNameTextByValue(int64(TestMode)) };
+	if (TestMode == EHexTileTest::Occupancy)
+	{
+		return FText::Format(LOCTEXT("HexTileTestTitleNoContext", "{0}: {1}"), Super::GetDescriptionTitle(), ModeDesc);
+	}
+
+	return FText::Format(LOCTEXT("HexTileTestTitle", "{0}: {1} to {2}"), Super::GetDescriptionTitle(), ModeDesc, UEnvQueryTypes::DescribeContext(Context));
+}
+
+FText UHGEnvQueryTest_HexTile::GetDescriptionDetails() const
+{
+	return TestMode == EHexTileTest::LineOfSight ? DescribeBoolTestParams(TEXT("visible")) : DescribeFloatTestParams();
+}
+
+void UHGEnvQueryTest_HexTile::PostLoad()
+{
+	Super::PostLoad();
+
+	SetWorkOnFloatValues(TestMode != EHexTileTest::LineOfSight);
+}
+
+#if WITH_EDITOR
+void UHGEnvQueryTest_HexTile::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (PropertyChangedEvent.Property && PropertyChangedEvent.Property->GetFName() == GET_MEMBER_NAME_CHECKED(UHGEnvQueryTest_HexTile, TestMode))
+	{
+		SetWorkOnFloatValues(TestMode != EHexTileTest::LineOfSight);
+	}
+}
+#endif
+
+#undef LOCTEXT_NAMESPACE
@@ -3,6 +3,7 @@
 
 #include "HGPathFollowingComponent.h"
 #include "DrawDebugHelpers.h"
+#include "HGCrowdFollowingSubsystem.h"
 
 
 void UHGPathFollowingComponent::BeginPlay()
@@ -11,6 +12,85 @@ void UHGPathFollowingComponent::BeginPlay()
 
 	// We cast the MyNavData parent class member so we can expose it to Blueprint.
 	GraphAStarNavMesh = Cast<AGraphAStarNavMesh>(MyNavData);
+
+	// In crowd mode the subsystem follows the path for us
+	if (bUseCrowdFollowing)
+	{
+		if (UHGCrowdFollowingSubsystem *CrowdFollowing{ GetWorld()->GetSubsystem<UHGCrowdFollowingSubsystem>() })
+		{
+			CrowdFollowing->RegisterAgent(this);
+		}
+	}
+}
+
+
+void UHGPathFollowingComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (CrowdAgentIndex != INDEX_NONE)
+	{
+		if (UHGCrowdFollowingSubsystem *CrowdFollowing{ GetWorld()->GetSubsystem<UHGCrowdFollowingSubsystem>() })
+		{
+			CrowdFollowing->UnregisterAgent(this);
+		}
+	}
+
+	SetOccupant(nullptr);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+FAIRequestID UHGPathFollowingComponent::RequestMove(const FAIMoveRequest &RequestData, FNavPathSharedPtr InPath)
+{
+	// Until now the path had only its start and its end, from here its repaths decode the new points too
+	if (FHexNavMeshPath *HexPath{ InPath.IsValid() ? InPath->CastPath<FHexNavMeshPath>() : nullptr })
+	{
+		if (!HexPath->DecodePathPoints())
+		{
+			UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("UHGPathFollowingComponent::RequestMove(...) the path doesn't match the grids of its navmesh"));
+			return FAIRequestID::InvalidRequest;
+		}
+	}
+
+	return Super::RequestMove(RequestData, InPath);
+}
+
+
+void UHGPathFollowingComponent::SetOccupant(APawn *NewOccupant)
+{
+	// Always the object we registered, even if the navmesh or the pawn changed since
+	if (AGraphAStarNavMesh *NavMesh{ RegisteredNavMesh.Get() })
+	{
+		NavMesh->UnregisterOccupant(RegisteredOccupant.Get(true));
+	}
+	RegisteredNavMesh.Reset();
+	RegisteredOccupant.Reset();
+
+	Occupant = NewOccupant;
+	RegisterOccupant();
+}
+
+
+void UHGPathFollowingComponent::OnNavigationInitDone()
+{
+	Super::OnNavigationInitDone();
+
+	// Possessed before the navigation was ready, now we have a navmesh
+	RegisterOccupant();
+}
+
+
+void UHGPathFollowingComponent::RegisterOccupant()
+{
+	GraphAStarNavMesh = Cast<AGraphAStarNavMesh>(MyNavData);
+
+	// Let the navmesh know where our pawn is, paths avoid the crowded tiles when CongestionCostWeight > 0
+	if (bRegisterAsOccupant && GraphAStarNavMesh && Occupant.IsValid() && !RegisteredOccupant.IsValid())
+	{
+		GraphAStarNavMesh->RegisterOccupant(Occupant.Get());
+		RegisteredNavMesh = GraphAStarNavMesh;
+		RegisteredOccupant = Occupant;
+	}
 }
 
 
@@ -39,20 +119,19 @@ void UHGPathFollowingComponent::FollowPathSegment(float DeltaTime)
 	 * Let me show you a simple example with some debug drawings.
 	 */
 
-	if (Path && DrawDebug)
+	if (Path && DrawDebug && Path->GetPathPoints().IsValidIndex(GetNextPathIndex()))
 	{
 		// Just draw the current path
 		Path->DebugDraw(MyNavData, FColor::White, nullptr, false);
 		
 		// Draw the start point of the current path segment we are traveling.
-		FNavPathPoint CurrentPathPoint{};
-		FNavigationPath::GetPathPoint(&Path->AsShared().Get(), GetCurrentPathIndex(), CurrentPathPoint);
+		// (we read the path points in place, with many agents use bUseCrowdFollowing, it batches all the debug lines)
+		const FNavPathPoint &CurrentPathPoint{ Path->GetPathPoints()[GetCurrentPathIndex()] };
 		DrawDebugLine(GetWorld(), CurrentPathPoint.Location, CurrentPathPoint.Location + FVector(0.f, 0.f, 200.f), FColor::Blue);
 		DrawDebugSphere(GetWorld(), CurrentPathPoint.Location + FVector(0.f, 0.f, 200.f), 25.f, 16, FColor::Blue);
 
 		// Draw the end point of the current path segment we are traveling.
-		FNavPathPoint NextPathPoint{};
-		FNavigationPath::GetPathPoint(&Path->AsShared().Get(), GetNextPathIndex(), NextPathPoint);
+		const FNavPathPoint &NextPathPoint{ Path->GetPathPoints()[GetNextPathIndex()] };
 		DrawDebugLine(GetWorld(), NextPathPoint.Location, NextPathPoint.Location + FVector(0.f, 0.f, 200.f), FColor::Green);
 		DrawDebugSphere(GetWorld(), NextPathPoint.Location + FVector(0.f, 0.f, 200.f), 25.f, 16, FColor::Green);
 	}
@@ -0,0 +1,545 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexContractionHierarchy.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "Algo/Reverse.h"
+#include "Algo/AllOf.h"
+#include "Misc/ScopeLock.h"
+
+
+namespace HexContraction
+{
+	// Max nodes settled by a witness search, a missed witness only costs an extra shortcut
+	static constexpr int32 WitnessSettleLimit{ 64 };
+
+	static FORCEINLINE uint64 EdgeKey(const int32 From, const int32 To)
+	{
+		return (uint64(uint32(From)) << 32) | uint64(uint32(To));
+	}
+
+	struct FBuildEdge
+	{
+		int32 Node;
+		int32 Middle;
+		float Cost;
+	};
+
+	struct FQueueEntry
+	{
+		int32 Node;
+		float Cost;
+
+		bool operator<(const FQueueEntry &Other) const { return Cost < Other.Cost; }
+	};
+
+	// Working graph of the preprocessing, contracted nodes keep their edges (they end in the final graph)
+	struct FBuildGraph
+	{
+		TArray<TArray<FBuildEdge>> Out;
+		TArray<TArray<FBuildEdge>> In;
+		TBitArray<> Contracted;
+
+		void AddOrImprove(const int32 From, const int32 To, const float Cost, const int32 Middle)
+		{
+			FBuildEdge *OutEdge{ Out[From].FindByPredicate([To](const FBuildEdge &Edge) { return Edge.Node == To; }) };
+			if (OutEdge)
+			{
+				if (Cost < OutEdge->Cost)
+				{
+					FBuildEdge *InEdge{ In[To].FindByPredicate([From](const FBuildEdge &Edge) { return Edge.Node == From; }) };
+					OutEdge->Cost = InEdge->Cost = Cost;
+					OutEdge->Middle = InEdge->Middle = Middle;
+				}
+				return;
+			}
+			Out[From].Add(FBuildEdge{ To, Middle, Cost });
+			In[To].Add(FBuildEdge{ From, Middle, Cost });
+		}
+
+		// Cheapest costs from Source to the nodes around it without going through Excluded, up to MaxCost
+		void WitnessSearch(const int32 Source, const int32 Excluded, const float MaxCost, TMap<int32, float> &OutCosts) const
+		{
+			OutCosts.Reset();
+			OutCosts.Add(Source, 0.f);
+
+			TArray<FQueueEntry> Queue;
+			Queue.HeapPush(FQueueEntry{ Source, 0.f });
+
+			int32 Settled{ 0 };
+			while (Queue.Num() > 0 && Settled < WitnessSettleLimit)
+			{
+				FQueueEntry Entry;
+				Queue.HeapPop(Entry, false);
+				if (Entry.Cost > OutCosts.FindChecked(Entry.Node) || Entry.Cost > MaxCost)
+				{
+					continue;
+				}
+				++Settled;
+
+				for (const FBuildEdge &Edge : Out[Entry.Node])
+				{
+					if (Edge.Node == Excluded || Contracted[Edge.Node])
+					{
+						continue;
+					}
+
+					const float NewCost{ Entry.Cost + Edge.Cost };
+					float *OldCost{ OutCosts.Find(Edge.Node) };
+					if (NewCost <= MaxCost && (!OldCost || NewCost < *OldCost))
+					{
+						OutCosts.Add(Edge.Node, NewCost);
+						Queue.HeapPush(FQueueEntry{ Edge.Node, NewCost });
+					}
+				}
+			}
+		}
+
+		// Shortcuts needed to contract Node, added only if bApply
+		int32 Contract(const int32 Node, const bool bApply)
+		{
+			int32 NumShortcuts{ 0 };
+			TMap<int32, float> WitnessCosts;
+
+			// Copies, AddOrImprove can grow the arrays we are iterating
+			const TArray<FBuildEdge> InEdges{ In[Node] };
+			const TArray<FBuildEdge> OutEdges{ Out[Node] };
+
+			for (const FBuildEdge &InEdge : InEdges)
+			{
+				if (Contracted[InEdge.Node])
+				{
+					continue;
+				}
+
+				float MaxCost{ 0.f };
+				for (const FBuildEdge &OutEdge : OutEdges)
+				{
+					MaxCost = FMath::Max(MaxCost, InEdge.Cost + OutEdge.Cost);
+				}
+				WitnessSearch(InEdge.Node, Node, MaxCost, WitnessCosts);
+
+				for (const FBuildEdge &OutEdge : OutEdges)
+				{
+					if (Contracted[OutEdge.Node] || OutEdge.Node == InEdge.Node)
+					{
+						continue;
+					}
+
+					// No other path as cheap as the one through Node, we need a shortcut
+					const float ShortcutCost{ InEdge.Cost + OutEdge.Cost };
+					const float *WitnessCost{ WitnessCosts.Find(OutEdge.Node) };
+					if (!WitnessCost || *WitnessCost > ShortcutCost)
+					{
+						++NumShortcuts;
+						if (bApply)
+						{
+							AddOrImprove(InEdge.Node, OutEdge.Node, ShortcutCost, Node);
+						}
+					}
+				}
+			}
+			return NumShortcuts;
+		}
+
+		int32 CountActiveEdges(const int32 Node) const
+		{
+			int32 Count{ 0 };
+			for (const FBuildEdge &Edge : Out[Node])
+			{
+				Count += Contracted[Edge.Node] ? 0 : 1;
+			}
+			for (const FBuildEdge &Edge : In[Node])
+			{
+				Count += Contracted[Edge.Node] ? 0 : 1;
+			}
+			return Count;
+		}
+	};
+
+	/* Hierarchies alive in the process, see FHexContractionHierarchy::FindOrBuildShared */
+	struct FSharedHierarchies
+	{
+		struct FEntry
+		{
+			/* Weak too, a dead grid layout can't match a new one allocated at the same address */
+			TWeakPtr<const FHexGridSharedData, ESPMode::ThreadSafe> GridData;
+			uint32 Fingerprint;
+			TWeakPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Hierarchy;
+		};
+
+		FCriticalSection Lock;
+		TArray<FEntry> Entries;
+
+		static FSharedHierarchies &Get()
+		{
+			static FSharedHierarchies Shared;
+			return Shared;
+		}
+
+		/* Call it with the lock taken. The cost CRC is trusted like in AGraphAStarNavMesh::LoadContractionHierarchies */
+		TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Find(const FHexGridSharedDataPtr &GridData, const uint32 Fingerprint) const
+		{
+			for (const FEntry &Entry : Entries)
+			{
+				if (Entry.Fingerprint == Fingerprint && Entry.GridData.Pin() == GridData)
+				{
+					TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Hierarchy{ Entry.Hierarchy.Pin() };
+					if (Hierarchy.IsValid())
+					{
+						return Hierarchy;
+					}
+				}
+			}
+			return nullptr;
+		}
+	};
+}
+
+
+void FHexContractionHierarchy::Reset()
+{
+	Ranks.Reset();
+	UpOffsets.Reset();
+	UpEdges.Reset();
+	DownOffsets.Reset();
+	DownEdges.Reset();
+	Middles.Reset();
+	Fingerprint = 0;
+}
+
+bool FHexContractionHierarchy::IsConsistent(const int32 NumNodes) const
+{
+	if (Ranks.Num() != NumNodes || UpOffsets.Num() != NumNodes + 1 || DownOffsets.Num() != NumNodes + 1
+		|| UpOffsets.Last() != UpEdges.Num() || DownOffsets.Last() != DownEdges.Num())
+	{
+		return false;
+	}
+
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		if (UpOffsets[NodeRef] < 0 || UpOffsets[NodeRef] > UpOffsets[NodeRef + 1] || DownOffsets[NodeRef] < 0 || DownOffsets[NodeRef] > DownOffsets[NodeRef + 1])
+		{
+			return false;
+		}
+	}
+
+	for (const TPair<uint64, int32> &Middle : Middles)
+	{
+		if (Middle.Value >= NumNodes)
+		{
+			return false;
+		}
+	}
+
+	const auto IsValidEdge{ [NumNodes](const FEdge &Edge) { return Edge.Target >= 0 && Edge.Target < NumNodes && Edge.Middle < NumNodes; } };
+	return Algo::AllOf(UpEdges, IsValidEdge) && Algo::AllOf(DownEdges, IsValidEdge);
+}
+
+uint32 FHexContractionHierarchy::ComputeFingerprint(const AHexGrid &Grid, const FGridPathFilter &Filter)
+{
+	const int32 NumNodes{ Grid.GetNumTiles() };
+	uint32 Crc{ FCrc::MemCrc32(&NumNodes, sizeof(NumNodes)) };
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		const float Cost{ Filter.IsTraversalAllowed(NodeRef, NodeRef) ? Filter.GetTraversalCost(NodeRef, NodeRef) : -1.f };
+		Crc = FCrc::MemCrc32(&Cost, sizeof(Cost), Crc);
+
+		// Portals are edges of the graph too
+		for (int32 PortalIndex{ 0 }; PortalIndex < Grid.GetPortalCount(NodeRef); ++PortalIndex)
+		{
+			const FHexPortalEdge &Edge{ Grid.GetPortalEdge(NodeRef, PortalIndex) };
+			Crc = FCrc::MemCrc32(&Edge.Target, sizeof(Edge.Target), Crc);
+			Crc = FCrc::MemCrc32(&Edge.Cost, sizeof(Edge.Cost), Crc);
+		}
+	}
+	return Crc;
+}
+
+void FHexContractionHierarchy::Build(const AHexGrid &Grid, const FGridPathFilter &Filter)
+{
+	using namespace HexContraction;
+
+	Reset();
+
+	const int32 NumNodes{ Grid.GetNumTiles() };
+	if (NumNodes == 0)
+	{
+		return;
+	}
+
+	// Grid edges, the same the A* would expand
+	FBuildGraph Graph;
+	Graph.Out.SetNum(NumNodes);
+	Graph.In.SetNum(NumNodes);
+	Graph.Contracted.Init(false, NumNodes);
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		for (int32 NeighbourIndex{ 0 }; NeighbourIndex < Grid.GetNeighbourCount(NodeRef); ++NeighbourIndex)
+		{
+			const int32 Neighbour{ Grid.GetNeighbour(NodeRef, NeighbourIndex) };
+			if (Grid.IsValidRef(Neighbour) && Neighbour != NodeRef && Filter.IsTraversalAllowed(NodeRef, Neighbour))
+			{
+				Graph.AddOrImprove(NodeRef, Neighbour, Filter.GetTraversalCost(NodeRef, Neighbour), INDEX_NONE);
+			}
+		}
+	}
+
+	// Contraction order: the fewer shortcuts a tile adds compared to the edges it removes, the sooner.
+	// Priorities change while we contract, so they are checked again when popped (lazy updates).
+	TArray<int32> ContractedNeighbours;
+	ContractedNeighbours.Init(0, NumNodes);
+	const auto GetPriority{ [&Graph, &ContractedNeighbours](const int32 Node)
+	{
+		return float(Graph.Contract(Node, false) - Graph.CountActiveEdges(Node) + ContractedNeighbours[Node]);
+	} };
+
+	TArray<FQueueEntry> Queue;
+	Queue.Reserve(NumNodes);
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		Queue.Add(FQueueEntry{ NodeRef, GetPriority(NodeRef) });
+	}
+	Queue.Heapify();
+
+	Ranks.Init(INDEX_NONE, NumNodes);
+	int32 NextRank{ 0 };
+	while (Queue.Num() > 0)
+	{
+		FQueueEntry Entry;
+		Queue.HeapPop(Entry, false);
+
+		const float Priority{ GetPriority(Entry.Node) };
+		if (Queue.Num() > 0 && Priority > Queue.HeapTop().Cost)
+		{
+			Queue.HeapPush(FQueueEntry{ Entry.Node, Priority });
+			continue;
+		}
+
+		Graph.Contract(Entry.Node, true);
+		Graph.Contracted[Entry.Node] = true;
+		Ranks[Entry.Node] = NextRank++;
+
+		for (const FBuildEdge &Edge : Graph.Out[Entry.Node])
+		{
+			++ContractedNeighbours[Edge.Node];
+		}
+		for (const FBuildEdge &Edge : Graph.In[Entry.Node])
+		{
+			++ContractedNeighbours[Edge.Node];
+		}
+	}
+
+	// Flatten the upward and downward graphs, the queries only need these
+	UpOffsets.Reserve(NumNodes + 1);
+	DownOffsets.Reserve(NumNodes + 1);
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		UpOffsets.Add(UpEdges.Num());
+		for (const FBuildEdge &Edge : Graph.Out[NodeRef])
+		{
+			Middles.Add(EdgeKey(NodeRef, Edge.Node), Edge.Middle);
+			if (Ranks[Edge.Node] > Ranks[NodeRef])
+			{
+				UpEdges.Add(FEdge{ Edge.Node, Edge.Middle, Edge.Cost });
+			}
+		}
+
+		DownOffsets.Add(DownEdges.Num());
+		for (const FBuildEdge &Edge : Graph.In[NodeRef])
+		{
+			if (Ranks[Edge.Node] > Ranks[NodeRef])
+			{
+				DownEdges.Add(FEdge{ Edge.Node, Edge.Middle, Edge.Cost });
+			}
+		}
+	}
+	UpOffsets.Add(UpEdges.Num());
+	DownOffsets.Add(DownEdges.Num());
+
+	Fingerprint = ComputeFingerprint(Grid, Filter);
+
+	UE_LOG(LogGraphAStarExample_NavMesh, Log, TEXT("FHexContractionHierarchy::Build(...) %d tiles, %d up edges, %d down edges"),
+		NumNodes, UpEdges.Num(), DownEdges.Num());
+}
+
+EGraphAStarResult FHexContractionHierarchy::FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath) const
+{
+	using namespace HexContraction;
+
+	OutPath.Reset();
+
+	const int32 NumNodes{ Ranks.Num() };
+	if (!Ranks.IsValidIndex(StartNodeRef) || !Ranks.IsValidIndex(EndNodeRef))
+	{
+		return SearchFail;
+	}
+
+	if (StartNodeRef == EndNodeRef)
+	{
+		OutPath.Add(EndNodeRef);
+		return SearchSuccess;
+	}
+
+	// Forward search from the start on the up edges, backward search from the end on the down edges.
+	TArray<float> Costs[2];
+	TArray<int32> Parents[2];
+	TArray<FQueueEntry> Queues[2];
+	for (int32 Side{ 0 }; Side < 2; ++Side)
+	{
+		Costs[Side].Init(TNumericLimits<float>::Max(), NumNodes);
+		Parents[Side].Init(INDEX_NONE, NumNodes);
+	}
+	Costs[0][StartNodeRef] = 0.f;
+	Costs[1][EndNodeRef] = 0.f;
+	Queues[0].HeapPush(FQueueEntry{ StartNodeRef, 0.f });
+	Queues[1].HeapPush(FQueueEntry{ EndNodeRef, 0.f });
+
+	float BestCost{ TNumericLimits<float>::Max() };
+	int32 Meeting{ INDEX_NONE };
+
+	for (;;)
+	{
+		// A side is done when its cheapest node can't improve the best path
+		const bool bForward{ Queues[0].Num() > 0 && Queues[0].HeapTop().Cost < BestCost };
+		const bool bBackward{ Queues[1].Num() > 0 && Queues[1].HeapTop().Cost < BestCost };
+		if (!bForward && !bBackward)
+		{
+			break;
+		}
+
+		const int32 Side{ bForward && (!bBackward || Queues[0].HeapTop().Cost <= Queues[1].HeapTop().Cost) ? 0 : 1 };
+		const TArray<int32> &Offsets{ Side == 0 ? UpOffsets : DownOffsets };
+		const TArray<FEdge> &Edges{ Side == 0 ? UpEdges : DownEdges };
+
+		FQueueEntry Entry;
+		Queues[Side].HeapPop(Entry, false);
+		if (Entry.Cost > Costs[Side][Entry.Node])
+		{
+			continue;
+		}
+
+		// Reached by the other side too
+		const float OtherCost{ Costs[1 - Side][Entry.Node] };
+		if (OtherCost < TNumericLimits<float>::Max() && Entry.Cost + OtherCost < BestCost)
+		{
+			BestCost = Entry.Cost + OtherCost;
+			Meeting = Entry.Node;
+		}
+
+		for (int32 EdgeIndex{ Offsets[Entry.Node] }; EdgeIndex < Offsets[Entry.Node + 1]; ++EdgeIndex)
+		{
+			const FEdge &Edge{ Edges[EdgeIndex] };
+			const float NewCost{ Entry.Cost + Edge.Cost };
+			if (NewCost < Costs[Side][Edge.Target])
+			{
+				Costs[Side][Edge.Target] = NewCost;
+				Parents[Side][Edge.Target] = Entry.Node;
+				Queues[Side].HeapPush(FQueueEntry{ Edge.Target, NewCost });
+			}
+		}
+	}
+
+	if (Meeting == INDEX_NONE)
+	{
+		return GoalUnreachable;
+	}
+
+	// Start -> meeting with the forward parents, meeting -> end with the backward ones
+	TArray<int32> Nodes;
+	for (int32 Node{ Meeting }; Node != INDEX_NONE; Node = Parents[0][Node])
+	{
+		Nodes.Add(Node);
+	}
+	Algo::Reverse(Nodes);
+	for (int32 Node{ Parents[1][Meeting] }; Node != INDEX_NONE; Node = Parents[1][Node])
+	{
+		Nodes.Add(Node);
+	}
+
+	for (int32 Index{ 1 }; Index < Nodes.Num(); ++Index)
+	{
+		Unpack(Nodes[Index - 1], Nodes[Index], OutPath);
+	}
+	return SearchSuccess;
+}
+
+void FHexContractionHierarchy::Unpack(const int32 From, const int32 To, TArray<int32> &OutPath) const
+{
+	const int32 *Middle{ Middles.Find(HexContraction::EdgeKey(From, To)) };
+	if (!Middle || *Middle == INDEX_NONE)
+	{
+		OutPath.Add(To);
+		return;
+	}
+
+	Unpack(From, *Middle, OutPath);
+	Unpack(*Middle, To, OutPath);
+}
+
+TSharedRef<const FHexContractionHierarchy, ESPMode::ThreadSafe> FHexContractionHierarchy::FindOrBuildShared(const AHexGrid &Grid, const FGridPathFilter &Filter)
+{
+	using namespace HexContraction;
+
+	// Same layout (coordinates and base blocking flags) and same costs, the portals are in the fingerprint too
+	const FHexGridSharedDataPtr &GridData{ Grid.GetSharedData() };
+	if (GridData.IsValid())
+	{
+		FSharedHierarchies &Shared{ FSharedHierarchies::Get() };
+		FScopeLock Lock(&Shared.Lock);
+		TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Hierarchy{ Shared.Find(GridData, ComputeFingerprint(Grid, Filter)) };
+		if (Hierarchy.IsValid())
+		{
+			return Hierarchy.ToSharedRef();
+		}
+	}
+
+	// Outside of the lock, the preprocessing takes a while
+	FHexContractionHierarchy Hierarchy;
+	Hierarchy.Build(Grid, Filter);
+	return Share(Grid, MoveTemp(Hierarchy));
+}
+
+TSharedRef<const FHexContractionHierarchy, ESPMode::ThreadSafe> FHexContractionHierarchy::Share(const AHexGrid &Grid, FHexContractionHierarchy &&Hierarchy)
+{
+	using namespace HexContraction;
+
+	const FHexGridSharedDataPtr &GridData{ Grid.GetSharedData() };
+	if (!GridData.IsValid() || !Hierarchy.IsBuilt())
+	{
+		return MakeShared<FHexContractionHierarchy, ESPMode::ThreadSafe>(MoveTemp(Hierarchy));
+	}
+
+	FSharedHierarchies &Shared{ FSharedHierarchies::Get() };
+	FScopeLock Lock(&Shared.Lock);
+
+	// Another world got there first
+	TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> Existing{ Shared.Find(GridData, Hierarchy.Fingerprint) };
+	if (Existing.IsValid())
+	{
+		return Existing.ToSharedRef();
+	}
+
+	Shared.Entries.RemoveAllSwap([](const FSharedHierarchies::FEntry &Entry)
+	{
+		return !Entry.Hierarchy.IsValid() || !Entry.GridData.IsValid();
+	});
+
+	const uint32 Fingerprint{ Hierarchy.Fingerprint };
+	TSharedRef<const FHexContractionHierarchy, ESPMode::ThreadSafe> NewHierarchy{ MakeShared<FHexContractionHierarchy, ESPMode::ThreadSafe>(MoveTemp(Hierarchy)) };
+	Shared.Entries.Add(FSharedHierarchies::FEntry{ GridData, Fingerprint, NewHierarchy });
+	return NewHierarchy;
+}
+
+FArchive &operator<<(FArchive &Ar, FHexContractionHierarchy &Hierarchy)
+{
+	Ar << Hierarchy.Fingerprint;
+	Ar << Hierarchy.Ranks;
+	Ar << Hierarchy.UpOffsets;
+	Ar << Hierarchy.UpEdges;
+	Ar << Hierarchy.DownOffsets;
+	Ar << Hierarchy.DownEdges;
+	Ar << Hierarchy.Middles;
+	return Ar;
+}
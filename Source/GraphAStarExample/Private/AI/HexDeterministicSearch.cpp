@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexDeterministicSearch.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "Algo/Reverse.h"
+
+
+FHexDeterministicSearch::FHexDeterministicSearch(const AHexGrid &InGrid, const FGridPathFilter &InFilter, const FHexJumpPointData &InData)
+	: Grid(InGrid), Filter(InFilter)
+{
+	// The rounding is monotonic, so the rounded minimum is still a lower bound of every rounded step.
+	// The minimum is exact (see FHexJumpPointData::Update): a lower one would change the expanded nodes, and with them
+	// the chosen path among the ones of equal cost, on the machines that saw a different edit history.
+	MinTileCost = FMath::Max<int64>(ToFixed(InData.MinTileCost), 1);
+	const int64 MinPortalStepCost{ FMath::Max<int64>(ToFixed(InData.MinTileCost + FMath::Max(InGrid.GetMinPortalCost(), 0.f)), 1) };
+	MinPortalCost = MinPortalStepCost - MinTileCost;
+}
+
+int64 FHexDeterministicSearch::ToFixed(const float Cost)
+{
+	// A float times a power of two is exact in a double, only the rounding is left and floor is exact too
+	return int64(FMath::FloorToDouble(double(Cost) * double(CostScale) + 0.5));
+}
+
+EGraphAStarResult FHexDeterministicSearch::FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath)
+{
+	OutPath.Reset();
+	PathCost = 0;
+
+	if (!Grid.IsValidRef(StartNodeRef) || !Grid.IsValidRef(EndNodeRef))
+	{
+		return SearchFail;
+	}
+
+	if (StartNodeRef == EndNodeRef)
+	{
+		OutPath.Add(EndNodeRef);
+		return SearchSuccess;
+	}
+
+	GoalRef = EndNodeRef;
+	GoalExitDistance = Grid.GetDistanceFromPortalExit(Grid.GetPackedCoord(GoalRef));
+
+	// A new generation makes every node of the previous queries stale without touching them
+	Pool = &GetNodePool();
+	const int32 NumNodes{ Grid.GetNumTiles() };
+	if (++Pool->Generation == 0 || Pool->Nodes.Num() != NumNodes)
+	{
+		Pool->Nodes.Reset();
+		Pool->Nodes.SetNum(NumNodes);
+		Pool->Generation = 1;
+	}
+	OpenList.Reset();
+
+	GetNode(StartNodeRef).G = 0;
+	OpenList.HeapPush(FOpenEntry{ GetHeuristic(StartNodeRef), 0, StartNodeRef }, FOpenEntry::FCheapestFirst());
+
+	// Closest tile for the partial path, with the same kind of total order of the open list
+	int32 BestNodeRef{ StartNodeRef };
+	int64 BestHeuristic{ GetHeuristic(StartNodeRef) };
+
+	while (OpenList.Num() > 0)
+	{
+		FOpenEntry Entry;
+		OpenList.HeapPop(Entry, FOpenEntry::FCheapestFirst(), false);
+
+		// Improved after the push, or the same node pushed twice with the same cost
+		FSearchNode &Node{ GetNode(Entry.NodeRef) };
+		if (Entry.G > Node.G || Node.bClosed)
+		{
+			continue;
+		}
+		Node.bClosed = true;
+
+		if (Entry.NodeRef == GoalRef)
+		{
+			break;
+		}
+
+		const int64 Heuristic{ Entry.F - Entry.G };
+		const int64 BestG{ GetNode(BestNodeRef).G };
+		if (Heuristic < BestHeuristic || (Heuristic == BestHeuristic && (Entry.G < BestG || (Entry.G == BestG && Entry.NodeRef < BestNodeRef))))
+		{
+			BestNodeRef = Entry.NodeRef;
+			BestHeuristic = Heuristic;
+		}
+
+		const int32 NumNeighbours{ Grid.GetNeighbourCount(Entry.NodeRef) };
+		for (int32 NeiIndex{ 0 }; NeiIndex < NumNeighbours; ++NeiIndex)
+		{
+			const int32 Neighbour{ Grid.GetNeighbour(Entry.NodeRef, NeiIndex) };
+			if (!Grid.IsValidRef(Neighbour) || !Filter.IsTraversalAllowed(Entry.NodeRef, Neighbour))
+			{
+				continue;
+			}
+
+			const int64 G{ Entry.G + GetEdgeCost(Entry.NodeRef, Neighbour) };
+			FSearchNode &NeighbourNode{ GetNode(Neighbour) };
+			if (G < NeighbourNode.G)
+			{
+				// The heuristic is admissible but not always consistent across portals, a better cost reopens the tile
+				NeighbourNode.G = G;
+				NeighbourNode.ParentRef = Entry.NodeRef;
+				NeighbourNode.bClosed = false;
+				OpenList.HeapPush(FOpenEntry{ G + GetHeuristic(Neighbour), G, Neighbour }, FOpenEntry::FCheapestFirst());
+			}
+			else if (G == NeighbourNode.G && Entry.NodeRef < NeighbourNode.ParentRef)
+			{
+				// Same cost from a different parent, the smaller index wins whatever the expansion order
+				NeighbourNode.ParentRef = Entry.NodeRef;
+			}
+		}
+	}
+
+	const bool bReachedGoal{ GetNode(GoalRef).bClosed };
+	const int32 LastNodeRef{ bReachedGoal ? GoalRef : BestNodeRef };
+	for (int32 NodeRef{ LastNodeRef }; NodeRef != StartNodeRef; NodeRef = GetNode(NodeRef).ParentRef)
+	{
+		OutPath.Add(NodeRef);
+	}
+	Algo::Reverse(OutPath);
+	PathCost = GetNode(LastNodeRef).G;
+
+	return bReachedGoal ? SearchSuccess : GoalUnreachable;
+}
+
+FHexDeterministicSearch::FNodePool &FHexDeterministicSearch::GetNodePool()
+{
+	// Queries run on many async pathfinding threads at once, each thread has its own nodes
+	static thread_local FNodePool NodePool;
+	return NodePool;
+}
+
+FHexDeterministicSearch::FSearchNode &FHexDeterministicSearch::GetNode(const int32 NodeRef)
+{
+	FSearchNode &Node{ Pool->Nodes[NodeRef] };
+	if (Node.Generation != Pool->Generation)
+	{
+		Node = FSearchNode();
+		Node.Generation = Pool->Generation;
+	}
+	return Node;
+}
+
+int64 FHexDeterministicSearch::GetHeuristic(const int32 NodeRef) const
+{
+	return FHexJumpPointData::GetHeuristic(Grid, NodeRef, GoalRef, GoalExitDistance, MinTileCost, MinPortalCost);
+}
+
+int64 FHexDeterministicSearch::GetEdgeCost(const int32 From, const int32 To) const
+{
+	// A single read (or a single sum with the portal cost) of the filter, floats only diverge when they are accumulated
+	return FMath::Max<int64>(ToFixed(Filter.GetTraversalCost(From, To)), 1);
+}
@@ -0,0 +1,437 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexJumpPointSearch.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "Algo/Reverse.h"
+
+
+//==== FHexJumpPointData ====
+
+void FHexJumpPointData::Build(const AHexGrid &Grid, const FGridPathFilter &Filter)
+{
+	const int32 NumNodes{ Grid.GetNumTiles() };
+	UniformTiles.Init(false, NumNodes);
+
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		UniformTiles[NodeRef] = IsUniform(Grid, Filter, NodeRef);
+	}
+
+	RebuildMinTileCost(Grid, Filter);
+}
+
+void FHexJumpPointData::Update(const AHexGrid &Grid, const FGridPathFilter &Filter, const TArray<int32> &DirtyTiles)
+{
+	if (UniformTiles.Num() != Grid.GetNumTiles())
+	{
+		Build(Grid, Filter);
+		return;
+	}
+
+	for (const int32 TileIndex : DirtyTiles)
+	{
+		if (!Grid.IsValidRef(TileIndex))
+		{
+			continue;
+		}
+
+		// A tile change can also break (or restore) the uniformity of its neighbours.
+		UniformTiles[TileIndex] = IsUniform(Grid, Filter, TileIndex);
+		for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+		{
+			const int32 Neighbour{ Grid.GetNeighbour(TileIndex, Dir) };
+			if (Grid.IsValidRef(Neighbour))
+			{
+				UniformTiles[Neighbour] = IsUniform(Grid, Filter, Neighbour);
+			}
+		}
+
+		// A smaller minimum would still be admissible, but the searches would slow down and the deterministic
+		// heuristic would depend on the edit history of each machine. So the minimum is kept exact.
+		const float Cost{ GetEntryCost(Filter, TileIndex) };
+		if (Cost < MinTileCost)
+		{
+			MinTileCost = Cost;
+			MinCostTiles.Init(false, UniformTiles.Num());
+			MinCostTiles[TileIndex] = true;
+			NumMinCostTiles = 1;
+		}
+		else if (Cost == MinTileCost && !MinCostTiles[TileIndex])
+		{
+			MinCostTiles[TileIndex] = true;
+			++NumMinCostTiles;
+		}
+		else if (Cost != MinTileCost && MinCostTiles[TileIndex])
+		{
+			MinCostTiles[TileIndex] = false;
+			--NumMinCostTiles;
+		}
+	}
+
+	// The last tile with the minimum cost has been raised (or blocked)
+	if (NumMinCostTiles == 0)
+	{
+		RebuildMinTileCost(Grid, Filter);
+	}
+}
+
+float FHexJumpPointData::GetEntryCost(const FGridPathFilter &Filter, const int32 NodeRef)
+{
+	// The cost of entering the tile doesn't depend on where we come from
+	return Filter.IsTraversalAllowed(NodeRef, NodeRef) ? Filter.GetTraversalCost(NodeRef, NodeRef) : TNumericLimits<float>::Max();
+}
+
+void FHexJumpPointData::RebuildMinTileCost(const AHexGrid &Grid, const FGridPathFilter &Filter)
+{
+	const int32 NumNodes{ Grid.GetNumTiles() };
+	MinTileCost = TNumericLimits<float>::Max();
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		MinTileCost = FMath::Min(MinTileCost, GetEntryCost(Filter, NodeRef));
+	}
+
+	MinCostTiles.Init(false, NumNodes);
+	NumMinCostTiles = 0;
+	if (MinTileCost == TNumericLimits<float>::Max())
+	{
+		// Nothing can be traversed, any positive value will do
+		MinTileCost = 1.f;
+		return;
+	}
+
+	for (int32 NodeRef{ 0 }; NodeRef < NumNodes; ++NodeRef)
+	{
+		if (GetEntryCost(Filter, NodeRef) == MinTileCost)
+		{
+			MinCostTiles[NodeRef] = true;
+			++NumMinCostTiles;
+		}
+	}
+}
+
+namespace HexJumpPointSearch
+{
+	template <typename CostType>
+	CostType GetHeuristic(const AHexGrid &Grid, const int32 NodeRef, const int32 GoalRef, const int32 GoalExitDistance, const CostType MinTileCost, const CostType MinPortalCost)
+	{
+		const FHPackedCoord Coord{ Grid.GetPackedCoord(NodeRef) };
+		const CostType Direct{ CostType(FHPackedCoord::Distance(Coord, Grid.GetPackedCoord(GoalRef))) * MinTileCost };
+		if (GoalExitDistance == MAX_int32)
+		{
+			return Direct;
+		}
+
+		// A portal can be a shortcut, so the estimate is the cheapest of walking and of the best possible portal trip
+		const int32 EntranceDistance{ Grid.GetDistanceToPortalEntrance(Coord) };
+		const CostType ViaPortal{ (CostType(EntranceDistance) + CostType(GoalExitDistance) + 1) * MinTileCost + MinPortalCost };
+		return FMath::Min(Direct, ViaPortal);
+	}
+}
+
+float FHexJumpPointData::GetHeuristic(const AHexGrid &Grid, const int32 NodeRef, const int32 GoalRef, const int32 GoalExitDistance, const float MinTileCost, const float MinPortalCost)
+{
+	return HexJumpPointSearch::GetHeuristic(Grid, NodeRef, GoalRef, GoalExitDistance, MinTileCost, MinPortalCost);
+}
+
+int64 FHexJumpPointData::GetHeuristic(const AHexGrid &Grid, const int32 NodeRef, const int32 GoalRef, const int32 GoalExitDistance, const int64 MinTileCost, const int64 MinPortalCost)
+{
+	return HexJumpPointSearch::GetHeuristic(Grid, NodeRef, GoalRef, GoalExitDistance, MinTileCost, MinPortalCost);
+}
+
+bool FHexJumpPointData::IsUniform(const AHexGrid &Grid, const FGridPathFilter &Filter, const int32 NodeRef) const
+{
+	// A portal is an extra neighbour the scans can't see
+	if (!Filter.IsTraversalAllowed(NodeRef, NodeRef) || Grid.GetPortalCount(NodeRef) > 0)
+	{
+		return false;
+	}
+
+	const float Cost{ Filter.GetTraversalCost(NodeRef, NodeRef) };
+	for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+	{
+		const int32 Neighbour{ Grid.GetNeighbour(NodeRef, Dir) };
+
+		// Obstacles and the border are handled by the forced neighbours of the scans
+		if (!Grid.IsValidRef(Neighbour) || !Filter.IsTraversalAllowed(NodeRef, Neighbour))
+		{
+			continue;
+		}
+
+		if (Filter.GetTraversalCost(NodeRef, Neighbour) != Cost)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+//==== END OF FHexJumpPointData ====
+
+
+//==== FHexJumpPointSearch ====
+
+EGraphAStarResult FHexJumpPointSearch::FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath)
+{
+	OutPath.Reset();
+
+	if (!Grid.IsValidRef(StartNodeRef) || !Grid.IsValidRef(EndNodeRef) || Data.UniformTiles.Num() != Grid.GetNumTiles())
+	{
+		return SearchFail;
+	}
+
+	if (StartNodeRef == EndNodeRef)
+	{
+		OutPath.Add(EndNodeRef);
+		return SearchSuccess;
+	}
+
+	GoalRef = EndNodeRef;
+	GoalExitDistance = Grid.GetDistanceFromPortalExit(Grid.GetPackedCoord(GoalRef));
+
+	// A new generation makes every node of the previous queries stale without touching them
+	Pool = &GetNodePool();
+	const int32 NumNodes{ Data.UniformTiles.Num() * KindsPerTile };
+	if (++Pool->Generation == 0 || Pool->Nodes.Num() != NumNodes)
+	{
+		Pool->Nodes.Reset();
+		Pool->Nodes.SetNum(NumNodes);
+		Pool->Generation = 1;
+	}
+	OpenList.Reset();
+
+	AddNode(StartNodeRef, ENodeKind::Full, 0, 0.f, INDEX_NONE);
+
+	while (OpenList.Num() > 0)
+	{
+		FOpenEntry Entry;
+		OpenList.HeapPop(Entry, FOpenEntry::FCheapestFirst(), false);
+
+		FSearchNode &Node{ GetNode(Entry.NodeId) };
+		if (Node.bClosed || Entry.G > Node.G)
+		{
+			continue;
+		}
+		Node.bClosed = true;
+
+		if (Node.NodeRef == GoalRef)
+		{
+			BuildPath(Entry.NodeId, OutPath);
+			return SearchSuccess;
+		}
+
+		const int32 Kind{ Entry.NodeId % KindsPerTile };
+		if (Kind == 0)
+		{
+			// Full expansion, the primary scans cover the six sextants around the tile
+			for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+			{
+				ScanPrimary(Entry.NodeId, Dir);
+			}
+			ExpandPortals(Entry.NodeId);
+		}
+		else
+		{
+			// We are on a primary scan along Dir, the jump point of the secondary scan was pushed with us
+			ScanPrimary(Entry.NodeId, Kind - 1);
+		}
+	}
+
+	return GoalUnreachable;
+}
+
+int32 FHexJumpPointSearch::GetNodeId(const int32 NodeRef, const ENodeKind Kind, const int32 Dir) const
+{
+	return NodeRef * KindsPerTile + (Kind == ENodeKind::Full ? 0 : 1 + Dir);
+}
+
+FHexJumpPointSearch::FNodePool &FHexJumpPointSearch::GetNodePool()
+{
+	// Queries run on many async pathfinding threads at once, each thread has its own nodes
+	static thread_local FNodePool NodePool;
+	return NodePool;
+}
+
+FHexJumpPointSearch::FSearchNode &FHexJumpPointSearch::GetNode(const int32 NodeId)
+{
+	FSearchNode &Node{ Pool->Nodes[NodeId] };
+	if (Node.Generation != Pool->Generation)
+	{
+		Node = FSearchNode();
+		Node.Generation = Pool->Generation;
+	}
+	return Node;
+}
+
+float FHexJumpPointSearch::GetHeuristic(const int32 NodeRef) const
+{
+	return FHexJumpPointData::GetHeuristic(Grid, NodeRef, GoalRef, GoalExitDistance, Data.MinTileCost, Grid.GetMinPortalCost());
+}
+
+bool FHexJumpPointSearch::AddNode(const int32 NodeRef, const ENodeKind Kind, const int32 Dir, const float G, const int32 ParentId, const bool bViaPortal)
+{
+	const int32 NodeId{ GetNodeId(NodeRef, Kind, Dir) };
+	FSearchNode &Node{ GetNode(NodeId) };
+	if (Node.bClosed || G >= Node.G)
+	{
+		return false;
+	}
+
+	Node.NodeRef = NodeRef;
+	Node.ParentId = ParentId;
+	Node.G = G;
+	Node.bViaPortal = bViaPortal;
+
+	// We don't update entries in the heap, the old one will be skipped when popped
+	OpenList.HeapPush(FOpenEntry{ NodeId, G, G + GetHeuristic(NodeRef) }, FOpenEntry::FCheapestFirst());
+	return true;
+}
+
+void FHexJumpPointSearch::ExpandPortals(const int32 NodeId)
+{
+	const FSearchNode &Node{ Pool->Nodes[NodeId] };
+	const int32 NodeRef{ Node.NodeRef };
+	const float NodeG{ Node.G };
+	for (int32 PortalIndex{ 0 }; PortalIndex < Grid.GetPortalCount(NodeRef); ++PortalIndex)
+	{
+		const int32 Target{ Grid.GetPortalEdge(NodeRef, PortalIndex).Target };
+		if (Filter.IsTraversalAllowed(NodeRef, Target))
+		{
+			// The exit can be anywhere, so it's expanded in all the directions
+			AddNode(Target, ENodeKind::Full, 0, NodeG + Filter.GetTraversalCost(NodeRef, Target), NodeId, true);
+		}
+	}
+}
+
+int32 FHexJumpPointSearch::Step(const int32 NodeRef, const int32 Dir) const
+{
+	const int32 Neighbour{ Grid.GetNeighbour(NodeRef, Dir) };
+	if (!Grid.IsValidRef(Neighbour) || !Filter.IsTraversalAllowed(NodeRef, Neighbour))
+	{
+		return INDEX_NONE;
+	}
+	return Neighbour;
+}
+
+bool FHexJumpPointSearch::IsJumpPoint(const int32 PrevRef, const int32 NodeRef, const int32 Dir) const
+{
+	if (NodeRef == GoalRef || !Data.UniformTiles[NodeRef])
+	{
+		return true;
+	}
+
+	// Forced neighbour: the tile on this side of the previous step can't be entered but the one next to us can,
+	// the cheapest way there turns here. Obstacles on both sides (a corridor, a straight border) force nothing.
+	for (const int32 Side : { 1, 5 })
+	{
+		const int32 SideDir{ (Dir + Side) % 6 };
+		if (Step(PrevRef, SideDir) == INDEX_NONE && Step(NodeRef, SideDir) != INDEX_NONE)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FHexJumpPointSearch::ScanSecondary(int32 NodeRef, const int32 Dir, int32 &OutJumpRef, float &OutCost) const
+{
+	OutCost = 0.f;
+	for (;;)
+	{
+		const int32 Next{ Step(NodeRef, Dir) };
+		if (Next == INDEX_NONE)
+		{
+			return false;
+		}
+
+		OutCost += Filter.GetTraversalCost(NodeRef, Next);
+		if (IsJumpPoint(NodeRef, Next, Dir))
+		{
+			OutJumpRef = Next;
+			return true;
+		}
+		NodeRef = Next;
+	}
+}
+
+void FHexJumpPointSearch::ScanPrimary(const int32 NodeId, const int32 Dir)
+{
+	int32 NodeRef{ Pool->Nodes[NodeId].NodeRef };
+	float G{ Pool->Nodes[NodeId].G };
+
+	for (;;)
+	{
+		const int32 Next{ Step(NodeRef, Dir) };
+		if (Next == INDEX_NONE)
+		{
+			return;
+		}
+
+		G += Filter.GetTraversalCost(NodeRef, Next);
+		const bool bJumpPoint{ IsJumpPoint(NodeRef, Next, Dir) };
+		NodeRef = Next;
+
+		// Goal, boundary or forced neighbour: from here we need the regular expansion
+		if (bJumpPoint)
+		{
+			AddNode(NodeRef, ENodeKind::Full, 0, G, NodeId);
+			return;
+		}
+
+		// The secondary scan found a jump point, this tile is a turning point of a canonical path.
+		// Both are pushed now, the primary node only has to continue its scan when popped.
+		int32 JumpRef{ INDEX_NONE };
+		float JumpCost{ 0.f };
+		if (ScanSecondary(NodeRef, (Dir + 1) % 6, JumpRef, JumpCost))
+		{
+			if (AddNode(NodeRef, ENodeKind::Primary, Dir, G, NodeId))
+			{
+				AddNode(JumpRef, ENodeKind::Full, 0, G + JumpCost, GetNodeId(NodeRef, ENodeKind::Primary, Dir));
+			}
+			return;
+		}
+	}
+}
+
+void FHexJumpPointSearch::BuildPath(int32 NodeId, TArray<int32> &OutPath) const
+{
+	// Walk the jump points back to the start, then fill the straight lines between them.
+	TArray<int32> JumpPoints;
+	TArray<bool> ViaPortal;
+	for (; NodeId != INDEX_NONE; NodeId = Pool->Nodes[NodeId].ParentId)
+	{
+		JumpPoints.Add(Pool->Nodes[NodeId].NodeRef);
+		ViaPortal.Add(Pool->Nodes[NodeId].bViaPortal);
+	}
+	Algo::Reverse(JumpPoints);
+	Algo::Reverse(ViaPortal);
+
+	for (int32 Index{ 1 }; Index < JumpPoints.Num(); ++Index)
+	{
+		// A portal hop is a single step
+		if (ViaPortal[Index])
+		{
+			OutPath.Add(JumpPoints[Index]);
+			continue;
+		}
+
+		const FHPackedCoord From{ Grid.GetPackedCoord(JumpPoints[Index - 1]) };
+		const FHPackedCoord To{ Grid.GetPackedCoord(JumpPoints[Index]) };
+		const int32 Distance{ FHPackedCoord::Distance(From, To) };
+		const FHPackedCoord Unit((To.Q - From.Q) / Distance, (To.R - From.R) / Distance);
+
+		int32 Dir{ 0 };
+		while (Dir < 5 && FHPackedCoord::Direction(Dir) != Unit)
+		{
+			++Dir;
+		}
+
+		int32 NodeRef{ JumpPoints[Index - 1] };
+		for (int32 Steps{ 0 }; Steps < Distance; ++Steps)
+		{
+			NodeRef = Grid.GetNeighbour(NodeRef, Dir);
+			OutPath.Add(NodeRef);
+		}
+	}
+}
+//==== END OF FHexJumpPointSearch ====
@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexParallelSearch.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Reverse.h"
+
+
+FHexParallelSearch::FHexParallelSearch(const AHexGrid &InGrid, const FGridPathFilter &InFilter, const FHexJumpPointData &InData, const int32 InNumWorkers)
+	: Grid(InGrid), Filter(InFilter), Data(InData), NumWorkers(FMath::Max(InNumWorkers, 1))
+{
+}
+
+EGraphAStarResult FHexParallelSearch::FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath)
+{
+	OutPath.Reset();
+
+	if (!Grid.IsValidRef(StartNodeRef) || !Grid.IsValidRef(EndNodeRef))
+	{
+		return SearchFail;
+	}
+
+	if (StartNodeRef == EndNodeRef)
+	{
+		OutPath.Add(EndNodeRef);
+		return SearchSuccess;
+	}
+
+	GoalRef = EndNodeRef;
+	GoalExitDistance = Grid.GetDistanceFromPortalExit(Grid.GetPackedCoord(GoalRef));
+
+	// A new generation makes every node of the previous queries stale without touching them
+	Pool = &GetNodePool();
+	const int32 NumNodes{ Grid.GetNumTiles() };
+	if (++Pool->Generation == 0 || Pool->Nodes.Num() != NumNodes)
+	{
+		Pool->Nodes.Reset();
+		Pool->Nodes.SetNum(NumNodes);
+		Pool->Generation = 1;
+	}
+
+	Workers.Reset();
+	Workers.SetNum(NumWorkers);
+	for (FWorker &Worker : Workers)
+	{
+		Worker.Outboxes.SetNum(NumWorkers);
+	}
+
+	GetNode(StartNodeRef).G = 0.f;
+	Workers[GetOwner(StartNodeRef)].OpenList.HeapPush(FOpenEntry{ StartNodeRef, 0.f, GetHeuristic(StartNodeRef) }, FOpenEntry::FCheapestFirst());
+
+	while (true)
+	{
+		// Cost of the best path found so far, the goal is owned by a single worker but it's read between the phases
+		const float Incumbent{ GetNode(GoalRef).G };
+
+		// The heads of the open lists are a lower bound of every path we could still find (stale entries
+		// only make it lower), when even the best of them can't beat the incumbent the search is over
+		float MinF{ TNumericLimits<float>::Max() };
+		for (const FWorker &Worker : Workers)
+		{
+			if (Worker.OpenList.Num() > 0)
+			{
+				MinF = FMath::Min(MinF, Worker.OpenList.HeapTop().F);
+			}
+		}
+		if (MinF >= Incumbent)
+		{
+			break;
+		}
+
+		ParallelFor(NumWorkers, [this, Incumbent](const int32 WorkerIndex)
+		{
+			Expand(Workers[WorkerIndex], Incumbent);
+		});
+
+		ParallelFor(NumWorkers, [this](const int32 WorkerIndex)
+		{
+			Receive(WorkerIndex);
+		});
+	}
+
+	if (GetNode(GoalRef).ParentRef == INDEX_NONE)
+	{
+		return GoalUnreachable;
+	}
+
+	for (int32 NodeRef{ GoalRef }; NodeRef != StartNodeRef; NodeRef = GetNode(NodeRef).ParentRef)
+	{
+		OutPath.Add(NodeRef);
+	}
+	Algo::Reverse(OutPath);
+	return SearchSuccess;
+}
+
+int32 FHexParallelSearch::GetOwner(const int32 NodeRef) const
+{
+	// Neighbour tiles must go to different workers or a worker would get a whole front of the search,
+	// a multiplicative hash scatters the consecutive indices
+	return int32((uint32(NodeRef) * 2654435761u >> 16) % uint32(NumWorkers));
+}
+
+FHexParallelSearch::FNodePool &FHexParallelSearch::GetNodePool()
+{
+	// The workers write the nodes of the query, the pool belongs to the thread that waits for them
+	static thread_local FNodePool NodePool;
+	return NodePool;
+}
+
+FHexParallelSearch::FSearchNode &FHexParallelSearch::GetNode(const int32 NodeRef)
+{
+	FSearchNode &Node{ Pool->Nodes[NodeRef] };
+	if (Node.Generation != Pool->Generation)
+	{
+		Node = FSearchNode();
+		Node.Generation = Pool->Generation;
+	}
+	return Node;
+}
+
+float FHexParallelSearch::GetHeuristic(const int32 NodeRef) const
+{
+	// It never overestimates, so the first path to the goal isn't necessarily the best
+	// but no better path is missed before the search stops
+	return FHexJumpPointData::GetHeuristic(Grid, NodeRef, GoalRef, GoalExitDistance, Data.MinTileCost, Grid.GetMinPortalCost());
+}
+
+void FHexParallelSearch::Expand(FWorker &Worker, const float Incumbent)
+{
+	for (TArray<FMessage> &Outbox : Worker.Outboxes)
+	{
+		Outbox.Reset();
+	}
+
+	int32 NumExpanded{ 0 };
+	while (NumExpanded < BatchSize && Worker.OpenList.Num() > 0)
+	{
+		FOpenEntry Entry;
+		Worker.OpenList.HeapPop(Entry, FOpenEntry::FCheapestFirst(), false);
+
+		// Improved after the push, the better entry is still in the open list
+		const FSearchNode &Node{ GetNode(Entry.NodeRef) };
+		if (Entry.G > Node.G)
+		{
+			continue;
+		}
+
+		// Nothing behind this one can improve the path to the goal
+		if (Entry.F >= Incumbent)
+		{
+			Worker.OpenList.Reset();
+			break;
+		}
+
+		++NumExpanded;
+		if (Entry.NodeRef == GoalRef)
+		{
+			continue;
+		}
+
+		const int32 NumNeighbours{ Grid.GetNeighbourCount(Entry.NodeRef) };
+		for (int32 NeiIndex{ 0 }; NeiIndex < NumNeighbours; ++NeiIndex)
+		{
+			const int32 Neighbour{ Grid.GetNeighbour(Entry.NodeRef, NeiIndex) };
+			if (!Grid.IsValidRef(Neighbour) || Neighbour == Node.ParentRef || !Filter.IsTraversalAllowed(Entry.NodeRef, Neighbour))
+			{
+				continue;
+			}
+
+			const float G{ Entry.G + Filter.GetTraversalCost(Entry.NodeRef, Neighbour) };
+			if (G < Incumbent)
+			{
+				Worker.Outboxes[GetOwner(Neighbour)].Add(FMessage{ Neighbour, Entry.NodeRef, G });
+			}
+		}
+	}
+}
+
+void FHexParallelSearch::Receive(const int32 WorkerIndex)
+{
+	FWorker &Worker{ Workers[WorkerIndex] };
+	for (const FWorker &Sender : Workers)
+	{
+		for (const FMessage &Message : Sender.Outboxes[WorkerIndex])
+		{
+			FSearchNode &Node{ GetNode(Message.NodeRef) };
+			if (Message.G < Node.G)
+			{
+				Node.G = Message.G;
+				Node.ParentRef = Message.ParentRef;
+				Worker.OpenList.HeapPush(FOpenEntry{ Message.NodeRef, Message.G, Message.G + GetHeuristic(Message.NodeRef) }, FOpenEntry::FCheapestFirst());
+			}
+		}
+	}
+}
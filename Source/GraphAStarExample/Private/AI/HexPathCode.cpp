@@ -0,0 +1,246 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexPathCode.h"
+#include "HexGrid/HexGrid.h"
+#include "UObject/CoreNet.h"
+
+
+void FHexPathCode::Reset()
+{
+	StartIndex = INDEX_NONE;
+	NumSteps = 0;
+	StartGrid.Reset();
+	Codes.Reset();
+	Hops.Reset();
+}
+
+void FHexPathCode::SetStepDirection(const int32 Step, const int32 Dir)
+{
+	// A code can cross a byte boundary, so we write the bits one by one
+	const int32 FirstBit{ Step * BitsPerStep };
+	for (int32 Bit{ 0 }; Bit < BitsPerStep; ++Bit)
+	{
+		const int32 Position{ FirstBit + Bit };
+		if ((Dir >> Bit) & 1)
+		{
+			Codes[Position >> 3] |= uint8(1 << (Position & 7));
+		}
+		else
+		{
+			Codes[Position >> 3] &= uint8(~(1 << (Position & 7)));
+		}
+	}
+}
+
+bool FHexPathCode::Encode(AHexGrid &InStartGrid, const int32 InStartIndex, const TArray<int32> &PathIndices, const TArray<FHexPathGridSpan> &Spans)
+{
+	Reset();
+
+	if (!InStartGrid.IsValidRef(InStartIndex))
+	{
+		return false;
+	}
+
+	Codes.SetNumZeroed((PathIndices.Num() * BitsPerStep + 7) / 8);
+
+	AHexGrid *Grid{ &InStartGrid };
+	int32 Previous{ InStartIndex };
+	int32 SpanIndex{ 0 };
+	int32 SpanEnd{ Spans.Num() > 0 ? Spans[0].NumTiles : PathIndices.Num() };
+	for (int32 Step{ 0 }; Step < PathIndices.Num(); ++Step)
+	{
+		while (Step >= SpanEnd && SpanIndex + 1 < Spans.Num())
+		{
+			SpanEnd += Spans[++SpanIndex].NumTiles;
+		}
+
+		AHexGrid *StepGrid{ Spans.IsValidIndex(SpanIndex) && Spans[SpanIndex].Grid ? Spans[SpanIndex].Grid : Grid };
+		const int32 Current{ PathIndices[Step] };
+		if (!StepGrid->IsValidRef(Current))
+		{
+			Reset();
+			return false;
+		}
+
+		int32 Dir{ 0 };
+		if (StepGrid != Grid)
+		{
+			// A grid connection, the decoder can't guess where it leads
+			Dir = GridHop;
+			Hops.Add(FHexPathHop{ StepGrid, Current });
+			Grid = StepGrid;
+		}
+		else
+		{
+			const FHPackedCoord PreviousCoord{ Grid->GetPackedCoord(Previous) };
+			const FHPackedCoord CurrentCoord{ Grid->GetPackedCoord(Current) };
+			const FHPackedCoord Delta(CurrentCoord.Q - PreviousCoord.Q, CurrentCoord.R - PreviousCoord.R);
+
+			while (Dir < 6 && FHPackedCoord::Direction(Dir) != Delta)
+			{
+				++Dir;
+			}
+
+			// Not a neighbour, it must be a portal
+			if (Dir == 6)
+			{
+				if (Grid->FindPortalCost(Previous, Current) < 0.f)
+				{
+					Reset();
+					return false;
+				}
+				Dir = PortalHop;
+				Hops.Add(FHexPathHop{ nullptr, Current });
+			}
+		}
+
+		SetStepDirection(Step, Dir);
+		Previous = Current;
+	}
+
+	StartIndex = InStartIndex;
+	StartGrid = &InStartGrid;
+	NumSteps = PathIndices.Num();
+	return true;
+}
+
+bool FHexPathCode::Decode(AHexGrid &InStartGrid, TArray<int32> &OutPathIndices, TArray<FHexPathGridSpan> &OutSpans) const
+{
+	OutPathIndices.Reset(NumSteps);
+	OutSpans.Reset();
+
+	AHexGrid *Grid{ StartGrid.IsValid() ? StartGrid.Get() : &InStartGrid };
+	if (!Grid->IsValidRef(StartIndex) || Codes.Num() * 8 < NumSteps * BitsPerStep)
+	{
+		return false;
+	}
+
+	OutSpans.Add(FHexPathGridSpan{ Grid, 0 });
+
+	int32 Current{ StartIndex };
+	int32 NextHop{ 0 };
+	for (int32 Step{ 0 }; Step < NumSteps; ++Step)
+	{
+		const int32 Dir{ GetStepDirection(Step) };
+
+		int32 Next{ INDEX_NONE };
+		if (Dir < 6)
+		{
+			Next = Grid->GetPackedIndex(Grid->GetPackedCoord(Current) + FHPackedCoord::Direction(Dir));
+		}
+		else if (Hops.IsValidIndex(NextHop))
+		{
+			// The code can come from the network, the portal and the grid must exist here too
+			const FHexPathHop &Hop{ Hops[NextHop++] };
+			if (Dir == PortalHop && Grid->IsValidRef(Hop.TileIndex) && Grid->FindPortalCost(Current, Hop.TileIndex) >= 0.f)
+			{
+				Next = Hop.TileIndex;
+			}
+			else if (Dir == GridHop && Hop.Grid.IsValid() && Hop.Grid->IsValidRef(Hop.TileIndex))
+			{
+				Grid = Hop.Grid.Get();
+				Next = Hop.TileIndex;
+				OutSpans.Add(FHexPathGridSpan{ Grid, 0 });
+			}
+		}
+
+		if (Next == INDEX_NONE)
+		{
+			OutPathIndices.Reset();
+			OutSpans.Reset();
+			return false;
+		}
+
+		OutPathIndices.Add(Next);
+		++OutSpans.Last().NumTiles;
+		Current = Next;
+	}
+	return true;
+}
+
+bool FHexPathCode::NetSerialize(FArchive &Ar, UPackageMap *Map, bool &bOutSuccess)
+{
+	// StartIndex + 1 so the empty code is a small positive number too
+	uint32 PackedStart{ uint32(StartIndex + 1) };
+	uint32 PackedSteps{ uint32(NumSteps) };
+	Ar.SerializeIntPacked(PackedStart);
+	Ar.SerializeIntPacked(PackedSteps);
+
+	if (Ar.IsLoading())
+	{
+		// Don't trust the stream with the allocation size
+		if (PackedSteps > uint32(MaxNetSteps))
+		{
+			Ar.SetError();
+			Reset();
+			bOutSuccess = false;
+			return true;
+		}
+
+		StartIndex = int32(PackedStart) - 1;
+		NumSteps = int32(PackedSteps);
+		Codes.SetNumZeroed((NumSteps * BitsPerStep + 7) / 8);
+	}
+
+	// Only the used bits, not the padding of the last byte
+	if (NumSteps > 0)
+	{
+		Ar.SerializeBits(Codes.GetData(), NumSteps * BitsPerStep);
+	}
+
+	// The hops follow the order of the steps, so the step codes tell which ones have a grid
+	uint32 PackedHops{ uint32(Hops.Num()) };
+	Ar.SerializeIntPacked(PackedHops);
+	if (Ar.IsLoading())
+	{
+		if (PackedHops > uint32(NumSteps))
+		{
+			Ar.SetError();
+			Reset();
+			bOutSuccess = false;
+			return true;
+		}
+		Hops.Reset();
+		Hops.SetNum(int32(PackedHops));
+		StartGrid.Reset();
+		FilterClass = nullptr;
+	}
+
+	int32 HopIndex{ 0 };
+	for (int32 Step{ 0 }; Step < NumSteps && HopIndex < Hops.Num() && !Ar.IsError(); ++Step)
+	{
+		const int32 Dir{ GetStepDirection(Step) };
+		if (Dir < PortalHop)
+		{
+			continue;
+		}
+
+		FHexPathHop &Hop{ Hops[HopIndex++] };
+		uint32 PackedTile{ uint32(Hop.TileIndex + 1) };
+		Ar.SerializeIntPacked(PackedTile);
+		Hop.TileIndex = int32(PackedTile) - 1;
+
+		if (Dir == GridHop && Map)
+		{
+			UObject *HopGrid{ Hop.Grid.Get() };
+			Map->SerializeObject(Ar, AHexGrid::StaticClass(), HopGrid);
+			Hop.Grid = Cast<AHexGrid>(HopGrid);
+		}
+	}
+
+	// Objects need the package map, without it the decoder falls back to the HexGrid and the default cost model
+	if (Map)
+	{
+		UObject *Grid{ StartGrid.Get() };
+		Map->SerializeObject(Ar, AHexGrid::StaticClass(), Grid);
+		StartGrid = Cast<AHexGrid>(Grid);
+
+		UObject *Class{ FilterClass.Get() };
+		Map->SerializeObject(Ar, UClass::StaticClass(), Class);
+		FilterClass = Cast<UClass>(Class);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
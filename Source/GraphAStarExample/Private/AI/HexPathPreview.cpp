@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexPathPreview.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "Algo/Reverse.h"
+
+
+void FHexPathPreview::Reset(const AHexGrid &InGrid, const TSharedPtr<const FHexCompiledFilterProfile, ESPMode::ThreadSafe> &InProfile, const TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> &InBlendedCosts, const int32 InStartRef)
+{
+	Grid = &InGrid;
+	Profile = InProfile;
+	BlendedCosts = InBlendedCosts;
+	StartRef = InStartRef;
+	GridVersion = InGrid.GetGridVersion();
+
+	const int32 NumNodes{ InGrid.GetNumTiles() };
+	Costs.Init(TNumericLimits<float>::Max(), NumNodes);
+	Parents.Init(INDEX_NONE, NumNodes);
+	Settled.Init(false, NumNodes);
+	OpenList.Reset();
+	NumSettled = 0;
+
+	if (InGrid.IsValidRef(StartRef))
+	{
+		Costs[StartRef] = 0.f;
+		OpenList.HeapPush(FOpenEntry{ StartRef, 0.f }, FOpenEntry::FCheapestFirst());
+	}
+}
+
+bool FHexPathPreview::IsValidFor(const AHexGrid &InGrid, const TSharedPtr<const FHexCompiledFilterProfile, ESPMode::ThreadSafe> &InProfile, const TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> &InBlendedCosts, const int32 InStartRef) const
+{
+	// A new blend snapshot means the cost layers changed, the costs of the tree are old
+	return Grid == &InGrid && Profile == InProfile && BlendedCosts == InBlendedCosts && StartRef == InStartRef
+		&& GridVersion == InGrid.GetGridVersion() && Costs.Num() == InGrid.GetNumTiles();
+}
+
+EGraphAStarResult FHexPathPreview::FindPath(const FGridPathFilter &Filter, const int32 GoalRef, TArray<int32> &OutPath, float &OutCost)
+{
+	OutPath.Reset();
+	OutCost = 0.f;
+
+	if (!Grid || !Grid->IsValidRef(StartRef) || !Grid->IsValidRef(GoalRef))
+	{
+		return SearchFail;
+	}
+
+	// Resume the search until the goal is settled, whatever was settled for the previous goals stays valid
+	while (!Settled[GoalRef] && OpenList.Num() > 0)
+	{
+		FOpenEntry Entry;
+		OpenList.HeapPop(Entry, FOpenEntry::FCheapestFirst(), false);
+		if (Settled[Entry.NodeRef] || Entry.G > Costs[Entry.NodeRef])
+		{
+			continue;
+		}
+		Settled[Entry.NodeRef] = true;
+		++NumSettled;
+
+		const int32 NumNeighbours{ Grid->GetNeighbourCount(Entry.NodeRef) };
+		for (int32 NeiIndex{ 0 }; NeiIndex < NumNeighbours; ++NeiIndex)
+		{
+			const int32 Neighbour{ Grid->GetNeighbour(Entry.NodeRef, NeiIndex) };
+			if (!Grid->IsValidRef(Neighbour) || Settled[Neighbour] || !Filter.IsTraversalAllowed(Entry.NodeRef, Neighbour))
+			{
+				continue;
+			}
+
+			const float G{ Entry.G + Filter.GetTraversalCost(Entry.NodeRef, Neighbour) };
+			if (G < Costs[Neighbour])
+			{
+				Costs[Neighbour] = G;
+				Parents[Neighbour] = Entry.NodeRef;
+				OpenList.HeapPush(FOpenEntry{ Neighbour, G }, FOpenEntry::FCheapestFirst());
+			}
+		}
+	}
+
+	if (!Settled[GoalRef])
+	{
+		return GoalUnreachable;
+	}
+
+	for (int32 NodeRef{ GoalRef }; NodeRef != StartRef; NodeRef = Parents[NodeRef])
+	{
+		OutPath.Add(NodeRef);
+	}
+	Algo::Reverse(OutPath);
+	OutCost = Costs[GoalRef];
+	return SearchSuccess;
+}
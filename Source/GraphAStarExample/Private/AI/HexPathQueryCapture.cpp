@@ -0,0 +1,704 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexPathQueryCapture.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Engine/World.h"
+
+
+//==== Serialization ====
+
+namespace HexPathQueryCapture
+{
+	/* Only Q and R, S is redundant */
+	void SerializeCoord(FArchive &Ar, FHCubeCoord &Coord)
+	{
+		FHPackedCoord Packed(Coord);
+		Ar << Packed.Q;
+		Ar << Packed.R;
+		Coord = Packed.ToCube();
+	}
+
+	void SerializeAgent(FArchive &Ar, FNavAgentProperties &Agent)
+	{
+		Ar << Agent.AgentRadius;
+		Ar << Agent.AgentHeight;
+		Ar << Agent.AgentStepHeight;
+		Ar << Agent.NavWalkingSearchHeightScale;
+
+		// The movement capabilities are bitfields
+		uint8 Capabilities{ uint8(Agent.bCanCrouch | Agent.bCanJump << 1 | Agent.bCanWalk << 2 | Agent.bCanSwim << 3 | Agent.bCanFly << 4) };
+		Ar << Capabilities;
+		Agent.bCanCrouch = Capabilities & 1;
+		Agent.bCanJump = (Capabilities >> 1) & 1;
+		Agent.bCanWalk = (Capabilities >> 2) & 1;
+		Agent.bCanSwim = (Capabilities >> 3) & 1;
+		Agent.bCanFly = (Capabilities >> 4) & 1;
+
+		FString PreferredNavData{ Agent.PreferredNavData.ToString() };
+		Ar << PreferredNavData;
+		Agent.PreferredNavData = FSoftClassPath(PreferredNavData);
+	}
+}
+
+FArchive &operator<<(FArchive &Ar, FHexPathQueryCapture::FQueryRecord &Record)
+{
+	Ar << Record.Timestamp;
+	Ar << Record.GridVersion;
+	Ar << Record.StartLocation;
+	Ar << Record.EndLocation;
+	Ar << Record.FilterId;
+	HexPathQueryCapture::SerializeAgent(Ar, Record.AgentProperties);
+	Ar << Record.Result;
+	Ar << Record.PathLength;
+	Ar << Record.DurationMs;
+	return Ar;
+}
+
+FArchive &operator<<(FArchive &Ar, FHexPathQueryCapture::FTileRecord &Record)
+{
+	Ar << Record.TileIndex;
+	Ar << Record.Cost;
+	Ar << Record.bIsBlocking;
+	Ar << Record.TileClass;
+	return Ar;
+}
+
+FArchive &operator<<(FArchive &Ar, FHexPathQueryCapture::FPortalRecord &Record)
+{
+	HexPathQueryCapture::SerializeCoord(Ar, Record.From);
+	HexPathQueryCapture::SerializeCoord(Ar, Record.To);
+	Ar << Record.Cost;
+	return Ar;
+}
+
+FArchive &operator<<(FArchive &Ar, FHexPathQueryCapture::FCostLayerRecord &Record)
+{
+	// As a string, FName serialization needs a linker
+	FString Name{ Record.Name.ToString() };
+	Ar << Name;
+	Record.Name = FName(*Name);
+	Ar << Record.Values;
+	return Ar;
+}
+
+FArchive &operator<<(FArchive &Ar, FHexPathQueryCapture::FGridSnapshot &Snapshot)
+{
+	uint8 Orientation{ uint8(Snapshot.TileLayout.TileOrientation) };
+	Ar << Orientation;
+	Snapshot.TileLayout.TileOrientation = EHTileOrientationFlag(Orientation);
+	Ar << Snapshot.TileLayout.TileSize;
+	Ar << Snapshot.TileLayout.Origin;
+
+	Ar << Snapshot.Radius;
+	Ar << Snapshot.GridVersion;
+
+	int32 NumCoordinates{ Snapshot.Coordinates.Num() };
+	Ar << NumCoordinates;
+	if (Ar.IsLoading())
+	{
+		Snapshot.Coordinates.SetNum(NumCoordinates);
+	}
+	for (FHCubeCoord &Coord : Snapshot.Coordinates)
+	{
+		HexPathQueryCapture::SerializeCoord(Ar, Coord);
+	}
+
+	Ar << Snapshot.Tiles;
+	Ar << Snapshot.Portals;
+	Ar << Snapshot.CostLayers;
+	return Ar;
+}
+
+FArchive &operator<<(FArchive &Ar, FHexPathQueryCapture::FConnectionRecord &Record)
+{
+	Ar << Record.FromGrid;
+	HexPathQueryCapture::SerializeCoord(Ar, Record.FromTile);
+	Ar << Record.ToGrid;
+	HexPathQueryCapture::SerializeCoord(Ar, Record.ToTile);
+	Ar << Record.Cost;
+	Ar << Record.bTwoWay;
+	return Ar;
+}
+
+FArchive &operator<<(FArchive &Ar, FHexPathQueryCapture::FNavMeshSnapshot &Snapshot)
+{
+	Ar << Snapshot.bUseJumpPointSearch;
+	Ar << Snapshot.bUseParallelSearch;
+	Ar << Snapshot.ParallelSearchMinDistance;
+	Ar << Snapshot.ParallelSearchWorkers;
+	Ar << Snapshot.bDeterministicSearch;
+	Ar << Snapshot.bUseContractionHierarchy;
+	Ar << Snapshot.bUseAgentClearance;
+	Ar << Snapshot.CongestionCostWeight;
+
+	int32 NumWeights{ Snapshot.DefaultCostLayerWeights.Num() };
+	Ar << NumWeights;
+	if (Ar.IsLoading())
+	{
+		Snapshot.DefaultCostLayerWeights.SetNum(FMath::Max(NumWeights, 0));
+	}
+	for (FHexCostLayerWeight &Weight : Snapshot.DefaultCostLayerWeights)
+	{
+		FString Layer{ Weight.Layer.ToString() };
+		Ar << Layer;
+		Weight.Layer = FName(*Layer);
+		Ar << Weight.Weight;
+	}
+
+	Ar << Snapshot.Grids;
+	Ar << Snapshot.Connections;
+	return Ar;
+}
+//==== END OF Serialization ====
+
+
+//==== FHexPathQueryCapture ====
+
+FHexPathQueryCapture::~FHexPathQueryCapture()
+{
+	Stop();
+}
+
+void FHexPathQueryCapture::MakeGridSnapshot(const AHexGrid &Grid, FGridSnapshot &OutSnapshot)
+{
+	OutSnapshot.TileLayout = Grid.TileLayout;
+	OutSnapshot.Radius = Grid.Radius;
+	OutSnapshot.GridVersion = Grid.GetGridVersion();
+	OutSnapshot.Coordinates.Reset(Grid.GetNumTiles());
+	for (int32 TileIndex{ 0 }; TileIndex < Grid.GetNumTiles(); ++TileIndex)
+	{
+		OutSnapshot.Coordinates.Add(Grid.GetTileCoord(TileIndex));
+	}
+
+	OutSnapshot.Tiles.Reset(Grid.GetNumTileData());
+	for (int32 TileIndex{ 0 }; TileIndex < Grid.GetNumTileData(); ++TileIndex)
+	{
+		OutSnapshot.Tiles.Add(FTileRecord{ TileIndex, Grid.GetTileCost(TileIndex), Grid.IsTileBlocking(TileIndex), Grid.GetTileClass(TileIndex) });
+	}
+
+	MakePortalRecords(Grid, OutSnapshot.Portals);
+	MakeCostLayerRecords(Grid, OutSnapshot.CostLayers);
+}
+
+void FHexPathQueryCapture::MakePortalRecords(const AHexGrid &Grid, TArray<FPortalRecord> &OutPortals)
+{
+	OutPortals.Reset(Grid.GetPortals().Num());
+	for (const FHexPortal &Portal : Grid.GetPortals())
+	{
+		OutPortals.Add(FPortalRecord{ Portal.From, Portal.To, Portal.Cost });
+	}
+}
+
+void FHexPathQueryCapture::MakeCostLayerRecords(const AHexGrid &Grid, TArray<FCostLayerRecord> &OutCostLayers)
+{
+	OutCostLayers.Reset(Grid.GetNumCostLayers());
+	for (int32 LayerIndex{ 0 }; LayerIndex < Grid.GetNumCostLayers(); ++LayerIndex)
+	{
+		FCostLayerRecord &Layer{ OutCostLayers.AddDefaulted_GetRef() };
+		Layer.Name = Grid.GetCostLayerName(LayerIndex);
+		const TArrayView<const float> Values{ Grid.GetCostLayerValues(LayerIndex) };
+		Layer.Values.Append(Values.GetData(), Values.Num());
+	}
+}
+
+void FHexPathQueryCapture::MakeSnapshot(const AGraphAStarNavMesh &NavMesh, FNavMeshSnapshot &OutSnapshot)
+{
+	TArray<AHexGrid *> Grids;
+	NavMesh.GetHexGrids(Grids);
+
+	OutSnapshot.Grids.Reset(Grids.Num());
+	for (const AHexGrid *Grid : Grids)
+	{
+		MakeGridSnapshot(*Grid, OutSnapshot.Grids.AddDefaulted_GetRef());
+	}
+
+	// Connections of the grids we have, the others are ignored by the routing too
+	OutSnapshot.Connections.Reset();
+	for (const FHexGridConnection &Connection : NavMesh.GridConnections)
+	{
+		FConnectionRecord Record{ Grids.IndexOfByKey(Connection.FromGrid), Connection.FromTile, Grids.IndexOfByKey(Connection.ToGrid), Connection.ToTile,
+			Connection.Cost, Connection.bTwoWay };
+		if (Record.FromGrid != INDEX_NONE && Record.ToGrid != INDEX_NONE)
+		{
+			OutSnapshot.Connections.Add(Record);
+		}
+	}
+
+	OutSnapshot.bUseJumpPointSearch = NavMesh.bUseJumpPointSearch;
+	OutSnapshot.bUseParallelSearch = NavMesh.bUseParallelSearch;
+	OutSnapshot.ParallelSearchMinDistance = NavMesh.ParallelSearchMinDistance;
+	OutSnapshot.ParallelSearchWorkers = NavMesh.ParallelSearchWorkers;
+	OutSnapshot.bDeterministicSearch = NavMesh.bDeterministicSearch;
+	OutSnapshot.bUseContractionHierarchy = NavMesh.bUseContractionHierarchy;
+	OutSnapshot.bUseAgentClearance = NavMesh.bUseAgentClearance;
+	OutSnapshot.CongestionCostWeight = NavMesh.CongestionCostWeight;
+	OutSnapshot.DefaultCostLayerWeights = NavMesh.DefaultCostLayerWeights;
+}
+
+TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> FHexPathQueryCapture::Start(const FString &FileName, const AGraphAStarNavMesh &NavMesh)
+{
+	if (!NavMesh.HexGrid)
+	{
+		return nullptr;
+	}
+
+	TUniquePtr<FArchive> Writer{ IFileManager::Get().CreateFileWriter(*FileName) };
+	if (!Writer)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("FHexPathQueryCapture::Start(...) can't create %s"), *FileName);
+		return nullptr;
+	}
+
+	TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> Capture{ MakeShareable(new FHexPathQueryCapture()) };
+	Capture->FileName = FileName;
+	Capture->Writer = MoveTemp(Writer);
+	Capture->StartTime = FPlatformTime::Seconds();
+
+	uint32 Magic{ FileMagic };
+	uint32 Version{ FileVersion };
+	*Capture->Writer << Magic;
+	*Capture->Writer << Version;
+
+	FNavMeshSnapshot Snapshot;
+	MakeSnapshot(NavMesh, Snapshot);
+	*Capture->Writer << Snapshot;
+
+	TArray<AHexGrid *> Grids;
+	NavMesh.GetHexGrids(Grids);
+	for (const AHexGrid *Grid : Grids)
+	{
+		Capture->Grids.Add(Grid);
+		Capture->CostLayersVersions.Add(Grid->GetCostLayersVersion());
+	}
+
+	return Capture;
+}
+
+void FHexPathQueryCapture::RecordQuery(const FVector &StartLocation, const FVector &EndLocation, TSubclassOf<UNavigationQueryFilter> FilterClass,
+	const FNavAgentProperties &AgentProperties, const int32 GridVersion, const uint8 Result, const int32 PathLength, const float DurationMs)
+{
+	FScopeLock Lock(&WriterLock);
+	if (!Writer)
+	{
+		return;
+	}
+
+	FQueryRecord Record;
+	Record.Timestamp = FPlatformTime::Seconds() - StartTime;
+	Record.GridVersion = GridVersion;
+	Record.StartLocation = StartLocation;
+	Record.EndLocation = EndLocation;
+	Record.AgentProperties = AgentProperties;
+	Record.Result = Result;
+	Record.PathLength = PathLength;
+	Record.DurationMs = DurationMs;
+
+	if (FilterClass)
+	{
+		// The path of the class is written only the first time we see it
+		Record.FilterId = FilterClasses.IndexOfByKey(FilterClass);
+		if (Record.FilterId == INDEX_NONE)
+		{
+			Record.FilterId = FilterClasses.Add(FilterClass);
+
+			uint8 Type{ uint8(ERecordType::FilterClass) };
+			FString ClassPath{ FilterClass->GetPathName() };
+			*Writer << Type;
+			*Writer << ClassPath;
+		}
+	}
+
+	uint8 Type{ uint8(ERecordType::Query) };
+	*Writer << Type;
+	*Writer << Record;
+}
+
+void FHexPathQueryCapture::RecordTileChange(const AHexGrid &Grid, const FHexGridChange &Change)
+{
+	FScopeLock Lock(&WriterLock);
+	int32 GridId{ Grids.IndexOfByKey(&Grid) };
+	if (!Writer || GridId == INDEX_NONE)
+	{
+		return;
+	}
+
+	int32 GridVersion{ Change.GridVersion };
+	TArray<FTileRecord> Tiles;
+	Tiles.Reserve(Change.DirtyTiles.Num());
+	for (const int32 TileIndex : Change.DirtyTiles)
+	{
+		if (Grid.HasTileData(TileIndex))
+		{
+			Tiles.Add(FTileRecord{ TileIndex, Grid.GetTileCost(TileIndex), Grid.IsTileBlocking(TileIndex), Grid.GetTileClass(TileIndex) });
+		}
+	}
+
+	uint8 Type{ uint8(ERecordType::TileChange) };
+	*Writer << Type;
+	*Writer << GridId;
+	*Writer << GridVersion;
+	*Writer << Tiles;
+
+	// All the portals of the grid, a change is rare and the list is short
+	if (Change.bPortalsChanged)
+	{
+		TArray<FPortalRecord> Portals;
+		MakePortalRecords(Grid, Portals);
+
+		Type = uint8(ERecordType::Portals);
+		*Writer << Type;
+		*Writer << GridId;
+		*Writer << Portals;
+	}
+}
+
+void FHexPathQueryCapture::RecordCostLayers(const AHexGrid &Grid)
+{
+	FScopeLock Lock(&WriterLock);
+	int32 GridId{ Grids.IndexOfByKey(&Grid) };
+	if (!Writer || GridId == INDEX_NONE || CostLayersVersions[GridId] == Grid.GetCostLayersVersion())
+	{
+		return;
+	}
+	CostLayersVersions[GridId] = Grid.GetCostLayersVersion();
+
+	TArray<FCostLayerRecord> CostLayers;
+	MakeCostLayerRecords(Grid, CostLayers);
+
+	uint8 Type{ uint8(ERecordType::CostLayers) };
+	*Writer << Type;
+	*Writer << GridId;
+	*Writer << CostLayers;
+}
+
+void FHexPathQueryCapture::Stop()
+{
+	FScopeLock Lock(&WriterLock);
+	if (Writer)
+	{
+		uint8 Type{ uint8(ERecordType::End) };
+		*Writer << Type;
+		Writer->Close();
+		Writer.Reset();
+	}
+}
+//==== END OF FHexPathQueryCapture ====
+
+
+//==== FHexPathQueryReplay ====
+
+namespace HexPathQueryReplay
+{
+	/* Replace the portals of the grid */
+	void RestorePortals(const TArray<FHexPathQueryCapture::FPortalRecord> &Portals, AHexGrid &Grid)
+	{
+		Grid.BeginTileEdit();
+
+		// A copy, RemovePortal changes the array
+		const TArray<FHexPortal> OldPortals{ Grid.GetPortals() };
+		for (const FHexPortal &Portal : OldPortals)
+		{
+			Grid.RemovePortal(Portal.PortalId);
+		}
+
+		for (const FHexPathQueryCapture::FPortalRecord &Portal : Portals)
+		{
+			Grid.AddPortal(Portal.From, Portal.To, Portal.Cost, false);
+		}
+
+		Grid.CommitTileEdit();
+	}
+
+	/* Replace the cost layers of the grid */
+	void RestoreCostLayers(const TArray<FHexPathQueryCapture::FCostLayerRecord> &CostLayers, AHexGrid &Grid)
+	{
+		for (int32 LayerIndex{ Grid.GetNumCostLayers() - 1 }; LayerIndex >= 0; --LayerIndex)
+		{
+			const FName LayerName{ Grid.GetCostLayerName(LayerIndex) };
+			if (!CostLayers.ContainsByPredicate([&LayerName](const FHexPathQueryCapture::FCostLayerRecord &Layer) { return Layer.Name == LayerName; }))
+			{
+				Grid.RemoveCostLayer(LayerName);
+			}
+		}
+
+		for (const FHexPathQueryCapture::FCostLayerRecord &Layer : CostLayers)
+		{
+			const TArrayView<float> Values{ Grid.GetMutableCostLayerValues(Grid.AddCostLayer(Layer.Name)) };
+			FMemory::Memcpy(Values.GetData(), Layer.Values.GetData(), FMath::Min(Values.Num(), Layer.Values.Num()) * sizeof(float));
+		}
+		Grid.MarkCostLayersChanged();
+	}
+
+	/**
+	 * Rebuild a grid from its snapshot, with CreateGrid if the snapshot has its layout so we get the fast index lookup.
+	 * @return false if the snapshot is corrupted.
+	 */
+	bool RestoreGrid(const FHexPathQueryCapture::FGridSnapshot &Snapshot, AHexGrid &Grid)
+	{
+		// No key, the tiles of the snapshot must not be replaced by the ones registered for the map
+		Grid.SharedDataKey = NAME_None;
+		Grid.GridCoordinates.Reset();
+		Grid.GridTiles.Reset();
+		Grid.CreateGrid(Snapshot.TileLayout, Snapshot.Radius, FCreationStepDelegate());
+
+		bool bSameCoordinates{ Grid.GetNumTiles() == Snapshot.Coordinates.Num() };
+		for (int32 TileIndex{ 0 }; TileIndex < Snapshot.Coordinates.Num() && bSameCoordinates; ++TileIndex)
+		{
+			bSameCoordinates = Grid.GetTileCoord(TileIndex) == Snapshot.Coordinates[TileIndex];
+		}
+		if (!bSameCoordinates)
+		{
+			// A grid filled by hand, RebuildPackedCoordinates takes them below
+			Grid.GridCoordinates = Snapshot.Coordinates;
+		}
+
+		Grid.GridTiles.SetNum(Snapshot.Tiles.Num());
+		for (const FHexPathQueryCapture::FTileRecord &TileRecord : Snapshot.Tiles)
+		{
+			// The file could be truncated or come from another build
+			if (!Grid.GridTiles.IsValidIndex(TileRecord.TileIndex))
+			{
+				UE_LOG(LogGraphAStarExample_NavMesh, Error, TEXT("FHexPathQueryReplay::Run(...) tile %d of the snapshot is out of the grid"), TileRecord.TileIndex);
+				return false;
+			}
+
+			FHexTile &Tile{ Grid.GridTiles[TileRecord.TileIndex] };
+			if (Snapshot.Coordinates.IsValidIndex(TileRecord.TileIndex))
+			{
+				Tile.CubeCoord = Snapshot.Coordinates[TileRecord.TileIndex];
+				Tile.WorldPosition = Grid.HexToWorld(Tile.CubeCoord);
+			}
+			Tile.Cost = TileRecord.Cost;
+			Tile.bIsBlocking = TileRecord.bIsBlocking;
+			Tile.TileClass = TileRecord.TileClass;
+		}
+
+		// The shared data of the snapshot tiles
+		Grid.RebuildPackedCoordinates();
+
+		RestorePortals(Snapshot.Portals, Grid);
+		RestoreCostLayers(Snapshot.CostLayers, Grid);
+		return true;
+	}
+}
+
+bool FHexPathQueryReplay::Run(const FString &CaptureFileName, const FString &ReportFileName, AHexGrid &Grid, AGraphAStarNavMesh &NavMesh, FSummary &OutSummary)
+{
+	using namespace HexPathQueryReplay;
+
+	OutSummary = FSummary();
+
+	TUniquePtr<FArchive> Reader{ IFileManager::Get().CreateFileReader(*CaptureFileName) };
+	if (!Reader)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Error, TEXT("FHexPathQueryReplay::Run(...) can't open %s"), *CaptureFileName);
+		return false;
+	}
+
+	uint32 Magic{ 0 };
+	uint32 Version{ 0 };
+	*Reader << Magic;
+	*Reader << Version;
+	if (Magic != FHexPathQueryCapture::FileMagic || Version != FHexPathQueryCapture::FileVersion)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Error, TEXT("FHexPathQueryReplay::Run(...) %s is not a capture of this version"), *CaptureFileName);
+		return false;
+	}
+
+	FHexPathQueryCapture::FNavMeshSnapshot Snapshot;
+	*Reader << Snapshot;
+	if (Reader->IsError() || Snapshot.Grids.Num() == 0)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Error, TEXT("FHexPathQueryReplay::Run(...) %s has no valid snapshot"), *CaptureFileName);
+		return false;
+	}
+
+	// Grid is the HexGrid, the other grids of the capture are spawned next to it
+	TArray<AHexGrid *> Grids;
+	Grids.Add(&Grid);
+	for (int32 GridId{ 1 }; GridId < Snapshot.Grids.Num(); ++GridId)
+	{
+		AHexGrid *SpawnedGrid{ NavMesh.GetWorld() ? NavMesh.GetWorld()->SpawnActor<AHexGrid>() : nullptr };
+		if (!SpawnedGrid)
+		{
+			UE_LOG(LogGraphAStarExample_NavMesh, Error, TEXT("FHexPathQueryReplay::Run(...) can't spawn the grids of %s"), *CaptureFileName);
+			return false;
+		}
+		Grids.Add(SpawnedGrid);
+	}
+
+	for (int32 GridId{ 0 }; GridId < Grids.Num(); ++GridId)
+	{
+		if (!RestoreGrid(Snapshot.Grids[GridId], *Grids[GridId]))
+		{
+			return false;
+		}
+	}
+
+	// Before the grids are set, the preprocessing depends on them
+	NavMesh.bUseJumpPointSearch = Snapshot.bUseJumpPointSearch;
+	NavMesh.bUseParallelSearch = Snapshot.bUseParallelSearch;
+	NavMesh.ParallelSearchMinDistance = Snapshot.ParallelSearchMinDistance;
+	NavMesh.ParallelSearchWorkers = Snapshot.ParallelSearchWorkers;
+	NavMesh.bDeterministicSearch = Snapshot.bDeterministicSearch;
+	NavMesh.bUseContractionHierarchy = Snapshot.bUseContractionHierarchy;
+	NavMesh.bUseAgentClearance = Snapshot.bUseAgentClearance;
+	NavMesh.CongestionCostWeight = Snapshot.CongestionCostWeight;
+	NavMesh.DefaultCostLayerWeights = Snapshot.DefaultCostLayerWeights;
+
+	NavMesh.SetHexGrid(nullptr);
+	NavMesh.ClearGridConnections();
+	NavMesh.SetHexGrid(&Grid);
+	for (int32 GridId{ 1 }; GridId < Grids.Num(); ++GridId)
+	{
+		NavMesh.RegisterHexGrid(Grids[GridId]);
+	}
+
+	for (const FHexPathQueryCapture::FConnectionRecord &Record : Snapshot.Connections)
+	{
+		if (Grids.IsValidIndex(Record.FromGrid) && Grids.IsValidIndex(Record.ToGrid))
+		{
+			FHexGridConnection Connection;
+			Connection.FromGrid = Grids[Record.FromGrid];
+			Connection.FromTile = Record.FromTile;
+			Connection.ToGrid = Grids[Record.ToGrid];
+			Connection.ToTile = Record.ToTile;
+			Connection.Cost = Record.Cost;
+			Connection.bTwoWay = Record.bTwoWay;
+			NavMesh.AddGridConnection(Connection);
+		}
+	}
+	NavMesh.FlushCostBlends();
+
+	if (Snapshot.CongestionCostWeight > 0.f)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("FHexPathQueryReplay::Run(...) the capture used congestion costs, the occupants are not captured so results can differ"));
+	}
+
+	TArray<FSharedConstNavQueryFilter> Filters;
+	TArray<FString> ReportLines;
+	ReportLines.Add(TEXT("Query,Timestamp,GridVersion,CapturedResult,ReplayedResult,CapturedLength,ReplayedLength,CapturedMs,ReplayedMs,DeltaMs"));
+
+	for (;;)
+	{
+		uint8 Type{ uint8(FHexPathQueryCapture::ERecordType::End) };
+		*Reader << Type;
+		if (Reader->IsError() || (Reader->AtEnd() && Type != uint8(FHexPathQueryCapture::ERecordType::End)))
+		{
+			// Truncated capture (crash, still recording...), report what we have
+			UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("FHexPathQueryReplay::Run(...) %s is truncated"), *CaptureFileName);
+			break;
+		}
+
+		if (Type == uint8(FHexPathQueryCapture::ERecordType::End))
+		{
+			break;
+		}
+
+		if (Type == uint8(FHexPathQueryCapture::ERecordType::FilterClass))
+		{
+			FString ClassPath;
+			*Reader << ClassPath;
+
+			UClass *FilterClass{ LoadClass<UNavigationQueryFilter>(nullptr, *ClassPath) };
+			if (!FilterClass)
+			{
+				UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("FHexPathQueryReplay::Run(...) filter %s not found, using the default one"), *ClassPath);
+			}
+			Filters.Add(FilterClass ? UNavigationQueryFilter::GetQueryFilter(NavMesh, nullptr, FilterClass) : NavMesh.GetDefaultQueryFilter());
+		}
+		else if (Type == uint8(FHexPathQueryCapture::ERecordType::TileChange))
+		{
+			int32 GridId{ INDEX_NONE };
+			int32 GridVersion{ 0 };
+			TArray<FHexPathQueryCapture::FTileRecord> Tiles;
+			*Reader << GridId;
+			*Reader << GridVersion;
+			*Reader << Tiles;
+			if (!Grids.IsValidIndex(GridId))
+			{
+				UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("FHexPathQueryReplay::Run(...) %s refers to grid %d, it has %d"), *CaptureFileName, GridId, Grids.Num());
+				break;
+			}
+
+			// Same path of the game, so the navmesh patches its data like it did during the capture.
+			// The setters ignore the tiles out of the grid.
+			AHexGrid &ChangedGrid{ *Grids[GridId] };
+			ChangedGrid.BeginTileEdit();
+			for (const FHexPathQueryCapture::FTileRecord &Tile : Tiles)
+			{
+				ChangedGrid.SetTileCost(Tile.TileIndex, Tile.Cost);
+				ChangedGrid.SetTileBlocking(Tile.TileIndex, Tile.bIsBlocking);
+				ChangedGrid.SetTileClass(Tile.TileIndex, Tile.TileClass);
+			}
+			ChangedGrid.CommitTileEdit();
+
+			++OutSummary.NumTileChanges;
+		}
+		else if (Type == uint8(FHexPathQueryCapture::ERecordType::Portals) || Type == uint8(FHexPathQueryCapture::ERecordType::CostLayers))
+		{
+			int32 GridId{ INDEX_NONE };
+			*Reader << GridId;
+			if (!Grids.IsValidIndex(GridId))
+			{
+				UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("FHexPathQueryReplay::Run(...) %s refers to grid %d, it has %d"), *CaptureFileName, GridId, Grids.Num());
+				break;
+			}
+
+			if (Type == uint8(FHexPathQueryCapture::ERecordType::Portals))
+			{
+				TArray<FHexPathQueryCapture::FPortalRecord> Portals;
+				*Reader << Portals;
+				RestorePortals(Portals, *Grids[GridId]);
+			}
+			else
+			{
+				// The game rebuilt the blends in its tick, before the next queries
+				TArray<FHexPathQueryCapture::FCostLayerRecord> CostLayers;
+				*Reader << CostLayers;
+				RestoreCostLayers(CostLayers, *Grids[GridId]);
+				NavMesh.FlushCostBlends();
+			}
+		}
+		else
+		{
+			FHexPathQueryCapture::FQueryRecord Record;
+			*Reader << Record;
+
+			const FSharedConstNavQueryFilter Filter{ Filters.IsValidIndex(Record.FilterId) ? Filters[Record.FilterId] : NavMesh.GetDefaultQueryFilter() };
+			const FPathFindingQuery Query(nullptr, NavMesh, Record.StartLocation, Record.EndLocation, Filter);
+
+			const double QueryStartTime{ FPlatformTime::Seconds() };
+			const FPathFindingResult Result{ AGraphAStarNavMesh::FindPath(Record.AgentProperties, Query) };
+			const float ReplayedMs{ float((FPlatformTime::Seconds() - QueryStartTime) * 1000.0) };
+
+			const FHexNavMeshPath *HexPath{ Result.Path.IsValid() ? Result.Path->CastPath<FHexNavMeshPath>() : nullptr };
+			const int32 ReplayedLength{ Result.IsSuccessful() && HexPath ? HexPath->GetNumSteps() : 0 };
+
+			if (Result.Result != Record.Result || ReplayedLength != Record.PathLength)
+			{
+				++OutSummary.NumMismatches;
+			}
+
+			OutSummary.CapturedTotalMs += Record.DurationMs;
+			OutSummary.ReplayedTotalMs += ReplayedMs;
+
+			ReportLines.Add(FString::Printf(TEXT("%d,%.4f,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f"), OutSummary.NumQueries, Record.Timestamp, Record.GridVersion,
+				Record.Result, uint8(Result.Result), Record.PathLength, ReplayedLength, Record.DurationMs, ReplayedMs, ReplayedMs - Record.DurationMs));
+
+			++OutSummary.NumQueries;
+		}
+	}
+
+	if (!ReportFileName.IsEmpty() && !FFileHelper::SaveStringArrayToFile(ReportLines, *ReportFileName))
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Warning, TEXT("FHexPathQueryReplay::Run(...) can't write %s"), *ReportFileName);
+	}
+
+	return true;
+}
+//==== END OF FHexPathQueryReplay ====
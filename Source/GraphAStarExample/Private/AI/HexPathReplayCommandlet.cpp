@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexPathReplayCommandlet.h"
+#include "HexPathQueryCapture.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+
+UHexPathReplayCommandlet::UHexPathReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UHexPathReplayCommandlet::Main(const FString &Params)
+{
+	FString CaptureFileName;
+	if (!FParse::Value(*Params, TEXT("Capture="), CaptureFileName))
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Error, TEXT("HexPathReplay: missing -Capture=<file>"));
+		return 1;
+	}
+
+	FString ReportFileName{ CaptureFileName + TEXT(".csv") };
+	FParse::Value(*Params, TEXT("Report="), ReportFileName);
+
+	UClass *NavMeshClass{ AGraphAStarNavMesh::StaticClass() };
+	FString NavMeshClassPath;
+	if (FParse::Value(*Params, TEXT("NavMeshClass="), NavMeshClassPath))
+	{
+		NavMeshClass = LoadClass<AGraphAStarNavMesh>(nullptr, *NavMeshClassPath);
+		if (!NavMeshClass)
+		{
+			UE_LOG(LogGraphAStarExample_NavMesh, Error, TEXT("HexPathReplay: %s is not a AGraphAStarNavMesh class"), *NavMeshClassPath);
+			return 1;
+		}
+	}
+
+	// An empty world with only the grid and the navmesh, we don't need the level
+	UWorld *World{ UWorld::CreateWorld(EWorldType::Game, false) };
+	FWorldContext &WorldContext{ GEngine->CreateNewWorldContext(EWorldType::Game) };
+	WorldContext.SetCurrentWorld(World);
+
+	AHexGrid *Grid{ World->SpawnActor<AHexGrid>() };
+	AGraphAStarNavMesh *NavMesh{ World->SpawnActor<AGraphAStarNavMesh>(NavMeshClass) };
+
+	FHexPathQueryReplay::FSummary Summary;
+	const bool bReplayed{ Grid && NavMesh && FHexPathQueryReplay::Run(CaptureFileName, ReportFileName, *Grid, *NavMesh, Summary) };
+
+	if (bReplayed)
+	{
+		UE_LOG(LogGraphAStarExample_NavMesh, Display, TEXT("HexPathReplay: %d queries, %d tile changes, %d mismatches"),
+			Summary.NumQueries, Summary.NumTileChanges, Summary.NumMismatches);
+		UE_LOG(LogGraphAStarExample_NavMesh, Display, TEXT("HexPathReplay: captured %.3f ms, replayed %.3f ms (%+.1f%%), report in %s"),
+			Summary.CapturedTotalMs, Summary.ReplayedTotalMs,
+			Summary.CapturedTotalMs > 0.0 ? 100.0 * (Summary.ReplayedTotalMs - Summary.CapturedTotalMs) / Summary.CapturedTotalMs : 0.0,
+			*ReportFileName);
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	return bReplayed && Summary.NumMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexFieldOfView.h"
+#include "HexGrid.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("HexGrid Field Of View"), STAT_HexGridFieldOfView, STATGROUP_HEXGRID);
+
+
+namespace HexFieldOfView
+{
+	/* Angular interval in fractions of the full turn, [0, 1) starting from the corner in direction 5 */
+	struct FShadow
+	{
+		float Start;
+		float End;
+	};
+
+	using FShadowList = TArray<FShadow, TInlineAllocator<32>>;
+
+	/*
+	 * Edges and centers are computed as a single division of integers, so the same angle reached from two rings
+	 * is the same float and a center exactly on the edge of a shadow is visible (shadows are open intervals).
+	 */
+	FORCEINLINE float GetAngle(const int32 Numerator, const int32 Denominator)
+	{
+		return float(Numerator) / float(Denominator);
+	}
+
+	bool IsShadowed(const FShadowList &Shadows, const float Angle)
+	{
+		for (const FShadow &Shadow : Shadows)
+		{
+			// A shadow across the start of the turn is split in two, [0, End] covers the angle 0 too
+			if ((Shadow.Start < Angle || (Angle == 0.f && Shadow.Start <= 0.f)) && Angle < Shadow.End)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool IsFullyShadowed(const FShadowList &Shadows)
+	{
+		return Shadows.Num() == 1 && Shadows[0].Start <= 0.f && Shadows[0].End >= 1.f;
+	}
+
+	/* Insert keeping the list sorted and merged, touching shadows become one */
+	void AddShadow(FShadowList &Shadows, float Start, float End)
+	{
+		int32 First{ 0 };
+		while (First < Shadows.Num() && Shadows[First].End < Start)
+		{
+			++First;
+		}
+
+		int32 Last{ First };
+		while (Last < Shadows.Num() && Shadows[Last].Start <= End)
+		{
+			Start = FMath::Min(Start, Shadows[Last].Start);
+			End = FMath::Max(End, Shadows[Last].End);
+			++Last;
+		}
+
+		Shadows.RemoveAt(First, Last - First, false);
+		Shadows.Insert(FShadow{ Start, End }, First);
+	}
+}
+
+
+void FHexFieldOfView::Compute(const AHexGrid &Grid, const int32 InCenterIndex, const int32 InRadius)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HexGridFieldOfView);
+	using namespace HexFieldOfView;
+
+	Radius = FMath::Max(InRadius, 0);
+	const int32 Side{ 2 * Radius + 1 };
+	VisibleBits.Init(false, Side * Side);
+
+	if (!Grid.IsValidRef(InCenterIndex))
+	{
+		CenterIndex = INDEX_NONE;
+		return;
+	}
+
+	CenterIndex = InCenterIndex;
+	Center = Grid.GetPackedCoord(CenterIndex);
+	VisibleBits[GetBitIndex(0, 0)] = true;
+
+	// Coordinates outside of the grid block the view like walls
+	const auto IsOpaque{ [&Grid](const int32 TileIndex)
+	{
+		return TileIndex == INDEX_NONE || Grid.IsTileBlocking(TileIndex);
+	} };
+
+	FShadowList Shadows;
+	FShadowList RingShadows;
+	const FHPackedCoord StartCorner{ FHPackedCoord::Direction(5) };
+
+	for (int32 Ring{ 1 }; Ring <= Radius && !IsFullyShadowed(Shadows); ++Ring)
+	{
+		// Same walk of UHexGridQueryLibrary::Ring, the position on the ring grows with the angle
+		FHPackedCoord Current(Center.Q + StartCorner.Q * Ring, Center.R + StartCorner.R * Ring);
+		const int32 RingSize{ 6 * Ring };
+		int32 Position{ 0 };
+
+		// Tiles of the same ring don't hide each other, their shadows are added after the whole ring
+		RingShadows.Reset();
+		for (int32 SideIndex{ 0 }; SideIndex < 6; ++SideIndex)
+		{
+			const FHPackedCoord Dir{ FHPackedCoord::Direction((SideIndex + 1) % 6) };
+			for (int32 Step{ 0 }; Step < Ring; ++Step, ++Position)
+			{
+				const int32 TileIndex{ Grid.GetPackedIndex(Current) };
+				if (TileIndex != INDEX_NONE && !IsShadowed(Shadows, GetAngle(Position, RingSize)))
+				{
+					VisibleBits[GetBitIndex(Current.Q - Center.Q, Current.R - Center.R)] = true;
+				}
+
+				if (IsOpaque(TileIndex))
+				{
+					RingShadows.Add(FShadow{ GetAngle(2 * Position - 1, 2 * RingSize), GetAngle(2 * Position + 1, 2 * RingSize) });
+				}
+
+				Current = Current + Dir;
+			}
+		}
+
+		for (const FShadow &Shadow : RingShadows)
+		{
+			if (Shadow.Start < 0.f)
+			{
+				AddShadow(Shadows, Shadow.Start + 1.f, 1.f);
+				AddShadow(Shadows, 0.f, Shadow.End);
+			}
+			else
+			{
+				AddShadow(Shadows, Shadow.Start, Shadow.End);
+			}
+		}
+	}
+}
+
+void FHexFieldOfView::Reset()
+{
+	CenterIndex = INDEX_NONE;
+	VisibleBits.Init(false, VisibleBits.Num());
+}
+
+bool FHexFieldOfView::IsVisible(const FHPackedCoord &Coord) const
+{
+	if (CenterIndex == INDEX_NONE || FHPackedCoord::Distance(Coord, Center) > Radius)
+	{
+		return false;
+	}
+	return VisibleBits[GetBitIndex(Coord.Q - Center.Q, Coord.R - Center.R)];
+}
+
+bool FHexFieldOfView::IsVisible(const AHexGrid &Grid, const int32 TileIndex) const
+{
+	return Grid.IsValidRef(TileIndex) && IsVisible(Grid.GetPackedCoord(TileIndex));
+}
+
+void FHexFieldOfView::GetVisibleTiles(const AHexGrid &Grid, TArray<int32> &OutIndices) const
+{
+	OutIndices.Reset();
+	if (CenterIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 Side{ 2 * Radius + 1 };
+	for (TConstSetBitIterator<> It(VisibleBits); It; ++It)
+	{
+		const int32 DQ{ It.GetIndex() / Side - Radius };
+		const int32 DR{ It.GetIndex() % Side - Radius };
+		const int32 TileIndex{ Grid.GetPackedIndex(FHPackedCoord(Center.Q + DQ, Center.R + DR)) };
+		if (TileIndex != INDEX_NONE)
+		{
+			OutIndices.Add(TileIndex);
+		}
+	}
+}
+
+
+FHexVisibilityCache::FHexVisibilityCache(AHexGrid &InGrid)
+	: Grid(&InGrid), NumGridTiles(InGrid.GetNumTiles())
+{
+	TilesChangedHandle = InGrid.OnTilesChangedNative.AddRaw(this, &FHexVisibilityCache::OnTilesChanged);
+}
+
+FHexVisibilityCache::~FHexVisibilityCache()
+{
+	if (AHexGrid *HexGrid{ Grid.Get() })
+	{
+		HexGrid->OnTilesChangedNative.Remove(TilesChangedHandle);
+	}
+}
+
+int32 FHexVisibilityCache::AddObserver()
+{
+	const int32 ObserverId{ FreeObserverIds.Num() > 0 ? FreeObserverIds.Pop(false) : Observers.AddDefaulted() };
+	FObserver &Observer{ Observers[ObserverId] };
+	Observer.TileIndex = INDEX_NONE;
+	Observer.Radius = 0;
+	Observer.bInUse = true;
+	Observer.bStale = false;
+	Observer.FieldOfView.Reset();
+	return ObserverId;
+}
+
+void FHexVisibilityCache::RemoveObserver(const int32 ObserverId)
+{
+	if (Observers.IsValidIndex(ObserverId) && Observers[ObserverId].bInUse)
+	{
+		Observers[ObserverId].bInUse = false;
+		Observers[ObserverId].bStale = false;
+		FreeObserverIds.Add(ObserverId);
+	}
+}
+
+void FHexVisibilityCache::SetObserver(const int32 ObserverId, const int32 TileIndex, const int32 Radius)
+{
+	if (!Observers.IsValidIndex(ObserverId) || !Observers[ObserverId].bInUse)
+	{
+		return;
+	}
+
+	FObserver &Observer{ Observers[ObserverId] };
+	if (Observer.TileIndex != TileIndex || Observer.Radius != Radius)
+	{
+		Observer.TileIndex = TileIndex;
+		Observer.Radius = Radius;
+		Observer.bStale = true;
+	}
+}
+
+void FHexVisibilityCache::Update()
+{
+	NumLastUpdated = 0;
+
+	const AHexGrid *HexGrid{ Grid.Get() };
+	if (!HexGrid)
+	{
+		return;
+	}
+
+	// CreateGrid doesn't notify the listeners, the old indices mean nothing now
+	const bool bGridRecreated{ HexGrid->GetNumTiles() != NumGridTiles };
+	NumGridTiles = HexGrid->GetNumTiles();
+
+	StaleObservers.Reset();
+	for (int32 ObserverId{ 0 }; ObserverId < Observers.Num(); ++ObserverId)
+	{
+		const FObserver &Observer{ Observers[ObserverId] };
+		if (Observer.bInUse && (Observer.bStale || bGridRecreated))
+		{
+			StaleObservers.Add(ObserverId);
+		}
+	}
+
+	// Each field writes only its own bits
+	ParallelFor(StaleObservers.Num(), [this, HexGrid](const int32 StaleIndex)
+	{
+		FObserver &Observer{ Observers[StaleObservers[StaleIndex]] };
+		Observer.FieldOfView.Compute(*HexGrid, Observer.TileIndex, Observer.Radius);
+		Observer.bStale = false;
+	}, StaleObservers.Num() < 2);
+
+	NumLastUpdated = StaleObservers.Num();
+}
+
+const FHexFieldOfView *FHexVisibilityCache::GetFieldOfView(const int32 ObserverId) const
+{
+	return Observers.IsValidIndex(ObserverId) && Observers[ObserverId].bInUse ? &Observers[ObserverId].FieldOfView : nullptr;
+}
+
+bool FHexVisibilityCache::IsTileVisible(const int32 ObserverId, const int32 TileIndex) const
+{
+	const FHexFieldOfView *FieldOfView{ GetFieldOfView(ObserverId) };
+	const AHexGrid *HexGrid{ Grid.Get() };
+	return FieldOfView && HexGrid && FieldOfView->IsVisible(*HexGrid, TileIndex);
+}
+
+void FHexVisibilityCache::OnTilesChanged(const FHexGridChange &Change)
+{
+	// Only the blocking flags cast shadows
+	const AHexGrid *HexGrid{ Grid.Get() };
+	if (!HexGrid || !Change.bBlockingChanged)
+	{
+		return;
+	}
+
+	for (FObserver &Observer : Observers)
+	{
+		if (!Observer.bInUse || Observer.bStale || !HexGrid->IsValidRef(Observer.TileIndex))
+		{
+			continue;
+		}
+
+		const FHPackedCoord ObserverCoord{ HexGrid->GetPackedCoord(Observer.TileIndex) };
+		for (const int32 DirtyTile : Change.DirtyTiles)
+		{
+			if (HexGrid->IsValidRef(DirtyTile) && FHPackedCoord::Distance(ObserverCoord, HexGrid->GetPackedCoord(DirtyTile)) <= Observer.Radius)
+			{
+				Observer.bStale = true;
+				break;
+			}
+		}
+	}
+}
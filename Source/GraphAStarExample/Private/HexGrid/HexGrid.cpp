@@ -32,6 +32,10 @@ void AHexGrid::CreateGrid(const FHTileLayout &TLayout, const int32 GridRadius, c
 	SCOPE_CYCLE_COUNTER(STAT_CreateGrid);
 
 
+	TileLayout = TLayout;
+	
+	Radius = GridRadius;
+
 	// https://www.unrealengine.com/en-US/blog/optimizing-tarray-usage-for-performance
 	// preallocate array memory
 	// R1 = 1 + 6*1
@@ -44,21 +48,15 @@ void AHexGrid::CreateGrid(const FHTileLayout &TLayout, const int32 GridRadius, c
 	{
 		Size += 6 * i;
 	}
-	GridCoordinates.Reserve(Size);
 
-	// Check if we provided a delegate, if yes we also reserve space in the GridTiles array.
-	if (CreationStepDelegate.IsBound())
-	{
-		GridTiles.Reserve(Size);		
-	}
-	else
-	{
-		UE_LOG(LogGraphAStarExample_HexGrid, Warning, TEXT("AHexGrid::CreateGrid(...) CreationStepDelegate not bound!"));
-	}
+	// Packed right away, they go in the shared data and the grid keeps no other copy
+	TArray<FHPackedCoord> Coordinates;
+	Coordinates.Reserve(Size);
+	GridCoordinates.Empty();
+	GridTiles.Reset();
 
-	TileLayout = TLayout;
-	
-	Radius = GridRadius;
+	// The old lookups would answer for the old coordinates while the delegate runs
+	ReleaseSharedData();
 
 	for (int32 Q{ -Radius }; Q <= Radius; ++Q)
 	{
@@ -70,14 +68,44 @@ void AHexGrid::CreateGrid(const FHTileLayout &TLayout, const int32 GridRadius, c
 
 		for (int32 R{ R1 }; R <= R2; ++R)
 		{
-			FHCubeCoord CCoord{ FIntVector(Q, R, -Q - R) };
-			GridCoordinates.Add(CCoord);
+			Coordinates.Add(FHPackedCoord(Q, R));
+		}
+	}
+
+	// Another world already built this map with the same key: the tiles are in the shared data, nothing to add
+	FHexGridSharedDataPtr Registered{ FHexGridSharedData::FindByKey(SharedDataKey, Radius, Coordinates) };
+	if (Registered.IsValid())
+	{
+		UE_LOG(LogGraphAStarExample_HexGrid, Verbose, TEXT("AHexGrid::CreateGrid(...) %s reuses the tiles of key %s"), *GetName(), *SharedDataKey.ToString());
+		UseSharedData(MoveTemp(Registered));
+	}
+	else
+	{
+		// Check if we provided a delegate, if yes we also reserve space in the GridTiles array.
+		if (CreationStepDelegate.IsBound())
+		{
+			GridTiles.Reserve(Size);
+		}
+		else
+		{
+			UE_LOG(LogGraphAStarExample_HexGrid, Warning, TEXT("AHexGrid::CreateGrid(...) CreationStepDelegate not bound!"));
+		}
 
-			// If we provided a delegate execute it, with this we can make additional operations on each step of the loop,
-			// in our example i use it in the blueprint to add a tile on each cube coordinate. 
-			CreationStepDelegate.ExecuteIfBound(TileLayout, CCoord);
+		// If we provided a delegate execute it, with this we can make additional operations on each step of the loop,
+		// in our example i use it in the blueprint to add a tile on each cube coordinate.
+		for (const FHPackedCoord &Coord : Coordinates)
+		{
+			CreationStepDelegate.ExecuteIfBound(TileLayout, Coord.ToCube());
 		}
+
+		// The delegate filled the tiles, they are moved into the shared data.
+		// Packed coordinates, tiles, columns and clearance come from the registry if another world already built this map.
+		AcquireSharedData(MoveTemp(Coordinates));
 	}
+
+	// Portals added before the grid was (re)created
+	RebuildPortalIndex();
+	ResetCostLayers();
 }
 
 
@@ -180,3 +208,906 @@ FHCubeCoord AHexGrid::GetNeighbor(const FHCubeCoord &H, const FHCubeCoord &Dir)
 	return H + Dir;
 }
 
+
+int32 AHexGrid::GetCoordIndex(const FHCubeCoord &H) const
+{
+	// Farther than any tile can be, and it couldn't be packed
+	if (!FHPackedCoord::CanPack(H))
+	{
+		return INDEX_NONE;
+	}
+
+	// No columns means the grid wasn't built by CreateGrid (maybe filled by hand in blueprint)
+	// so we can't make any assumption on the order of the array.
+	if (!HasColumnLayout())
+	{
+		return PackedCoordinates.IndexOfByKey(FHPackedCoord(H));
+	}
+
+	const int32 Q{ H.QRS.X };
+	const int32 R{ H.QRS.Y };
+	if (FMath::Abs(Q) > Radius)
+	{
+		return INDEX_NONE;
+	}
+
+	// Same bounds of the CreateGrid inner loop
+	const int32 R1{ FMath::Max(-Radius, -Q - Radius) };
+	const int32 R2{ FMath::Min(Radius, -Q + Radius) };
+	if (R < R1 || R > R2)
+	{
+		return INDEX_NONE;
+	}
+
+	// The shared coordinates can't change, the column layout was checked when they were built
+	return ColumnOffsets[Q + Radius] + (R - R1);
+}
+
+
+FBox AHexGrid::GetGridBounds()
+{
+	FBox Bounds{ ForceInit };
+	for (const FHPackedCoord &P : PackedCoordinates)
+	{
+		Bounds += HexToWorld(P.ToCube());
+	}
+
+	// Centers only so far, add the tile radius around them (and the same height, for the path point offsets)
+	return Bounds.IsValid ? Bounds.ExpandBy(FVector(TileLayout.TileSize, TileLayout.TileSize, TileLayout.TileSize)) : Bounds;
+}
+
+FHexTile AHexGrid::GetTile(int32 TileIndex)
+{
+	FHexTile Tile;
+	if (HasTileData(TileIndex))
+	{
+		Tile.CubeCoord = GetTileCoord(TileIndex);
+		Tile.WorldPosition = HexToWorld(Tile.CubeCoord);
+		Tile.Cost = GetTileCost(TileIndex);
+		Tile.bIsBlocking = IsTileBlocking(TileIndex);
+		Tile.TileClass = GetTileClass(TileIndex);
+	}
+	return Tile;
+}
+
+void AHexGrid::RebuildPackedCoordinates()
+{
+	// Nothing filled by hand, the shared data is already the one of this grid
+	if (!HasPendingTiles())
+	{
+		return;
+	}
+
+	// The coordinates filled by hand replace the current ones, otherwise we keep them and take the new tiles
+	TArray<FHPackedCoord> Coordinates;
+	if (GridCoordinates.Num() > 0)
+	{
+		Coordinates.Reserve(GridCoordinates.Num());
+		for (const FHCubeCoord &H : GridCoordinates)
+		{
+			Coordinates.Add(FHPackedCoord(H));
+		}
+		GridCoordinates.Empty();
+	}
+	else
+	{
+		Coordinates.Append(PackedCoordinates.GetData(), PackedCoordinates.Num());
+	}
+
+	AcquireSharedData(MoveTemp(Coordinates));
+
+	// Indices could have changed too
+	RebuildPortalIndex();
+
+	// Indices of the layer values could be different now
+	if (CostLayers.Num() > 0 && CostLayers[0].Values.Num() != GetNumTiles())
+	{
+		ResetCostLayers();
+	}
+}
+
+
+//==== Tile edits ====
+
+void AHexGrid::BeginTileEdit()
+{
+	++EditDepth;
+}
+
+void AHexGrid::SetTileCost(int32 TileIndex, float NewCost)
+{
+	if (!HasTileData(TileIndex))
+	{
+		return;
+	}
+
+	NewCost = FMath::Max(NewCost, 1.f);
+	FTileState State{ GetTileState(TileIndex) };
+	if (State.Cost != NewCost)
+	{
+		BeginTileEdit();
+		State.Cost = NewCost;
+		SetTileState(TileIndex, State);
+		PendingChange.bCostChanged = true;
+		MarkTileDirty(TileIndex);
+		CommitTileEdit();
+	}
+}
+
+void AHexGrid::SetTileBlocking(int32 TileIndex, bool bNewIsBlocking)
+{
+	if (!HasTileData(TileIndex))
+	{
+		return;
+	}
+
+	FTileState State{ GetTileState(TileIndex) };
+	if (State.bIsBlocking != bNewIsBlocking)
+	{
+		BeginTileEdit();
+		State.bIsBlocking = bNewIsBlocking;
+		SetTileState(TileIndex, State);
+		PendingChange.bBlockingChanged = true;
+		MarkTileDirty(TileIndex);
+		CommitTileEdit();
+	}
+}
+
+void AHexGrid::SetTileClass(int32 TileIndex, uint8 NewTileClass)
+{
+	if (!HasTileData(TileIndex))
+	{
+		return;
+	}
+
+	FTileState State{ GetTileState(TileIndex) };
+	if (State.TileClass != NewTileClass)
+	{
+		BeginTileEdit();
+		State.TileClass = NewTileClass;
+		SetTileState(TileIndex, State);
+		PendingChange.bTileClassChanged = true;
+		MarkTileDirty(TileIndex);
+		CommitTileEdit();
+	}
+}
+
+AHexGrid::FTileState AHexGrid::GetTileState(const int32 TileIndex) const
+{
+	if (const FTileState *Edited{ TileOverlay.Find(TileIndex) })
+	{
+		return *Edited;
+	}
+	return FTileState{ TileBaseCosts[TileIndex], (*TileBaseBlocking)[TileIndex], TileBaseClasses[TileIndex] };
+}
+
+void AHexGrid::SetTileState(const int32 TileIndex, const FTileState &State)
+{
+	// The shared tiles stay the ones of the build, we keep only the differences
+	if (State.Cost == TileBaseCosts[TileIndex] && State.bIsBlocking == (*TileBaseBlocking)[TileIndex] && State.TileClass == TileBaseClasses[TileIndex])
+	{
+		TileOverlay.Remove(TileIndex);
+	}
+	else
+	{
+		TileOverlay.Add(TileIndex, State);
+	}
+}
+
+void AHexGrid::MarkTileDirty(int32 TileIndex)
+{
+	if (DirtyTileBits.Num() != GetNumTiles())
+	{
+		DirtyTileBits.Init(false, GetNumTiles());
+	}
+	DirtyTileBits[TileIndex] = true;
+}
+
+void AHexGrid::CommitTileEdit()
+{
+	if (!ensureMsgf(EditDepth > 0, TEXT("AHexGrid::CommitTileEdit() called without BeginTileEdit()")))
+	{
+		return;
+	}
+
+	// Only the outermost batch notifies
+	if (--EditDepth > 0)
+	{
+		return;
+	}
+
+	// Turn the bits into sorted indices and ranges, so listeners don't need to scan the whole grid.
+	for (TConstSetBitIterator<> It(DirtyTileBits); It; ++It)
+	{
+		const int32 TileIndex{ It.GetIndex() };
+		PendingChange.DirtyTiles.Add(TileIndex);
+
+		if (PendingChange.DirtyRanges.Num() > 0 && PendingChange.DirtyRanges.Last().Last == TileIndex - 1)
+		{
+			PendingChange.DirtyRanges.Last().Last = TileIndex;
+		}
+		else
+		{
+			FHexTileRange &Range{ PendingChange.DirtyRanges.AddDefaulted_GetRef() };
+			Range.First = TileIndex;
+			Range.Last = TileIndex;
+		}
+	}
+
+	if (PendingChange.DirtyTiles.Num() > 0 || PendingChange.bPortalsChanged)
+	{
+		PendingChange.GridVersion = ++GridVersion;
+
+		// Before the listeners, the pathfinding data they rebuild could read it
+		if (PendingChange.bBlockingChanged)
+		{
+			UpdateClearance(PendingChange.DirtyTiles);
+		}
+
+		// Move it out first, a listener could start a new batch.
+		const FHexGridChange Change{ MoveTemp(PendingChange) };
+		PendingChange = FHexGridChange{};
+		DirtyTileBits.Init(false, GetNumTiles());
+
+		OnTilesChangedNative.Broadcast(Change);
+		OnTilesChanged.Broadcast(Change);
+	}
+	else
+	{
+		PendingChange = FHexGridChange{};
+	}
+}
+//==== END OF Tile edits ====
+
+
+//==== Portals ====
+
+int32 AHexGrid::AddPortal(const FHCubeCoord &From, const FHCubeCoord &To, float Cost, bool bTwoWay)
+{
+	if (GetCoordIndex(From) == INDEX_NONE || GetCoordIndex(To) == INDEX_NONE || From == To)
+	{
+		UE_LOG(LogGraphAStarExample_HexGrid, Warning, TEXT("AHexGrid::AddPortal(...) invalid portal %s -> %s"), *From.QRS.ToString(), *To.QRS.ToString());
+		return INDEX_NONE;
+	}
+
+	// The pathfinder tells a portal from a step by the distance of the tiles, between neighbours the cost would be lost
+	if (FHPackedCoord::Distance(FHPackedCoord(From), FHPackedCoord(To)) == 1)
+	{
+		UE_LOG(LogGraphAStarExample_HexGrid, Warning, TEXT("AHexGrid::AddPortal(...) %s -> %s are neighbours, change the tile cost instead"), *From.QRS.ToString(), *To.QRS.ToString());
+		return INDEX_NONE;
+	}
+
+	BeginTileEdit();
+
+	FHexPortal &Portal{ Portals.AddDefaulted_GetRef() };
+	Portal.PortalId = NextPortalId++;
+	Portal.From = From;
+	Portal.To = To;
+	Portal.Cost = FMath::Max(Cost, 0.f);
+	MarkPortalDirty(Portal);
+
+	if (bTwoWay)
+	{
+		// A copy first, Portal is an element of the array we are adding to
+		FHexPortal Back{ Portal };
+		Swap(Back.From, Back.To);
+		Portals.Add(MoveTemp(Back));
+	}
+
+	RebuildPortalIndex();
+	PendingChange.bPortalsChanged = true;
+	CommitTileEdit();
+
+	return NextPortalId - 1;
+}
+
+void AHexGrid::RemovePortal(int32 PortalId)
+{
+	BeginTileEdit();
+
+	for (int32 PortalIndex{ Portals.Num() - 1 }; PortalIndex >= 0; --PortalIndex)
+	{
+		if (Portals[PortalIndex].PortalId == PortalId)
+		{
+			MarkPortalDirty(Portals[PortalIndex]);
+			Portals.RemoveAt(PortalIndex);
+			PendingChange.bPortalsChanged = true;
+		}
+	}
+
+	if (PendingChange.bPortalsChanged)
+	{
+		RebuildPortalIndex();
+	}
+
+	CommitTileEdit();
+}
+
+void AHexGrid::MarkPortalDirty(const FHexPortal &Portal)
+{
+	for (const FHCubeCoord &Coord : { Portal.From, Portal.To })
+	{
+		const int32 TileIndex{ GetCoordIndex(Coord) };
+		if (HasTileData(TileIndex))
+		{
+			MarkTileDirty(TileIndex);
+		}
+	}
+}
+
+void AHexGrid::RebuildPortalIndex()
+{
+	PortalOffsets.Reset();
+	PortalEdges.Reset();
+	PortalEntrances.Reset();
+	PortalExits.Reset();
+	MinPortalCost = 0.f;
+
+	// Resolve the coordinates once, the pathfinder only sees indices
+	TArray<TPair<int32, FHexPortalEdge>> Resolved;
+	MinPortalCost = TNumericLimits<float>::Max();
+	for (const FHexPortal &Portal : Portals)
+	{
+		const int32 FromIndex{ GetCoordIndex(Portal.From) };
+		const int32 ToIndex{ GetCoordIndex(Portal.To) };
+		if (FromIndex != INDEX_NONE && ToIndex != INDEX_NONE)
+		{
+			Resolved.Emplace(FromIndex, FHexPortalEdge{ ToIndex, Portal.Cost });
+			PortalEntrances.AddUnique(FHPackedCoord(Portal.From));
+			PortalExits.AddUnique(FHPackedCoord(Portal.To));
+			MinPortalCost = FMath::Min(MinPortalCost, Portal.Cost);
+		}
+	}
+
+	if (Resolved.Num() == 0)
+	{
+		MinPortalCost = 0.f;
+		return;
+	}
+
+	// Counting sort by From tile
+	PortalOffsets.Init(0, GetNumTiles() + 1);
+	for (const TPair<int32, FHexPortalEdge> &Entry : Resolved)
+	{
+		++PortalOffsets[Entry.Key + 1];
+	}
+	for (int32 TileIndex{ 0 }; TileIndex < GetNumTiles(); ++TileIndex)
+	{
+		PortalOffsets[TileIndex + 1] += PortalOffsets[TileIndex];
+	}
+
+	TArray<int32> Cursors{ PortalOffsets };
+	PortalEdges.SetNum(Resolved.Num());
+	for (const TPair<int32, FHexPortalEdge> &Entry : Resolved)
+	{
+		PortalEdges[Cursors[Entry.Key]++] = Entry.Value;
+	}
+}
+
+float AHexGrid::FindPortalCost(const int32 From, const int32 To) const
+{
+	for (int32 PortalIndex{ 0 }; PortalIndex < GetPortalCount(From); ++PortalIndex)
+	{
+		const FHexPortalEdge &Edge{ GetPortalEdge(From, PortalIndex) };
+		if (Edge.Target == To)
+		{
+			return Edge.Cost;
+		}
+	}
+	return -1.f;
+}
+
+int32 AHexGrid::GetDistanceToPortalEntrance(const FHPackedCoord &From) const
+{
+	int32 Distance{ MAX_int32 };
+	for (const FHPackedCoord &Entrance : PortalEntrances)
+	{
+		Distance = FMath::Min(Distance, FHPackedCoord::Distance(From, Entrance));
+	}
+	return Distance;
+}
+
+int32 AHexGrid::GetDistanceFromPortalExit(const FHPackedCoord &Goal) const
+{
+	int32 Distance{ MAX_int32 };
+	for (const FHPackedCoord &Exit : PortalExits)
+	{
+		Distance = FMath::Min(Distance, FHPackedCoord::Distance(Exit, Goal));
+	}
+	return Distance;
+}
+//==== END OF Portals ====
+
+
+//==== Shared data ====
+
+void AHexGrid::AcquireSharedData(TArray<FHPackedCoord> &&Coordinates)
+{
+	// Same key, same map: nothing to build or compare
+	FHexGridSharedDataPtr Registered{ FHexGridSharedData::FindByKey(SharedDataKey, Radius, Coordinates) };
+	if (Registered.IsValid())
+	{
+		UE_LOG(LogGraphAStarExample_HexGrid, Verbose, TEXT("AHexGrid::AcquireSharedData() %s reuses the data of key %s"), *GetName(), *SharedDataKey.ToString());
+
+#if !UE_BUILD_SHIPPING
+		// The key promises the same tiles too, the ones we were given are here to check it
+		bool bSameTiles{ GridTiles.Num() == 0 || GridTiles.Num() == Registered->BaseCosts.Num() };
+		for (int32 TileIndex{ 0 }; TileIndex < Registered->BaseCosts.Num() && bSameTiles && GridTiles.Num() > 0; ++TileIndex)
+		{
+			const FHexTile &Tile{ GridTiles[TileIndex] };
+			bSameTiles = Tile.Cost == Registered->BaseCosts[TileIndex] && Tile.bIsBlocking == Registered->BaseBlocking[TileIndex]
+				&& Tile.TileClass == Registered->BaseClasses[TileIndex];
+		}
+		if (!ensureMsgf(bSameTiles, TEXT("AHexGrid::AcquireSharedData() %s has other tiles than the grids of key %s"), *GetName(), *SharedDataKey.ToString()))
+		{
+			BuildSharedData(MoveTemp(Coordinates));
+			return;
+		}
+#endif
+
+		GridTiles.Empty();
+		UseSharedData(MoveTemp(Registered));
+	}
+	else
+	{
+		BuildSharedData(MoveTemp(Coordinates));
+	}
+}
+
+void AHexGrid::BuildSharedData(TArray<FHPackedCoord> &&Coordinates)
+{
+	// The tiles are parallel to the coordinates, the ones past the last coordinate have no place in the grid
+	const int32 NumTileData{ FMath::Min(GridTiles.Num(), Coordinates.Num()) };
+	TArray<float> Costs;
+	TArray<uint8> Classes;
+	TBitArray<> Blocking(false, Coordinates.Num());
+	Costs.Reserve(NumTileData);
+	Classes.Reserve(NumTileData);
+	for (int32 TileIndex{ 0 }; TileIndex < NumTileData; ++TileIndex)
+	{
+		const FHexTile &Tile{ GridTiles[TileIndex] };
+		Costs.Add(Tile.Cost);
+		Blocking[TileIndex] = Tile.bIsBlocking;
+		Classes.Add(Tile.TileClass);
+	}
+	GridTiles.Empty();
+
+	const TSharedRef<FHexGridSharedData, ESPMode::ThreadSafe> Candidate{ MakeShared<FHexGridSharedData, ESPMode::ThreadSafe>() };
+	Candidate->Init(Radius, MoveTemp(Coordinates), MoveTemp(Costs), MoveTemp(Blocking), MoveTemp(Classes));
+	Candidate->Key = SharedDataKey;
+
+	FHexGridSharedDataPtr Registered{ FHexGridSharedData::Find(*Candidate) };
+	if (Registered.IsValid())
+	{
+		UE_LOG(LogGraphAStarExample_HexGrid, Verbose, TEXT("AHexGrid::AcquireSharedData() %s reuses the data of another grid"), *GetName());
+	}
+	else
+	{
+		// First grid of the process with this map, the clearance flood needs the lookups and the tiles of the candidate
+		SetSharedViews(*Candidate);
+		TileOverlay.Empty();
+		RebuildClearance();
+		Candidate->BaseClearance = MoveTemp(LocalClearance);
+		Registered = FHexGridSharedData::Register(Candidate);
+	}
+	UseSharedData(MoveTemp(Registered));
+}
+
+void AHexGrid::SetSharedViews(const FHexGridSharedData &Data)
+{
+	PackedCoordinates = Data.PackedCoordinates;
+	ColumnOffsets = Data.ColumnOffsets;
+	TileBaseCosts = Data.BaseCosts;
+	TileBaseClasses = Data.BaseClasses;
+	TileBaseBlocking = &Data.BaseBlocking;
+}
+
+void AHexGrid::UseSharedData(FHexGridSharedDataPtr &&Data)
+{
+	SharedData = MoveTemp(Data);
+	SetSharedViews(*SharedData);
+	TileClearance = SharedData->BaseClearance;
+	LocalClearance.Empty();
+	ClearanceOverlay.Empty();
+	TileOverlay.Empty();
+}
+
+void AHexGrid::ReleaseSharedData()
+{
+	PackedCoordinates = TArrayView<const FHPackedCoord>();
+	ColumnOffsets = TArrayView<const int32>();
+	TileBaseCosts = TArrayView<const float>();
+	TileBaseClasses = TArrayView<const uint8>();
+	TileBaseBlocking = nullptr;
+	TileClearance = TArrayView<const uint8>();
+	LocalClearance.Empty();
+	ClearanceOverlay.Empty();
+	TileOverlay.Empty();
+	SharedData.Reset();
+}
+//==== END OF Shared data ====
+
+
+//==== Clearance ====
+
+bool AHexGrid::IsGridBorder(const int32 TileIndex) const
+{
+	const FHPackedCoord Coord{ GetPackedCoord(TileIndex) };
+	for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+	{
+		if (GetPackedIndex(Coord + FHPackedCoord::Direction(Dir)) == INDEX_NONE)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 AHexGrid::GetClearanceSeed(const int32 TileIndex) const
+{
+	if (IsClearanceObstacle(TileIndex))
+	{
+		return 0;
+	}
+	return IsGridBorder(TileIndex) ? 1 : MaxTileClearance;
+}
+
+void AHexGrid::RebuildClearance()
+{
+	const int32 NumTiles{ GetNumTiles() };
+	LocalClearance.Init(uint8(MaxTileClearance), NumTiles);
+	TileClearance = LocalClearance;
+	ClearanceOverlay.Empty();
+
+	// Multi-source flood from every obstacle and every border tile at once
+	TArray<TArray<int32>> Buckets;
+	Buckets.SetNum(MaxTileClearance + 1);
+	for (int32 TileIndex{ 0 }; TileIndex < NumTiles; ++TileIndex)
+	{
+		const int32 Seed{ GetClearanceSeed(TileIndex) };
+		if (Seed < MaxTileClearance)
+		{
+			LocalClearance[TileIndex] = uint8(Seed);
+			Buckets[Seed].Add(TileIndex);
+		}
+	}
+	PropagateClearance(Buckets);
+}
+
+void AHexGrid::UpdateClearance(const TArray<int32> &DirtyTiles)
+{
+	if (TileClearance.Num() != GetNumTiles())
+	{
+		RebuildClearance();
+		return;
+	}
+
+	TArray<TArray<int32>> Buckets;
+	Buckets.SetNum(MaxTileClearance + 1);
+
+	// A tile that stopped blocking can raise the clearance of every tile that had it as the closest obstacle,
+	// they are all within MaxTileClearance steps: we reset that area and flood it again from its obstacles and its outer border
+	TArray<int32> Area;
+	TBitArray<> InArea(false, GetNumTiles());
+	for (const int32 TileIndex : DirtyTiles)
+	{
+		if (TileClearance.IsValidIndex(TileIndex) && GetTileClearance(TileIndex) == 0 && !IsClearanceObstacle(TileIndex))
+		{
+			InArea[TileIndex] = true;
+			Area.Add(TileIndex);
+		}
+	}
+
+	if (Area.Num() > 0)
+	{
+		// Breadth first, one ring for each pass
+		int32 RingStart{ 0 };
+		for (int32 Distance{ 1 }; Distance <= MaxTileClearance; ++Distance)
+		{
+			const int32 RingEnd{ Area.Num() };
+			for (int32 Index{ RingStart }; Index < RingEnd; ++Index)
+			{
+				const FHPackedCoord Coord{ GetPackedCoord(Area[Index]) };
+				for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+				{
+					const int32 Neighbour{ GetPackedIndex(Coord + FHPackedCoord::Direction(Dir)) };
+					if (Neighbour != INDEX_NONE && !InArea[Neighbour])
+					{
+						InArea[Neighbour] = true;
+						Area.Add(Neighbour);
+					}
+				}
+			}
+			RingStart = RingEnd;
+		}
+
+		for (const int32 TileIndex : Area)
+		{
+			const int32 Seed{ GetClearanceSeed(TileIndex) };
+			SetTileClearance(TileIndex, Seed);
+			if (Seed < MaxTileClearance)
+			{
+				Buckets[Seed].Add(TileIndex);
+			}
+
+			// Tiles right outside of the area keep their clearance, they can't depend on the tiles that stopped blocking
+			const FHPackedCoord Coord{ GetPackedCoord(TileIndex) };
+			for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+			{
+				const int32 Neighbour{ GetPackedIndex(Coord + FHPackedCoord::Direction(Dir)) };
+				if (Neighbour == INDEX_NONE || InArea[Neighbour])
+				{
+					continue;
+				}
+
+				const int32 NeighbourClearance{ GetTileClearance(Neighbour) };
+				if (NeighbourClearance < MaxTileClearance)
+				{
+					Buckets[NeighbourClearance].Add(Neighbour);
+				}
+			}
+		}
+	}
+
+	// New obstacles can only lower the clearance, a flood from them is enough
+	for (const int32 TileIndex : DirtyTiles)
+	{
+		if (TileClearance.IsValidIndex(TileIndex) && GetTileClearance(TileIndex) != 0 && IsClearanceObstacle(TileIndex))
+		{
+			SetTileClearance(TileIndex, 0);
+			Buckets[0].Add(TileIndex);
+		}
+	}
+
+	PropagateClearance(Buckets);
+}
+
+void AHexGrid::PropagateClearance(TArray<TArray<int32>> &Buckets)
+{
+	for (int32 Clearance{ 0 }; Clearance < MaxTileClearance; ++Clearance)
+	{
+		// Buckets[Clearance + 1] grows while we read this one, but never this one
+		for (int32 Index{ 0 }; Index < Buckets[Clearance].Num(); ++Index)
+		{
+			const int32 TileIndex{ Buckets[Clearance][Index] };
+			if (GetTileClearance(TileIndex) != Clearance)
+			{
+				continue;
+			}
+
+			const FHPackedCoord Coord{ GetPackedCoord(TileIndex) };
+			for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+			{
+				const int32 Neighbour{ GetPackedIndex(Coord + FHPackedCoord::Direction(Dir)) };
+				if (Neighbour != INDEX_NONE && GetTileClearance(Neighbour) > Clearance + 1)
+				{
+					SetTileClearance(Neighbour, Clearance + 1);
+					Buckets[Clearance + 1].Add(Neighbour);
+				}
+			}
+		}
+	}
+}
+void AHexGrid::SetTileClearance(const int32 TileIndex, const int32 Clearance)
+{
+	if (TileClearance.GetData() == LocalClearance.GetData())
+	{
+		LocalClearance[TileIndex] = uint8(Clearance);
+		return;
+	}
+
+	// The shared clearance stays the one of the blocking flags at build time, we keep only the differences
+	if (TileClearance[TileIndex] == Clearance)
+	{
+		ClearanceOverlay.Remove(TileIndex);
+	}
+	else
+	{
+		ClearanceOverlay.Add(TileIndex, uint8(Clearance));
+	}
+}
+//==== END OF Clearance ====
+
+
+//==== Cost layers ====
+
+int32 AHexGrid::AddCostLayer(FName LayerName)
+{
+	const int32 Existing{ FindCostLayer(LayerName) };
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	FCostLayer &Layer{ CostLayers.AddDefaulted_GetRef() };
+	Layer.Name = LayerName;
+	Layer.Values.SetNumZeroed(GetNumTiles());
+	MarkCostLayersChanged();
+	return CostLayers.Num() - 1;
+}
+
+void AHexGrid::RemoveCostLayer(FName LayerName)
+{
+	const int32 LayerIndex{ FindCostLayer(LayerName) };
+	if (LayerIndex != INDEX_NONE)
+	{
+		CostLayers.RemoveAt(LayerIndex);
+		MarkCostLayersChanged();
+	}
+}
+
+int32 AHexGrid::FindCostLayer(FName LayerName) const
+{
+	return CostLayers.IndexOfByPredicate([LayerName](const FCostLayer &Layer) { return Layer.Name == LayerName; });
+}
+
+void AHexGrid::ClearCostLayer(FName LayerName)
+{
+	const int32 LayerIndex{ FindCostLayer(LayerName) };
+	if (LayerIndex != INDEX_NONE)
+	{
+		FMemory::Memzero(CostLayers[LayerIndex].Values.GetData(), CostLayers[LayerIndex].Values.Num() * sizeof(float));
+		MarkCostLayersChanged();
+	}
+}
+
+void AHexGrid::DecayCostLayer(FName LayerName, float Factor)
+{
+	const int32 LayerIndex{ FindCostLayer(LayerName) };
+	if (LayerIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	float *Values{ CostLayers[LayerIndex].Values.GetData() };
+	const int32 NumValues{ CostLayers[LayerIndex].Values.Num() };
+
+	// 4 tiles at a time, the scalar loop does the last ones
+	const VectorRegister VectorFactor{ VectorSetFloat1(Factor) };
+	int32 Index{ 0 };
+	for (; Index + 4 <= NumValues; Index += 4)
+	{
+		VectorStore(VectorMultiply(VectorLoad(Values + Index), VectorFactor), Values + Index);
+	}
+	for (; Index < NumValues; ++Index)
+	{
+		Values[Index] *= Factor;
+	}
+	MarkCostLayersChanged();
+}
+
+void AHexGrid::SplatCostLayer(FName LayerName, const FHCubeCoord &Center, int32 SplatRadius, float Amount)
+{
+	const int32 LayerIndex{ FindCostLayer(LayerName) };
+	if (LayerIndex == INDEX_NONE || SplatRadius < 0 || !FHPackedCoord::CanPack(Center))
+	{
+		return;
+	}
+
+	TArray<float> &Values{ CostLayers[LayerIndex].Values };
+	const FHPackedCoord PackedCenter{ Center };
+	for (int32 DQ{ -SplatRadius }; DQ <= SplatRadius; ++DQ)
+	{
+		const int32 DR1{ FMath::Max(-SplatRadius, -DQ - SplatRadius) };
+		const int32 DR2{ FMath::Min(SplatRadius, -DQ + SplatRadius) };
+		for (int32 DR{ DR1 }; DR <= DR2; ++DR)
+		{
+			// A huge radius around a tile near the limits, these can't be tiles of the grid
+			if (!FHPackedCoord::CanPack(PackedCenter.Q + DQ, PackedCenter.R + DR))
+			{
+				continue;
+			}
+
+			const FHPackedCoord Coord(PackedCenter.Q + DQ, PackedCenter.R + DR);
+			const int32 TileIndex{ GetPackedIndex(Coord) };
+			if (Values.IsValidIndex(TileIndex))
+			{
+				const int32 Distance{ FHPackedCoord::Distance(PackedCenter, Coord) };
+				Values[TileIndex] += Amount * (1.f - float(Distance) / float(SplatRadius + 1));
+			}
+		}
+	}
+	MarkCostLayersChanged();
+}
+
+void AHexGrid::DiffuseCostLayer(FName LayerName, float Rate)
+{
+	const int32 LayerIndex{ FindCostLayer(LayerName) };
+	if (LayerIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Read the old values, write the new ones, so the order of the tiles doesn't matter
+	TArray<float> &Values{ CostLayers[LayerIndex].Values };
+	DiffuseScratch = Values;
+
+	Rate = FMath::Clamp(Rate, 0.f, 1.f);
+	for (int32 TileIndex{ 0 }; TileIndex < Values.Num(); ++TileIndex)
+	{
+		const FHPackedCoord Coord{ GetPackedCoord(TileIndex) };
+		float Sum{ 0.f };
+		int32 NumNeighbours{ 0 };
+		for (int32 Dir{ 0 }; Dir < 6; ++Dir)
+		{
+			const int32 Neighbour{ GetPackedIndex(Coord + FHPackedCoord::Direction(Dir)) };
+			if (Neighbour != INDEX_NONE)
+			{
+				Sum += DiffuseScratch[Neighbour];
+				++NumNeighbours;
+			}
+		}
+
+		if (NumNeighbours > 0)
+		{
+			Values[TileIndex] = FMath::Lerp(DiffuseScratch[TileIndex], Sum / NumNeighbours, Rate);
+		}
+	}
+	MarkCostLayersChanged();
+}
+
+TArrayView<const float> AHexGrid::GetCostLayerValues(const int32 LayerIndex) const
+{
+	return CostLayers.IsValidIndex(LayerIndex) ? TArrayView<const float>(CostLayers[LayerIndex].Values) : TArrayView<const float>();
+}
+
+TArrayView<float> AHexGrid::GetMutableCostLayerValues(const int32 LayerIndex)
+{
+	return CostLayers.IsValidIndex(LayerIndex) ? TArrayView<float>(CostLayers[LayerIndex].Values) : TArrayView<float>();
+}
+
+void AHexGrid::BlendCostLayers(const TArray<FHexCostLayerWeight> &Weights, TArrayView<const float> BaseCosts, TArray<float> &OutCosts) const
+{
+	const int32 NumValues{ BaseCosts.Num() };
+	OutCosts.SetNumZeroed(NumValues);
+	float *Out{ OutCosts.GetData() };
+
+	// First the weighted sum of the layers, one contiguous pass for each layer
+	for (const FHexCostLayerWeight &Weight : Weights)
+	{
+		const int32 LayerIndex{ FindCostLayer(Weight.Layer) };
+		if (LayerIndex == INDEX_NONE || Weight.Weight == 0.f)
+		{
+			continue;
+		}
+
+		const float *Values{ CostLayers[LayerIndex].Values.GetData() };
+		const int32 NumLayerValues{ FMath::Min(NumValues, CostLayers[LayerIndex].Values.Num()) };
+		const VectorRegister VectorWeight{ VectorSetFloat1(Weight.Weight) };
+		int32 Index{ 0 };
+		for (; Index + 4 <= NumLayerValues; Index += 4)
+		{
+			VectorStore(VectorMultiplyAdd(VectorLoad(Values + Index), VectorWeight, VectorLoad(Out + Index)), Out + Index);
+		}
+		for (; Index < NumLayerValues; ++Index)
+		{
+			Out[Index] += Values[Index] * Weight.Weight;
+		}
+	}
+
+	// Then the base cost plus the clamped sum, blocked tiles keep their marker
+	const float *Base{ BaseCosts.GetData() };
+	const VectorRegister Zero{ VectorZero() };
+	int32 Index{ 0 };
+	for (; Index + 4 <= NumValues; Index += 4)
+	{
+		const VectorRegister BaseCost{ VectorLoad(Base + Index) };
+		const VectorRegister Blended{ VectorAdd(BaseCost, VectorMax(VectorLoad(Out + Index), Zero)) };
+		VectorStore(VectorSelect(VectorCompareLT(BaseCost, Zero), BaseCost, Blended), Out + Index);
+	}
+	for (; Index < NumValues; ++Index)
+	{
+		Out[Index] = Base[Index] < 0.f ? Base[Index] : Base[Index] + FMath::Max(Out[Index], 0.f);
+	}
+}
+
+void AHexGrid::ResetCostLayers()
+{
+	for (FCostLayer &Layer : CostLayers)
+	{
+		Layer.Values.Reset();
+		Layer.Values.SetNumZeroed(GetNumTiles());
+	}
+	MarkCostLayersChanged();
+}
+//==== END OF Cost layers ====
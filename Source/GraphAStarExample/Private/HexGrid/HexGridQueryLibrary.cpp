@@ -0,0 +1,259 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexGridQueryLibrary.h"
+#include "HexGrid.h"
+
+namespace HexGridQueries
+{
+	// Same order of FHDirections, we don't want to build one of it for each query
+	static const FIntVector Directions[6]{
+		FIntVector(0, 1, -1), FIntVector(1, 0, -1), FIntVector(1, -1, 0),
+		FIntVector(0, -1, 1), FIntVector(-1, 0, 1), FIntVector(-1, 1, 0)
+	};
+
+	// Same of AHexGrid::HexRound, but usable on a const grid
+	static FIntVector Round(const FVector &F)
+	{
+		int32 q{ int32(FMath::RoundToDouble(F.X)) };
+		int32 r{ int32(FMath::RoundToDouble(F.Y)) };
+		int32 s{ int32(FMath::RoundToDouble(F.Z)) };
+
+		const float q_diff{ FMath::Abs(q - F.X) };
+		const float r_diff{ FMath::Abs(r - F.Y) };
+		const float s_diff{ FMath::Abs(s - F.Z) };
+
+		if ((q_diff > r_diff) && (q_diff > s_diff))
+		{
+			q = -r - s;
+		}
+		else if (r_diff > s_diff)
+		{
+			r = -q - s;
+		}
+		else
+		{
+			s = -q - r;
+		}
+		return FIntVector(q, r, s);
+	}
+
+	// Add the index of a coordinate if it's part of the grid and there is room
+	static FORCEINLINE void Add(const AHexGrid &Grid, const FIntVector &QRS, TArrayView<int32> OutIndices, int32 &NumWritten)
+	{
+		const int32 Index{ Grid.GetCoordIndex(FHCubeCoord(QRS)) };
+		if (Index != INDEX_NONE && NumWritten < OutIndices.Num())
+		{
+			OutIndices[NumWritten++] = Index;
+		}
+	}
+}
+
+
+int32 UHexGridQueryLibrary::HexDistance(const FHCubeCoord &A, const FHCubeCoord &B)
+{
+	const FIntVector Delta{ A.QRS - B.QRS };
+	return (FMath::Abs(Delta.X) + FMath::Abs(Delta.Y) + FMath::Abs(Delta.Z)) / 2;
+}
+
+int32 UHexGridQueryLibrary::Ring(const AHexGrid &Grid, const FHCubeCoord &Center, const int32 Radius, TArrayView<int32> OutIndices)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HexGridShapeQuery);
+
+	int32 NumWritten{ 0 };
+	if (Radius <= 0)
+	{
+		HexGridQueries::Add(Grid, Center.QRS, OutIndices, NumWritten);
+		return NumWritten;
+	}
+
+	// Start from the corner in direction 5 and walk the six sides
+	FIntVector Current{ Center.QRS + HexGridQueries::Directions[5] * Radius };
+	for (int32 Side{ 0 }; Side < 6; ++Side)
+	{
+		const FIntVector &Dir{ HexGridQueries::Directions[(Side + 1) % 6] };
+		for (int32 Step{ 0 }; Step < Radius; ++Step)
+		{
+			HexGridQueries::Add(Grid, Current, OutIndices, NumWritten);
+			Current += Dir;
+		}
+	}
+	return NumWritten;
+}
+
+int32 UHexGridQueryLibrary::Spiral(const AHexGrid &Grid, const FHCubeCoord &Center, const int32 Radius, TArrayView<int32> OutIndices)
+{
+	int32 NumWritten{ 0 };
+	for (int32 RingRadius{ 0 }; RingRadius <= Radius && NumWritten < OutIndices.Num(); ++RingRadius)
+	{
+		NumWritten += Ring(Grid, Center, RingRadius, OutIndices.Slice(NumWritten, OutIndices.Num() - NumWritten));
+	}
+	return NumWritten;
+}
+
+int32 UHexGridQueryLibrary::WriteColumn(const AHexGrid &Grid, const int32 Q, int32 RMin, int32 RMax, TArrayView<int32> OutIndices, int32 NumWritten)
+{
+	if (Grid.HasColumnLayout())
+	{
+		// Clip to the column of the grid (same bounds of CreateGrid), then the indices are consecutive.
+		if (FMath::Abs(Q) > Grid.Radius)
+		{
+			return NumWritten;
+		}
+		RMin = FMath::Max(RMin, FMath::Max(-Grid.Radius, -Q - Grid.Radius));
+		RMax = FMath::Min(RMax, FMath::Min(Grid.Radius, -Q + Grid.Radius));
+		if (RMin > RMax)
+		{
+			return NumWritten;
+		}
+
+		const int32 First{ Grid.GetCoordIndex(FHCubeCoord(FIntVector(Q, RMin, -Q - RMin))) };
+		if (First != INDEX_NONE)
+		{
+			// Plain loop on contiguous memory, the compiler vectorizes it.
+			const int32 Count{ FMath::Min(RMax - RMin + 1, OutIndices.Num() - NumWritten) };
+			int32 *Out{ OutIndices.GetData() + NumWritten };
+			for (int32 Offset{ 0 }; Offset < Count; ++Offset)
+			{
+				Out[Offset] = First + Offset;
+			}
+			return NumWritten + Count;
+		}
+	}
+
+	// Grid filled by hand, one lookup for each tile
+	for (int32 R{ RMin }; R <= RMax; ++R)
+	{
+		HexGridQueries::Add(Grid, FIntVector(Q, R, -Q - R), OutIndices, NumWritten);
+	}
+	return NumWritten;
+}
+
+int32 UHexGridQueryLibrary::Range(const AHexGrid &Grid, const FHCubeCoord &Center, const int32 Radius, TArrayView<int32> OutIndices)
+{
+	return RangeIntersection(Grid, Center, Radius, Center, Radius, OutIndices);
+}
+
+int32 UHexGridQueryLibrary::RangeIntersection(const AHexGrid &Grid, const FHCubeCoord &CenterA, const int32 RadiusA,
+	const FHCubeCoord &CenterB, const int32 RadiusB, TArrayView<int32> OutIndices)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HexGridShapeQuery);
+
+	const FIntVector &A{ CenterA.QRS };
+	const FIntVector &B{ CenterB.QRS };
+
+	const int32 QMin{ FMath::Max(A.X - RadiusA, B.X - RadiusB) };
+	const int32 QMax{ FMath::Min(A.X + RadiusA, B.X + RadiusB) };
+	const int32 RMin{ FMath::Max(A.Y - RadiusA, B.Y - RadiusB) };
+	const int32 RMax{ FMath::Min(A.Y + RadiusA, B.Y + RadiusB) };
+	const int32 SMin{ FMath::Max(A.Z - RadiusA, B.Z - RadiusB) };
+	const int32 SMax{ FMath::Min(A.Z + RadiusA, B.Z + RadiusB) };
+
+	int32 NumWritten{ 0 };
+	for (int32 Q{ QMin }; Q <= QMax && NumWritten < OutIndices.Num(); ++Q)
+	{
+		NumWritten = WriteColumn(Grid, Q, FMath::Max(RMin, -Q - SMax), FMath::Min(RMax, -Q - SMin), OutIndices, NumWritten);
+	}
+	return NumWritten;
+}
+
+int32 UHexGridQueryLibrary::Line(const AHexGrid &Grid, const FHCubeCoord &A, const FHCubeCoord &B, TArrayView<int32> OutIndices)
+{
+	SCOPE_CYCLE_COUNTER(STAT_HexGridShapeQuery);
+
+	const int32 Distance{ HexDistance(A, B) };
+
+	// Nudge the endpoints so the line never lies exactly on a tile edge
+	const FVector Epsilon{ 1e-6f, 2e-6f, -3e-6f };
+	const FVector Start{ FVector(A.QRS) + Epsilon };
+	const FVector End{ FVector(B.QRS) + Epsilon };
+
+	int32 NumWritten{ 0 };
+	for (int32 Step{ 0 }; Step <= Distance; ++Step)
+	{
+		const float Alpha{ Distance > 0 ? float(Step) / Distance : 0.f };
+		HexGridQueries::Add(Grid, HexGridQueries::Round(FMath::Lerp(Start, End, Alpha)), OutIndices, NumWritten);
+	}
+	return NumWritten;
+}
+
+
+//==== Blueprint versions ====
+
+TArray<int32> UHexGridQueryLibrary::GetRing(const AHexGrid *Grid, const FHCubeCoord &Center, int32 Radius)
+{
+	TArray<int32> Result;
+	if (Grid)
+	{
+		Result.SetNumUninitialized(GetRingCapacity(Radius));
+		Result.SetNum(Ring(*Grid, Center, Radius, Result), false);
+	}
+	return Result;
+}
+
+TArray<int32> UHexGridQueryLibrary::GetSpiral(const AHexGrid *Grid, const FHCubeCoord &Center, int32 Radius)
+{
+	TArray<int32> Result;
+	if (Grid)
+	{
+		Result.SetNumUninitialized(GetRangeCapacity(Radius));
+		Result.SetNum(Spiral(*Grid, Center, Radius, Result), false);
+	}
+	return Result;
+}
+
+TArray<int32> UHexGridQueryLibrary::GetRange(const AHexGrid *Grid, const FHCubeCoord &Center, int32 Radius)
+{
+	TArray<int32> Result;
+	if (Grid)
+	{
+		Result.SetNumUninitialized(GetRangeCapacity(Radius));
+		Result.SetNum(Range(*Grid, Center, Radius, Result), false);
+	}
+	return Result;
+}
+
+TArray<int32> UHexGridQueryLibrary::GetRangeIntersection(const AHexGrid *Grid, const FHCubeCoord &CenterA, int32 RadiusA, const FHCubeCoord &CenterB, int32 RadiusB)
+{
+	TArray<int32> Result;
+	if (Grid)
+	{
+		Result.SetNumUninitialized(GetRangeCapacity(FMath::Min(RadiusA, RadiusB)));
+		Result.SetNum(RangeIntersection(*Grid, CenterA, RadiusA, CenterB, RadiusB, Result), false);
+	}
+	return Result;
+}
+
+TArray<int32> UHexGridQueryLibrary::GetLine(const AHexGrid *Grid, const FHCubeCoord &A, const FHCubeCoord &B)
+{
+	TArray<int32> Result;
+	if (Grid)
+	{
+		Result.SetNumUninitialized(GetLineCapacity(A, B));
+		Result.SetNum(Line(*Grid, A, B, Result), false);
+	}
+	return Result;
+}
+
+void UHexGridQueryLibrary::GetRangesBatch(const AHexGrid *Grid, const TArray<FHCubeCoord> &Centers, int32 Radius, TArray<int32> &OutIndices, TArray<int32> &OutOffsets)
+{
+	OutIndices.Reset();
+	OutOffsets.Reset(Centers.Num() + 1);
+	OutOffsets.Add(0);
+
+	if (!Grid)
+	{
+		return;
+	}
+
+	// A single allocation for all the ranges
+	OutIndices.SetNumUninitialized(Centers.Num() * GetRangeCapacity(Radius));
+
+	int32 NumWritten{ 0 };
+	for (const FHCubeCoord &Center : Centers)
+	{
+		NumWritten += Range(*Grid, Center, Radius, TArrayView<int32>(OutIndices).Slice(NumWritten, OutIndices.Num() - NumWritten));
+		OutOffsets.Add(NumWritten);
+	}
+	OutIndices.SetNum(NumWritten, false);
+}
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexGridSharedData.h"
+#include "Misc/ScopeLock.h"
+
+
+namespace HexGridSharedData
+{
+	struct FRegistry
+	{
+		FCriticalSection Lock;
+
+		/* Weak, an entry dies with its last grid. A fingerprint collision gives two entries with the same key */
+		TMultiMap<uint32, TWeakPtr<const FHexGridSharedData, ESPMode::ThreadSafe>> Entries;
+
+		/* Same entries, only the ones built by a grid with a SharedDataKey */
+		TMap<FName, TWeakPtr<const FHexGridSharedData, ESPMode::ThreadSafe>> KeyedEntries;
+	};
+
+	/* Function static, the grids of the first world can be created before the statics of this file */
+	FRegistry &GetRegistry()
+	{
+		static FRegistry Registry;
+		return Registry;
+	}
+
+	/* Call it with the lock taken, the live entry of the key whatever its layout */
+	FHexGridSharedDataPtr FindByKeyLocked(FRegistry &Registry, FName Key)
+	{
+		const TWeakPtr<const FHexGridSharedData, ESPMode::ThreadSafe> *Entry{ Registry.KeyedEntries.Find(Key) };
+		return Entry ? Entry->Pin() : nullptr;
+	}
+
+	bool HasLayout(const FHexGridSharedData &Data, const int32 Radius, const int32 NumTiles, const uint32 LayoutFingerprint)
+	{
+		return Data.Radius == Radius && Data.PackedCoordinates.Num() == NumTiles && Data.LayoutFingerprint == LayoutFingerprint;
+	}
+
+	/* Call it with the lock taken */
+	FHexGridSharedDataPtr FindLocked(FRegistry &Registry, const FHexGridSharedData &Key)
+	{
+		for (auto It{ Registry.Entries.CreateConstKeyIterator(Key.Fingerprint) }; It; ++It)
+		{
+			FHexGridSharedDataPtr Data{ It.Value().Pin() };
+			if (Data.IsValid() && Data->HasSameLayout(Key))
+			{
+				return Data;
+			}
+		}
+		return nullptr;
+	}
+}
+
+
+void FHexGridSharedData::Init(const int32 InRadius, TArray<FHPackedCoord> &&Coordinates, TArray<float> &&Costs, TBitArray<> &&Blocking, TArray<uint8> &&Classes)
+{
+	check(Blocking.Num() == Coordinates.Num() && Classes.Num() == Costs.Num() && Costs.Num() <= Coordinates.Num());
+
+	Radius = InRadius;
+	PackedCoordinates = MoveTemp(Coordinates);
+	BaseCosts = MoveTemp(Costs);
+	BaseBlocking = MoveTemp(Blocking);
+	BaseClasses = MoveTemp(Classes);
+	BaseClearance.Reset();
+
+	// Same loops of AHexGrid::CreateGrid, any other order (a grid filled by hand) falls back to the searches
+	bool bColumnLayout{ true };
+	int32 Index{ 0 };
+	ColumnOffsets.Reset(2 * Radius + 1);
+	for (int32 Q{ -Radius }; Q <= Radius && bColumnLayout; ++Q)
+	{
+		ColumnOffsets.Add(Index);
+
+		const int32 R1{ FMath::Max(-Radius, -Q - Radius) };
+		const int32 R2{ FMath::Min(Radius, -Q + Radius) };
+		for (int32 R{ R1 }; R <= R2 && bColumnLayout; ++R, ++Index)
+		{
+			bColumnLayout = PackedCoordinates.IsValidIndex(Index) && PackedCoordinates[Index] == FHPackedCoord(Q, R);
+		}
+	}
+	if (!bColumnLayout || Index != PackedCoordinates.Num())
+	{
+		ColumnOffsets.Empty();
+	}
+
+	LayoutFingerprint = ComputeLayoutFingerprint(Radius, PackedCoordinates);
+	Fingerprint = FCrc::MemCrc32(BaseCosts.GetData(), BaseCosts.Num() * BaseCosts.GetTypeSize(), LayoutFingerprint);
+	Fingerprint = FCrc::MemCrc32(BaseClasses.GetData(), BaseClasses.Num() * BaseClasses.GetTypeSize(), Fingerprint);
+	for (TConstSetBitIterator<> It(BaseBlocking); It; ++It)
+	{
+		const int32 TileIndex{ It.GetIndex() };
+		Fingerprint = FCrc::MemCrc32(&TileIndex, sizeof(TileIndex), Fingerprint);
+	}
+}
+
+bool FHexGridSharedData::HasSameLayout(const FHexGridSharedData &Other) const
+{
+	// The CRC only narrows the search, the data decides
+	return Fingerprint == Other.Fingerprint && Radius == Other.Radius
+		&& PackedCoordinates == Other.PackedCoordinates && BaseBlocking == Other.BaseBlocking
+		&& BaseCosts == Other.BaseCosts && BaseClasses == Other.BaseClasses;
+}
+
+FHexGridSharedDataPtr FHexGridSharedData::Find(const FHexGridSharedData &Key)
+{
+	HexGridSharedData::FRegistry &Registry{ HexGridSharedData::GetRegistry() };
+	FScopeLock Lock(&Registry.Lock);
+	return HexGridSharedData::FindLocked(Registry, Key);
+}
+
+FHexGridSharedDataPtr FHexGridSharedData::FindByKey(FName InKey, const int32 InRadius, TArrayView<const FHPackedCoord> Coordinates)
+{
+	if (InKey.IsNone())
+	{
+		return nullptr;
+	}
+
+	FHexGridSharedDataPtr Data;
+	{
+		HexGridSharedData::FRegistry &Registry{ HexGridSharedData::GetRegistry() };
+		FScopeLock Lock(&Registry.Lock);
+		Data = HexGridSharedData::FindByKeyLocked(Registry, InKey);
+	}
+
+	// Another size is a grid being resized, the same size with other coordinates is a key given to two maps
+	if (!Data.IsValid() || Data->Radius != InRadius || Data->PackedCoordinates.Num() != Coordinates.Num())
+	{
+		return nullptr;
+	}
+	if (!ensureMsgf(HexGridSharedData::HasLayout(*Data, InRadius, Coordinates.Num(), ComputeLayoutFingerprint(InRadius, Coordinates)),
+		TEXT("FHexGridSharedData::FindByKey(...) key %s is used by grids with different coordinates"), *InKey.ToString()))
+	{
+		return nullptr;
+	}
+	return Data;
+}
+
+uint32 FHexGridSharedData::ComputeLayoutFingerprint(const int32 InRadius, TArrayView<const FHPackedCoord> Coordinates)
+{
+	const uint32 RadiusCrc{ FCrc::MemCrc32(&InRadius, sizeof(InRadius)) };
+	return FCrc::MemCrc32(Coordinates.GetData(), Coordinates.Num() * Coordinates.GetTypeSize(), RadiusCrc);
+}
+
+FHexGridSharedDataPtr FHexGridSharedData::Register(const TSharedRef<FHexGridSharedData, ESPMode::ThreadSafe> &Data)
+{
+	HexGridSharedData::FRegistry &Registry{ HexGridSharedData::GetRegistry() };
+	FScopeLock Lock(&Registry.Lock);
+
+	// Two worlds built the same grid at the same time, the first one wins and the other copy is dropped
+	FHexGridSharedDataPtr Existing{ HexGridSharedData::FindLocked(Registry, *Data) };
+	if (Existing.IsValid())
+	{
+		return Existing;
+	}
+
+	// Good time to forget the maps nobody is playing anymore
+	for (auto It{ Registry.Entries.CreateIterator() }; It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	for (auto It{ Registry.KeyedEntries.CreateIterator() }; It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	Registry.Entries.Add(Data->Fingerprint, Data);
+	if (!Data->Key.IsNone())
+	{
+		// A live entry with the same key but other data keeps the key, this data is found only by layout
+		if (!Registry.KeyedEntries.Contains(Data->Key))
+		{
+			Registry.KeyedEntries.Add(Data->Key, Data);
+		}
+	}
+	return Data;
+}
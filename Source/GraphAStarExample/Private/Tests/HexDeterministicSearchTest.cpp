@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexTestWorld.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHexDeterministicSearchTest, "GraphAStarExample.HexSearch.DeterministicAfterEdits",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHexDeterministicSearchTest::RunTest(const FString &Parameters)
+{
+	static const float Costs[]{ 2.f, 2.f, 2.f, 3.f, 5.f, -1.f };
+	constexpr int32 Radius{ 10 };
+
+	FRandomStream Random(47);
+	TArray<float> TileCosts;
+	TileCosts.SetNum(1 + 3 * Radius * (Radius + 1));
+	for (float &Cost : TileCosts)
+	{
+		Cost = Costs[Random.RandRange(0, UE_ARRAY_COUNT(Costs) - 1)];
+	}
+
+	// A machine that played the match: some tiles were cheap or blocked for a while, then went back as they were
+	FHexTestWorld Played;
+	Played.BuildGrid(Radius, [&TileCosts](int32 TileIndex) { return TileCosts[TileIndex]; });
+	AHexGrid &PlayedGrid{ *Played.Grid };
+	if (!TestEqual(TEXT("Number of tiles"), PlayedGrid.GetNumTiles(), TileCosts.Num()))
+	{
+		return false;
+	}
+
+	TArray<int32> EditedTiles;
+	for (int32 EditIndex{ 0 }; EditIndex < 8; ++EditIndex)
+	{
+		EditedTiles.AddUnique(Random.RandRange(0, TileCosts.Num() - 1));
+	}
+
+	PlayedGrid.BeginTileEdit();
+	for (const int32 TileIndex : EditedTiles)
+	{
+		PlayedGrid.SetTileBlocking(TileIndex, false);
+		PlayedGrid.SetTileCost(TileIndex, 1.f);
+	}
+	PlayedGrid.CommitTileEdit();
+
+	for (const int32 TileIndex : EditedTiles)
+	{
+		PlayedGrid.BeginTileEdit();
+		PlayedGrid.SetTileCost(TileIndex, FMath::Max(TileCosts[TileIndex], 1.f));
+		PlayedGrid.SetTileBlocking(TileIndex, TileCosts[TileIndex] <= 0.f);
+		PlayedGrid.CommitTileEdit();
+	}
+
+	// A late joiner that built the same tiles from scratch
+	FHexTestWorld Joined;
+	Joined.BuildGrid(Radius, [&TileCosts](int32 TileIndex) { return TileCosts[TileIndex]; });
+
+	for (int32 QueryIndex{ 0 }; QueryIndex < 50; ++QueryIndex)
+	{
+		const int32 StartTile{ Random.RandRange(0, TileCosts.Num() - 1) };
+		const int32 GoalTile{ Random.RandRange(0, TileCosts.Num() - 1) };
+		const FString Query{ FString::Printf(TEXT("%d -> %d"), StartTile, GoalTile) };
+
+		TArray<int32> PlayedTiles;
+		int64 PlayedCost{ 0 };
+		const bool bPlayedFound{ Played.NavMesh->FindDeterministicTilePath(StartTile, GoalTile, nullptr, PlayedTiles, PlayedCost) };
+
+		TArray<int32> JoinedTiles;
+		int64 JoinedCost{ 0 };
+		const bool bJoinedFound{ Joined.NavMesh->FindDeterministicTilePath(StartTile, GoalTile, nullptr, JoinedTiles, JoinedCost) };
+
+		TestEqual(*(TEXT("Found, ") + Query), bPlayedFound, bJoinedFound);
+		TestEqual(*(TEXT("Fixed-point cost, ") + Query), PlayedCost, JoinedCost);
+		TestTrue(*(TEXT("Same tile sequence, ") + Query), PlayedTiles == JoinedTiles);
+	}
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexTestWorld.h"
+#include "HexJumpPointSearch.h"
+#include "HexContractionHierarchy.h"
+#include "HexParallelSearch.h"
+#include "HexDeterministicSearch.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHexSearchCostTest, "GraphAStarExample.HexSearch.SameCostOfGraphAStar",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+namespace HexSearchCostTest
+{
+	/* Cost of a path summed like FGraphAStar does, Path doesn't contain the start */
+	float GetPathCost(const FGridPathFilter &Filter, int32 StartRef, const TArray<int32> &Path)
+	{
+		float Cost{ 0.f };
+		for (const int32 NodeRef : Path)
+		{
+			Cost += Filter.GetTraversalCost(StartRef, NodeRef);
+			StartRef = NodeRef;
+		}
+		return Cost;
+	}
+
+	/* A random tile that isn't blocking */
+	int32 GetRandomFreeTile(const AHexGrid &Grid, FRandomStream &Random)
+	{
+		int32 TileIndex{ INDEX_NONE };
+		do
+		{
+			TileIndex = Random.RandRange(0, Grid.GetNumTiles() - 1);
+		} while (Grid.IsTileBlocking(TileIndex));
+		return TileIndex;
+	}
+}
+
+bool FHexSearchCostTest::RunTest(const FString &Parameters)
+{
+	using namespace HexSearchCostTest;
+
+	// Costs are multiples of 0.5, so the sums are exact and every search must find the very same cost
+	static const float Costs[]{ 2.f, 2.f, 2.f, 2.f, 2.f, 2.5f, 3.f, 4.f, -1.f, -1.f };
+	static const float PortalCosts[]{ 0.f, 0.5f, 3.f };
+
+	for (int32 Seed{ 0 }; Seed < 4; ++Seed)
+	{
+		FRandomStream Random(Seed);
+		FHexTestWorld TestWorld;
+		TestWorld.BuildGrid(12, [&Random](int32 TileIndex)
+		{
+			return Costs[Random.RandRange(0, UE_ARRAY_COUNT(Costs) - 1)];
+		});
+		AHexGrid &Grid{ *TestWorld.Grid };
+
+		for (int32 PortalIndex{ 0 }; PortalIndex < 4; ++PortalIndex)
+		{
+			const int32 FromRef{ GetRandomFreeTile(Grid, Random) };
+			const int32 ToRef{ GetRandomFreeTile(Grid, Random) };
+			if (FromRef != ToRef)
+			{
+				Grid.AddPortal(Grid.GetTileCoord(FromRef), Grid.GetTileCoord(ToRef), PortalCosts[Random.RandRange(0, UE_ARRAY_COUNT(PortalCosts) - 1)], Random.RandRange(0, 1) == 1);
+			}
+		}
+
+		FGridPathFilter Filter(*TestWorld.NavMesh, nullptr, &Grid);
+		Filter.CongestionWeight = 0.f;
+
+		FHexJumpPointData Data;
+		Data.Build(Grid, Filter);
+
+		// A few tiles cheaper than the rest of the grid for a while: the minimum must go back up with them
+		TArray<int32> EditedTiles;
+		TArray<float> OldCosts;
+		for (int32 EditIndex{ 0 }; EditIndex < 5; ++EditIndex)
+		{
+			const int32 TileIndex{ GetRandomFreeTile(Grid, Random) };
+			EditedTiles.Add(TileIndex);
+			OldCosts.Add(Grid.GetTileCost(TileIndex));
+		}
+
+		Grid.BeginTileEdit();
+		for (const int32 TileIndex : EditedTiles)
+		{
+			Grid.SetTileCost(TileIndex, 1.f);
+		}
+		Grid.CommitTileEdit();
+		Data.Update(Grid, Filter, EditedTiles);
+		TestEqual(TEXT("MinTileCost after lowering tiles"), Data.MinTileCost, 1.f);
+
+		Grid.BeginTileEdit();
+		for (int32 EditIndex{ EditedTiles.Num() - 1 }; EditIndex >= 0; --EditIndex)
+		{
+			Grid.SetTileCost(EditedTiles[EditIndex], OldCosts[EditIndex]);
+		}
+		Grid.CommitTileEdit();
+		Data.Update(Grid, Filter, EditedTiles);
+
+		FHexJumpPointData BuiltData;
+		BuiltData.Build(Grid, Filter);
+		TestEqual(TEXT("MinTileCost of Update and Build"), Data.MinTileCost, BuiltData.MinTileCost);
+
+		FHexContractionHierarchy Hierarchy;
+		Hierarchy.Build(Grid, Filter);
+
+		for (int32 QueryIndex{ 0 }; QueryIndex < 40; ++QueryIndex)
+		{
+			const int32 StartRef{ GetRandomFreeTile(Grid, Random) };
+			const int32 GoalRef{ GetRandomFreeTile(Grid, Random) };
+
+			TArray<int32> Path;
+			FGraphAStar<AHexGrid> Pathfinder(Grid);
+			if (Pathfinder.FindPath(StartRef, GoalRef, Filter, Path) != SearchSuccess)
+			{
+				continue;
+			}
+			const float ExpectedCost{ GetPathCost(Filter, StartRef, Path) };
+			const FString Query{ FString::Printf(TEXT("seed %d, %d -> %d"), Seed, StartRef, GoalRef) };
+
+			FHexJumpPointSearch JumpPointSearch(Grid, Filter, Data);
+			TestEqual(*(TEXT("Jump point search result, ") + Query), int32(JumpPointSearch.FindPath(StartRef, GoalRef, Path)), int32(SearchSuccess));
+			TestEqual(*(TEXT("Jump point search cost, ") + Query), GetPathCost(Filter, StartRef, Path), ExpectedCost);
+
+			TestEqual(*(TEXT("Contraction hierarchy result, ") + Query), int32(Hierarchy.FindPath(StartRef, GoalRef, Path)), int32(SearchSuccess));
+			TestEqual(*(TEXT("Contraction hierarchy cost, ") + Query), GetPathCost(Filter, StartRef, Path), ExpectedCost);
+
+			FHexParallelSearch ParallelSearch(Grid, Filter, Data, 4);
+			TestEqual(*(TEXT("Parallel search result, ") + Query), int32(ParallelSearch.FindPath(StartRef, GoalRef, Path)), int32(SearchSuccess));
+			TestEqual(*(TEXT("Parallel search cost, ") + Query), GetPathCost(Filter, StartRef, Path), ExpectedCost);
+
+			FHexDeterministicSearch DeterministicSearch(Grid, Filter, Data);
+			TestEqual(*(TEXT("Deterministic search result, ") + Query), int32(DeterministicSearch.FindPath(StartRef, GoalRef, Path)), int32(SearchSuccess));
+			TestEqual(*(TEXT("Deterministic search cost, ") + Query), GetPathCost(Filter, StartRef, Path), ExpectedCost);
+			TestEqual(*(TEXT("Deterministic fixed-point cost, ") + Query),
+				DeterministicSearch.GetPathCost(), FHexDeterministicSearch::ToFixed(ExpectedCost));
+		}
+	}
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
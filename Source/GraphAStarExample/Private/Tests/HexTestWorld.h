@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphAStarNavMesh.h"
+#include "HexGrid/HexGrid.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * An empty world with a grid and a navmesh for the automation tests, the same setup of the replay commandlet.
+ * The world is destroyed with the struct.
+ */
+struct FHexTestWorld
+{
+	FHexTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false);
+		FWorldContext &WorldContext{ GEngine->CreateNewWorldContext(EWorldType::Game) };
+		WorldContext.SetCurrentWorld(World);
+
+		Grid = World->SpawnActor<AHexGrid>();
+		NavMesh = World->SpawnActor<AGraphAStarNavMesh>();
+	}
+
+	~FHexTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	FHexTestWorld(const FHexTestWorld &) = delete;
+	FHexTestWorld &operator=(const FHexTestWorld &) = delete;
+
+	/**
+	 * Create a grid of the given radius and register it on the navmesh.
+	 * TileCost is called once for each tile in index order, a cost <= 0 makes a blocking tile.
+	 */
+	void BuildGrid(const int32 Radius, TFunctionRef<float(int32 TileIndex)> TileCost)
+	{
+		// No key, each test grid has its own tiles
+		Grid->SharedDataKey = NAME_None;
+		Grid->CreateGrid(FHTileLayout(EHTileOrientationFlag::FLAT, 100.f, FVector::ZeroVector), Radius, FCreationStepDelegate());
+
+		Grid->GridTiles.SetNum(Grid->GetNumTiles());
+		for (int32 TileIndex{ 0 }; TileIndex < Grid->GridTiles.Num(); ++TileIndex)
+		{
+			FHexTile &Tile{ Grid->GridTiles[TileIndex] };
+			Tile.CubeCoord = Grid->GetTileCoord(TileIndex);
+			Tile.WorldPosition = Grid->HexToWorld(Tile.CubeCoord);
+
+			const float Cost{ TileCost(TileIndex) };
+			Tile.Cost = FMath::Max(Cost, 1.f);
+			Tile.bIsBlocking = Cost <= 0.f;
+		}
+		Grid->RebuildPackedCoordinates();
+
+		NavMesh->SetHexGrid(nullptr);
+		NavMesh->SetHexGrid(Grid);
+	}
+
+	UWorld *World{ nullptr };
+	AHexGrid *Grid{ nullptr };
+	AGraphAStarNavMesh *NavMesh{ nullptr };
+};
+
+#endif //WITH_DEV_AUTOMATION_TESTS
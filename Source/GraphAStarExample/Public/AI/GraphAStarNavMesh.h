@@ -4,18 +4,145 @@
 
 #include "CoreMinimal.h"
 #include "NavMesh/RecastNavMesh.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "HexJumpPointSearch.h"
+#include "HexContractionHierarchy.h"
+#include "HexPathCode.h"
+#include "HexPathPreview.h"
+#include "HexGrid/HGTypes.h"
 #include "GraphAStarNavMesh.generated.h"
 
+class AHexGrid;
+
 DECLARE_LOG_CATEGORY_EXTERN(LogGraphAStarExample_NavMesh, Log, All);
 
 DECLARE_CYCLE_STAT(TEXT("Hex Grid A* Pathfinding"), STAT_Navigation_HGASPathfinding, STATGROUP_Navigation);
+DECLARE_CYCLE_STAT(TEXT("Hex Grid Range Query"), STAT_Navigation_HGASRangeQuery, STATGROUP_Navigation);
+DECLARE_CYCLE_STAT(TEXT("Hex Grid Navigation Query"), STAT_Navigation_HGASQuery, STATGROUP_Navigation);
+
+/**
+ * How a filter profile treats the blocking flag of a tile class.
+ */
+UENUM(BlueprintType)
+enum class EHexTileTraversal : uint8
+{
+	/* Use FHexTile::bIsBlocking */
+	Default,
+	/* Always traversable, even if the tile is blocking (e.g. a unit that can swim) */
+	Allowed,
+	/* Never traversable */
+	Blocked
+};
+
+/**
+ * Rule of a filter profile for a single tile class.
+ */
+USTRUCT(BlueprintType)
+struct FHexTileClassRule
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* The FHexTile::TileClass this rule applies to */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Profiles")
+	uint8 TileClass{ 0 };
+
+	/* Multiplier of FHexTile::Cost */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Profiles", meta = (ClampMin = 0.01))
+	float CostMultiplier{ 1.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Profiles")
+	EHexTileTraversal Traversal{ EHexTileTraversal::Default };
+};
+
+/**
+ * A named cost model (heavy unit, light unit...) selected by the navigation query filter class,
+ * tile classes without a rule keep the tile cost and blocking flag.
+ */
+USTRUCT(BlueprintType)
+struct FHexFilterProfile
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Profiles")
+	FName Name;
+
+	/* Queries using this filter class (e.g. the MoveTo FilterClass) will use this profile */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Profiles")
+	TSubclassOf<UNavigationQueryFilter> FilterClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Profiles")
+	TArray<FHexTileClassRule> Rules;
+
+	/* Cost layers of the grid (AHexGrid::AddCostLayer) added to the costs of this profile, e.g. scouts fear the threat layer more than tanks */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Profiles")
+	TArray<FHexCostLayerWeight> CostLayerWeights;
+};
+
+/**
+ * Cost layers of a grid blended with the weights of a cost model, rebuilt by the navmesh tick when the layers change.
+ * A query keeps a reference to the snapshot it started with, so the tick can replace it while the query runs.
+ */
+struct FHexCostBlend
+{
+	TArray<FHexCostLayerWeight> Weights;
+
+	/* One for each tile with tile data (AHexGrid::GetNumTileData), null without weights. Swapped under AGraphAStarNavMesh::CostBlendLock */
+	TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> Costs;
+
+	/* Versions of the layers and of the tiles the snapshot was built with */
+	int32 LayersVersion{ INDEX_NONE };
+	int32 GridVersion{ INDEX_NONE };
+};
+
+/**
+ * A filter profile "compiled" against the current grid: the final cost of each tile,
+ * so the pathfinder pays a single array read per expansion whatever the number of rules.
+ * Immutable once published in FHexNavGrid::CompiledFilterProfiles: a change builds a new copy and swaps it,
+ * the queries that already pinned the old one finish with it.
+ */
+struct FHexCompiledFilterProfile
+{
+	/* Marker used in TileCosts for tiles that can't be traversed */
+	static constexpr float BlockedCost{ -1.f };
+
+	FName Name;
+	TSubclassOf<UNavigationQueryFilter> FilterClass;
+
+	/* Rules of the source profile indexed by TileClass, kept to patch single tiles */
+	float Multipliers[256];
+	EHexTileTraversal Traversals[256];
+
+	/* One for each tile with tile data, see AHexGrid::GetNumTileData */
+	TArray<float> TileCosts;
+
+	/* Uniform regions of this cost model, for FHexJumpPointSearch */
+	FHexJumpPointData JumpPointData;
+
+	/* Preprocessed search graph of this cost model, see AGraphAStarNavMesh::bUseContractionHierarchy. Shared with the other worlds on the same map */
+	TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> ContractionHierarchy;
+
+	/* Grid version ContractionHierarchy was built or loaded for */
+	int32 ContractionHierarchyVersion{ INDEX_NONE };
+
+	/* TileCosts plus the cost layers of the profile. Not part of the snapshot: shared by its copies, rebuilt in place by the tick */
+	TSharedRef<FHexCostBlend, ESPMode::ThreadSafe> CostBlend{ MakeShared<FHexCostBlend, ESPMode::ThreadSafe>() };
+
+	/* Compute the TileCosts entry of a tile */
+	void CompileTile(const AHexGrid &Grid, const int32 TileIndex);
+};
+
+typedef TSharedPtr<const FHexCompiledFilterProfile, ESPMode::ThreadSafe> FHexCompiledFilterProfilePtr;
 
 /**
  * TQueryFilter (FindPath's parameter) filter class is what decides which graph edges can be used and at what cost.
  */
 struct FGridPathFilter
 {
-	FGridPathFilter(const AGraphAStarNavMesh &InNavMeshRef) : NavMeshRef(InNavMeshRef) {}
+	/* InGrid is the grid we are searching, nullptr means the navmesh HexGrid. The caller keeps InProfile alive */
+	FGridPathFilter(const AGraphAStarNavMesh &InNavMeshRef, const FHexCompiledFilterProfile *InProfile = nullptr, const AHexGrid *InGrid = nullptr);
+
+	/* Same, the filter keeps the profile alive (e.g. the result of AGraphAStarNavMesh::FindFilterProfile) */
+	FGridPathFilter(const AGraphAStarNavMesh &InNavMeshRef, const FHexCompiledFilterProfilePtr &InProfile, const AHexGrid *InGrid = nullptr);
 
 	/**
 	 * Used as GetHeuristicCost's multiplier
@@ -42,32 +169,246 @@ struct FGridPathFilter
 	 */
 	bool WantsPartialSolution() const;
 
+	/**
+	 * Extra cost for each agent on the tile we enter, copied from AGraphAStarNavMesh::CongestionCostWeight.
+	 * Set it to 0 when the result must only depend on the tiles (cached data like the jump point data).
+	 */
+	float CongestionWeight{ 0.f };
+
+	/**
+	 * Rings of tiles around its own tile covered by the agent, tiles with a clearance not greater than this are blocked.
+	 * 0 for agents that fit in a tile, see AGraphAStarNavMesh::bUseAgentClearance.
+	 */
+	int32 FootprintRadius{ 0 };
+
+	/* Read the tile costs from a blend of the cost layers instead of the tiles, the filter keeps the snapshot alive */
+	void SetBlendedCosts(const TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> &InBlendedCosts);
+
+	bool HasBlendedCosts() const { return BlendedCostData != nullptr; }
+
 protected:
 
+	/**
+	 * Cost of entering a tile (profile and congestion), without the portal cost
+	 */
+	float GetTileCost(const int32 TileIndex) const;
+
 	/**
 	 * A reference to our NavMesh
 	 */
 	const AGraphAStarNavMesh &NavMeshRef;
+
+	/**
+	 * The grid of the search, one of the grids registered in NavMeshRef
+	 */
+	const AHexGrid &Grid;
+
+	/**
+	 * Cost model selected by the query, nullptr means the plain tile Cost/bIsBlocking
+	 */
+	const FHexCompiledFilterProfile *Profile;
+
+	/* Set by the pinning constructor */
+	FHexCompiledFilterProfilePtr PinnedProfile;
+
+	/**
+	 * Blended costs of the query, see SetBlendedCosts. The raw pointer is what the searches read
+	 */
+	TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> BlendedCosts;
+	const float *BlendedCostData{ nullptr };
 };
 
 
 // We inherit this struct because we need a custom GetCost/GetLength
 struct FHexNavMeshPath : public FNavMeshPath
 {
+	/* Cost from the path point to the end of the path, O(1) with the prefix sums */
 	FORCEINLINE
 	virtual float GetCostFromIndex(int32 PathPointIndex) const override
 	{
-		return CurrentPathCost;
+		return PrefixCosts.IsValidIndex(PathPointIndex) ? CurrentPathCost - PrefixCosts[PathPointIndex] : 0.f;
 	}
 
+	/* Remaining length in tiles, the current segment counts for the part we still have to walk */
 	FORCEINLINE
 	virtual float GetLengthFromPosition(FVector SegmentStart, uint32 NextPathPointIndex) const override
 	{
-		// We exclude the starting point so -1	
-		return PathPoints.Num() - 1;
+		const int32 NextIndex{ int32(NextPathPointIndex) };
+		if (NextIndex <= 0 || NextIndex >= PrefixCosts.Num())
+		{
+			return 0.f;
+		}
+
+		// Until the points are decoded we only know the tiles, the current segment counts as a whole tile
+		if (!bPathPointsDecoded)
+		{
+			return float(PrefixCosts.Num() - NextIndex);
+		}
+
+		const float SegmentLength{ FVector::Dist(PathPoints[NextIndex - 1].Location, PathPoints[NextIndex].Location) };
+		const float SegmentLeft{ SegmentLength > KINDA_SMALL_NUMBER ? FMath::Min(FVector::Dist(SegmentStart, PathPoints[NextIndex].Location) / SegmentLength, 1.f) : 0.f };
+		return SegmentLeft + (PathPoints.Num() - 1 - NextIndex);
 	}
 
+	/* Length in tiles, we don't need the points for it */
+	FORCEINLINE
+	virtual float GetLength() const override
+	{
+		return float(GetNumSteps());
+	}
+
+	/* Tiles after the start */
+	FORCEINLINE int32 GetNumSteps() const { return FMath::Max(PrefixCosts.Num() - 1, 0); }
+
+	/**
+	 * Fill PathPoints with a point for each tile of PathCode, until then they are only the start and the end of the path.
+	 * UHGPathFollowingComponent calls it before following the path, and the repath of a decoded path decodes the new one.
+	 * Game thread only. @return false if the code doesn't match the registered grids anymore.
+	 */
+	bool DecodePathPoints();
+
+	/* Total cost of the path */
 	float CurrentPathCost{ 0 };
+
+	/* Cost from the start to each tile of the path, the start included */
+	TArray<float> PrefixCosts;
+
+	/**
+	 * A tile edit queued the path in AGraphAStarNavMesh::PendingPathInvalidations, it stays registered until then.
+	 * Protected by AGraphAStarNavMesh::TilePathsLock, a repath clears it so the queued invalidation is dropped.
+	 */
+	bool bInvalidationPending{ false };
+
+	/* PathPoints has every tile of PathCode, not only the start and the end */
+	bool bPathPointsDecoded{ false };
+
+	/**
+	 * The path: the tiles, their grids and the filter of the query. It's what the path stores, the navmesh decodes it
+	 * to know which paths a tile edit affects and DecodePathPoints to build the FNavPathPoints.
+	 */
+	FHexPathCode PathCode;
+};
+
+/**
+ * Link between a tile of a grid and a tile of another grid (stairs between two floors, a bridge between two islands...).
+ * Queries that start and end on different grids follow these links.
+ */
+USTRUCT(BlueprintType)
+struct FHexGridConnection
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Grids")
+	AHexGrid *FromGrid{ nullptr };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Grids")
+	FHCubeCoord FromTile;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Grids")
+	AHexGrid *ToGrid{ nullptr };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Grids")
+	FHCubeCoord ToTile;
+
+	/* Cost of the travel, the cost of ToTile is added like for a regular step */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Grids", meta = (ClampMin = 0))
+	float Cost{ 0.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Grids")
+	bool bTwoWay{ true };
+};
+
+/**
+ * A grid registered in the navmesh and everything the navmesh derives from it.
+ */
+struct FHexNavGrid
+{
+	AHexGrid *Grid{ nullptr };
+
+	/* World bounds of the tiles, for the spatial lookup */
+	FBox Bounds{ ForceInit };
+
+	/*
+	 * FilterProfiles compiled against this grid, immutable. The game thread swaps the entries under
+	 * AGraphAStarNavMesh::CompiledDataLock, the queries pin the one they use (see FindFilterProfile)
+	 */
+	TArray<FHexCompiledFilterProfilePtr> CompiledFilterProfiles;
+
+	/* Jump point data of the default cost model (no profile), immutable and swapped like the profiles */
+	TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> DefaultJumpPointData{ MakeShared<FHexJumpPointData, ESPMode::ThreadSafe>() };
+
+	/* Contraction hierarchy of the default cost model (no profile), shared with the other worlds on the same map. Swapped like the profiles */
+	TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> DefaultContractionHierarchy;
+
+	/* Grid version DefaultContractionHierarchy was built or loaded for */
+	int32 DefaultContractionHierarchyVersion{ INDEX_NONE };
+
+	/* Tile costs plus the AGraphAStarNavMesh::DefaultCostLayerWeights layers, for the queries without a profile */
+	FHexCostBlend DefaultCostBlend;
+
+	/* For each tile the live paths that traverse it, protected by AGraphAStarNavMesh::TilePathsLock */
+	TArray<TArray<FNavPathWeakPtr>> TilePaths;
+};
+
+/* A path waiting to be invalidated, see AGraphAStarNavMesh::PathInvalidationDelay */
+struct FHexPendingPathInvalidation
+{
+	FNavPathWeakPtr Path;
+	float InvalidationTime{ 0.f };
+};
+
+/**
+ * Input of a bounded-cost flood query, all the SourceIndices are expanded together (multi-source Dijkstra)
+ * so a group of units, or a unit occupying more tiles, can be processed with a single query.
+ */
+USTRUCT(BlueprintType)
+struct FHexRangeQuery
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Tile indices where the flood starts, they are reached at cost 0. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Range")
+	TArray<int32> SourceIndices;
+
+	/** Maximum accumulated cost, tiles that cost more than this are not reachable. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Range")
+	float CostBudget{ 0.f };
+
+	/** Early termination, stop after this number of tiles have been settled (0 means no limit). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Range")
+	int32 MaxTiles{ 0 };
+
+	/** Selects the filter profile, same as the FilterClass of a MoveTo. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Range")
+	TSubclassOf<UNavigationQueryFilter> FilterClass;
+};
+
+/**
+ * Output of a bounded-cost flood query, the three arrays are parallel and sorted by increasing cost.
+ */
+USTRUCT(BlueprintType)
+struct FHexRangeResult
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Indices of the reachable tiles. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh|Range")
+	TArray<int32> TileIndices;
+
+	/** Cheapest cost to reach each tile from the nearest source. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh|Range")
+	TArray<float> Costs;
+
+	/** Index of the tile we came from, INDEX_NONE for the sources. Follow it to rebuild a path. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh|Range")
+	TArray<int32> ParentIndices;
+
+	void Reset()
+	{
+		TileIndices.Reset();
+		Costs.Reset();
+		ParentIndices.Reset();
+	}
 };
 
 /**
@@ -90,10 +431,86 @@ public:
 	 */
 	static FPathFindingResult FindPath(const FNavAgentProperties &AgentProperties, const FPathFindingQuery &Query);
 	
-	/* Set a pointer to an hexagonal grid, it can be nullptr */
+	/* Set a pointer to an hexagonal grid, it can be nullptr. This is the primary grid, see RegisterHexGrid for the others */
 	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh")
 	void SetHexGrid(class AHexGrid *HGrid);
 
+	/**
+	 * Add another grid (an island, a floor, an arena...), queries are routed to the grid under their start location
+	 * and follow the GridConnections to reach a different grid. The first registered grid becomes the HexGrid.
+	 * Range queries and occupancy work on the HexGrid only.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Grids")
+	void RegisterHexGrid(AHexGrid *Grid);
+
+	/* Remove a grid, if it's the HexGrid the next registered grid takes its place */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Grids")
+	void UnregisterHexGrid(AHexGrid *Grid);
+
+	/* Call it when a registered grid is moved or recreated, bounds and connections are computed at registration */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Grids")
+	void RefreshHexGrids();
+
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Grids")
+	void AddGridConnection(const FHexGridConnection &Connection);
+
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Grids")
+	void ClearGridConnections();
+
+	/* Registered grids, the first one is the HexGrid */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Grids")
+	void GetHexGrids(TArray<AHexGrid *> &OutGrids) const;
+
+	/**
+	 * Registered grid under a world location and the tile index, nullptr if the location isn't on a grid.
+	 * A hash of the world in GridLookupCellSize cells, so the cost doesn't grow with the number of grids.
+	 */
+	const FHexNavGrid *FindNavGridAt(const FVector &Location, int32 &OutTileIndex) const;
+
+	/* Registration data of a grid, nullptr if it isn't registered */
+	const FHexNavGrid *FindNavGrid(const AHexGrid *Grid) const;
+
+	/* Side of the cells of the grid lookup, bigger than most grids is a good value */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Grids", meta = (ClampMin = 100))
+	float GridLookupCellSize{ 20000.f };
+
+	/* Links between the registered grids, add them with AddGridConnection */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh|Grids")
+	TArray<FHexGridConnection> GridConnections;
+
+	/**
+	 * Bounded-cost flood from one or more source tiles, it returns every tile reachable within Query.CostBudget
+	 * with its cost and parent, using the same cost/blocking rules of FGridPathFilter.
+	 * Much cheaper than calling FindPath against each candidate tile (movement range, EQS overlays...).
+	 * @return false if we have no HexGrid or no valid source.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh")
+	bool FindTilesInRange(const FHexRangeQuery &Query, FHexRangeResult &OutResult) const;
+
+	/**
+	 * Same as FindTilesInRange but for many units at once, queries are distributed with ParallelFor
+	 * (they only read the grid so they can run concurrently). OutResults is parallel to Queries.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh")
+	void FindTilesInRangeBatch(const TArray<FHexRangeQuery> &Queries, TArray<FHexRangeResult> &OutResults) const;
+
+	/**
+	 * Compile FilterProfiles against the current tiles, SetHexGrid already does it
+	 * but call it again if you change the profiles or the tiles after that.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh")
+	void RebuildFilterProfiles();
+
+	/* Compiled profile used by queries with the given filter class, nullptr if there isn't one. Keep it as long as you use it */
+	FHexCompiledFilterProfilePtr FindFilterProfile(TSubclassOf<UNavigationQueryFilter> FilterClass) const;
+
+	/* Compiled profile matching the query filter of a FPathFindingQuery, nullptr if there isn't one */
+	FHexCompiledFilterProfilePtr FindFilterProfile(const FSharedConstNavQueryFilter &QueryFilter) const;
+
+	/* Same as above for a registered grid, the two functions above use the HexGrid */
+	FHexCompiledFilterProfilePtr FindFilterProfile(const FHexNavGrid &NavGrid, const FSharedConstNavQueryFilter &QueryFilter) const;
+	FHexCompiledFilterProfilePtr FindFilterProfile(const FHexNavGrid &NavGrid, TSubclassOf<UNavigationQueryFilter> FilterClass) const;
+
 	//////////////////////////////////////////////////////////////////////////
 	/**
 	 * Generic graph A* implementation
@@ -114,11 +531,424 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 
 
-	/* Just a pointer to an hexagonal grid actor */
+	/* Just a pointer to an hexagonal grid actor, the primary one if more grids are registered */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh")
 	class AHexGrid *HexGrid;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh")
 	float PathPointZOffset{0.f};
+
+	/**
+	 * If true tile edits invalidate the paths that cross the modified tiles (and only them),
+	 * agents are notified by the usual ENavPathEvent::Invalidated event and the path is recomputed.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Repath")
+	bool bInvalidatePathsOnTileChange{ true };
+
+	/* Seconds between the tile edit and the invalidation of the affected paths, 0 means immediately */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Repath", meta = (ClampMin = 0))
+	float PathInvalidationDelay{ 0.f };
+
+	/* Maximum number of delayed invalidations processed each tick, the rest wait the next frame (0 means no limit) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Repath", meta = (ClampMin = 0))
+	int32 MaxPathInvalidationsPerTick{ 0 };
+
+	virtual void TickActor(float DeltaTime, enum ELevelTick TickType, FActorTickFunction &ThisTickFunction) override;
+
+	/* Add a path to the tile -> paths index, FindPath does it for every hex path it builds */
+	void RegisterHexPath(const FNavPathSharedPtr &Path) const;
+
+	/* Remove a path from the tile -> paths index, and drop its pending invalidation */
+	void UnregisterHexPath(FHexNavMeshPath &Path) const;
+
+	/**
+	 * Use FHexJumpPointSearch instead of FGraphAStar, same path cost but regions of uniform cost
+	 * are skipped instead of expanded tile by tile. Best for big maps with large open areas.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh")
+	bool bUseJumpPointSearch{ false };
+
+	/**
+	 * Spread the search of the long queries over the task graph workers (hash distributed A*, see FHexParallelSearch).
+	 * Same path cost of the serial search, it's worth it only for long paths on big grids with many worker threads.
+	 * It's used instead of the jump point search for the queries that qualify.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Parallel")
+	bool bUseParallelSearch{ false };
+
+	/* Queries shorter than this (hex distance in tiles between start and goal) use the serial search */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Parallel", meta = (ClampMin = 1))
+	int32 ParallelSearchMinDistance{ 40 };
+
+	/* Workers of a parallel search, 0 means one for each task graph worker thread plus the calling thread */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Parallel", meta = (ClampMin = 0))
+	int32 ParallelSearchWorkers{ 0 };
+
+	/**
+	 * Lockstep mode, every query uses FHexDeterministicSearch: fixed-point costs and a total order for the ties, so every
+	 * machine finds the same path from the same grid and the same inputs and the paths don't need to be replicated.
+	 * Only the tile costs, the filter profiles and the clearance are used: occupancy, cost layers, contraction hierarchy,
+	 * jump point search and parallel search are skipped. World locations go through float conversions to find
+	 * the tiles, a lockstep simulation should give tile indices to FindDeterministicTilePath.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Lockstep")
+	bool bDeterministicSearch{ false };
+
+	/**
+	 * Deterministic search between two tiles of the HexGrid, whatever the value of bDeterministicSearch.
+	 * OutTiles contains every tile of the path (start excluded), OutFixedCost is in FHexDeterministicSearch::CostScale
+	 * units for each cost unit.
+	 * @return false if the goal can't be reached.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Lockstep")
+	bool FindDeterministicTilePath(int32 StartTile, int32 GoalTile, TSubclassOf<UNavigationQueryFilter> FilterClass,
+		TArray<int32> &OutTiles, int64 &OutFixedCost) const;
+
+	/**
+	 * Add an agent to the occupancy grid, its tile is updated every tick.
+	 * UHGPathFollowingComponent does it for its pawn.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Occupancy")
+	void RegisterOccupant(AActor *Occupant);
+
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Occupancy")
+	void UnregisterOccupant(AActor *Occupant);
+
+	/* Number of agents on the tile, safe to call from async pathfinding */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|NavMesh|Occupancy")
+	int32 GetTileOccupancy(int32 TileIndex) const;
+
+	/* Agents on the tile */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Occupancy")
+	void GetTileOccupants(int32 TileIndex, TArray<AActor *> &OutOccupants) const;
+
+	/**
+	 * If > 0 each agent on a tile adds this cost to the traversal of the tile, so paths spread across corridors
+	 * instead of going all through the same tiles. Jump point search is not used while it's enabled.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Occupancy", meta = (ClampMin = 0))
+	float CongestionCostWeight{ 0.f };
+
+	/**
+	 * Keep the agents wider than a tile out of the gaps narrower than them, with the clearance field of the grid
+	 * (AHexGrid::GetTileClearance) and the AgentRadius of the query. Their queries don't use the jump point search
+	 * and the contraction hierarchy, that data is built for agents that fit in a tile.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh")
+	bool bUseAgentClearance{ false };
+
+	/* Rings of tiles around its own tile that an agent of this radius overlaps, 0 if it fits in a tile */
+	static int32 GetFootprintRadius(const AHexGrid &Grid, const float AgentRadius);
+
+	/**
+	 * Record every path query (locations, filter, agent, result, time), every tile and portal edit and the cost layers
+	 * to a binary file, starting with a snapshot of the navmesh settings, the registered grids and their connections.
+	 * Replay it with the HexPathReplay commandlet to reproduce a workload. Registering a grid or changing the connections
+	 * stops the capture. A relative FileName goes in Saved/HexPathCaptures.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Capture")
+	bool StartPathQueryCapture(const FString &FileName);
+
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Capture")
+	void StopPathQueryCapture();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|NavMesh|Capture")
+	bool IsCapturingPathQueries() const;
+
+	/**
+	 * Build a path from a FHexPathCode (for example received from the server), with the same points and costs
+	 * FindPath would build for its tiles: the cost model is the one of the FilterClass of the code.
+	 * The points are decoded when a follower needs them, see FHexNavMeshPath::DecodePathPoints.
+	 * @return nullptr if the code doesn't match our grids.
+	 */
+	FNavPathSharedPtr CreatePathFromCode(const FHexPathCode &PathCode, const FVector &StartLocation) const;
+
+	/* Fill the points of a path from its PathCode, see FHexNavMeshPath::DecodePathPoints */
+	bool DecodePathPoints(FHexNavMeshPath &Path) const;
+
+	/* Location of a path point on the tile, HexToWorld plus the Z offset */
+	FVector GetTilePathLocation(const int32 TileIndex) const;
+
+	/* Same for a tile of any grid */
+	FVector GetTilePathLocation(AHexGrid &Grid, const int32 TileIndex) const;
+
+	/* Jump point data of the given cost model, Profile can be nullptr. Kept alive by the returned pointer */
+	TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> GetJumpPointData(const FHexCompiledFilterProfilePtr &Profile) const;
+
+	/* Jump point data of a cost model of a registered grid */
+	TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> GetJumpPointData(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfilePtr &Profile) const;
+
+	/**
+	 * Answer the queries with a contraction hierarchy (preprocessed when the grid is set, or loaded with
+	 * LoadContractionHierarchies) instead of a full search. For levels where the tiles don't change after load:
+	 * after the first tile edit the queries use the regular search until BuildContractionHierarchies is called again.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|Preprocessing")
+	bool bUseContractionHierarchy{ false };
+
+	/* Preprocess the current grid for the default cost model and every filter profile */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Preprocessing")
+	void BuildContractionHierarchies();
+
+	/* Save the preprocessed data to a file, a relative FileName goes in Saved/HexPreprocessing */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Preprocessing")
+	bool SaveContractionHierarchies(const FString &FileName) const;
+
+	/**
+	 * Load data saved by SaveContractionHierarchies, each cost model is used only if its costs didn't change since the save.
+	 * @return true if at least one cost model was loaded.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Preprocessing")
+	bool LoadContractionHierarchies(const FString &FileName);
+
+	/* Contraction hierarchy of the given cost model if it matches the current grid, nullptr otherwise */
+	TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> GetContractionHierarchy(const FHexCompiledFilterProfilePtr &Profile) const;
+
+	/* Same for a registered grid */
+	TSharedPtr<const FHexContractionHierarchy, ESPMode::ThreadSafe> GetContractionHierarchy(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfilePtr &Profile) const;
+
+	/* Cost models for the different unit types, selected by the query filter class */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh")
+	TArray<FHexFilterProfile> FilterProfiles;
+
+	/**
+	 * Cost layers added to the tile costs for the queries without a filter profile (profiles have their own weights).
+	 * Blends are rebuilt in the tick after a layer changes, queries that use them don't use the jump point search
+	 * and the contraction hierarchy.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|NavMesh|CostLayers")
+	TArray<FHexCostLayerWeight> DefaultCostLayerWeights;
+
+	/* Rebuild now the blends of the layers that changed, the tick does it once per frame. For code that doesn't tick (the replay) */
+	void FlushCostBlends();
+
+	/**
+	 * Path preview for the cursor hover of click-to-move. The search tree of the start tile is kept between the calls
+	 * (one for each start and filter class, MaxPathPreviews at most) so a new goal only expands the tiles the tree
+	 * didn't reach yet, and a goal already reached costs only the path walk. Same costs of FindPath without the occupancy.
+	 * Game thread only.
+	 * @return false if the goal can't be reached or the two locations aren't on the same grid.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Preview")
+	bool PreviewPath(const FVector &StartLocation, const FVector &GoalLocation, TSubclassOf<UNavigationQueryFilter> FilterClass,
+		TArray<FVector> &OutPathPoints, float &OutPathCost);
+
+	/* Drop the search trees of PreviewPath, e.g. when the player deselects the unit */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|NavMesh|Preview")
+	void ClearPathPreviews();
+
+	/* Search trees kept by PreviewPath, the least recently used one is recycled */
+	static constexpr int32 MaxPathPreviews{ 4 };
+
+	/* Snapshot of the blended costs of a cost model, nullptr if it doesn't use cost layers */
+	TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> GetBlendedCosts(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfile *Profile) const;
+
+	/**
+	 * Don't generate the Recast tiles at all, the registered grids answer every query (paths, projections,
+	 * raycasts and random points). Saves the build time and the memory of the tiles when the grids are the only
+	 * navigable space, queries outside of the grids fail instead of falling back to Recast.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh")
+	bool bSkipRecastGeneration{ false };
+
+	//==== ANavigationData queries ====
+	// With a HexGrid these are answered by the grid under the query location, with the same blocking rules of
+	// the query filter used by FindPath. Locations outside of the grids go to the Recast implementation.
+
+	/* The point keeps its XY if its tile is traversable, otherwise it goes to the closest traversable tile inside Extent */
+	virtual bool ProjectPoint(const FVector &Point, FNavLocation &OutLocation, const FVector &Extent, FSharedConstNavQueryFilter Filter = NULL, const UObject *Querier = NULL) const override;
+	virtual void BatchProjectPoints(TArray<FNavigationProjectionWork> &Workload, const FVector &Extent, FSharedConstNavQueryFilter Filter = NULL, const UObject *Querier = NULL) const override;
+	virtual void BatchProjectPoints(TArray<FNavigationProjectionWork> &Workload, FSharedConstNavQueryFilter Filter = NULL, const UObject *Querier = NULL) const override;
+
+	/* Center of a random traversable tile, every tile of every grid has the same chance */
+	virtual FNavLocation GetRandomPoint(FSharedConstNavQueryFilter Filter = NULL, const UObject *Querier = NULL) const override;
+
+	/* Center of a random tile connected to Origin by a walk that never leaves the radius */
+	virtual bool GetRandomReachablePointInRadius(const FVector &Origin, float Radius, FNavLocation &OutResult, FSharedConstNavQueryFilter Filter = NULL, const UObject *Querier = NULL) const override;
+
+	/* Center of a random traversable tile within the radius, connected or not */
+	virtual bool GetRandomPointInNavigableRadius(const FVector &Origin, float Radius, FNavLocation &OutResult, FSharedConstNavQueryFilter Filter = NULL, const UObject *Querier = NULL) const override;
+
+	/**
+	 * Static like FindPath and stored in RaycastImplementation by SetHexGrid. The ray walks the tiles under it and
+	 * stops at the first blocked (or missing) tile, HitLocation is the point where it leaves the last good tile.
+	 */
+	static bool HexRaycast(const ANavigationData *Self, const FVector &RayStart, const FVector &RayEnd, FVector &HitLocation, FSharedConstNavQueryFilter QueryFilter, const UObject *Querier);
+	//==== END OF ANavigationData queries ====
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent) override;
+#endif
+
+protected:
+
+	/* No generator while bSkipRecastGeneration is set */
+	virtual void ConditionalConstructGenerator() override;
+
+	/* ProjectPoint on a single grid */
+	bool ProjectPointToGrid(const FHexNavGrid &NavGrid, const FVector &Point, const FVector &Extent, const FSharedConstNavQueryFilter &Filter, FNavLocation &OutLocation) const;
+
+	/* Listener of AHexGrid tile edits, patches the derived data of the dirty tiles only */
+	virtual void OnHexTilesChanged(const struct FHexGridChange &Change, AHexGrid *ChangedGrid);
+
+	/* Stop listening a grid */
+	void UnbindHexGrid(AHexGrid *Grid);
+
+	/* Whether the compiled profile still matches the tiles of its grid */
+	bool IsFilterProfileUpToDate(const FHexNavGrid &NavGrid, const FHexCompiledFilterProfile *Compiled) const;
+
+	/* RebuildFilterProfiles for a single grid */
+	void RebuildFilterProfiles(FHexNavGrid &NavGrid);
+
+	/* Blend again the cost models of a grid whose layers or tiles changed */
+	void UpdateCostBlends(FHexNavGrid &NavGrid);
+
+	/* Replace the snapshot of a blend, BaseCosts are the tile costs of its cost model */
+	void UpdateCostBlend(const FHexNavGrid &NavGrid, FHexCostBlend &Blend, TArrayView<const float> BaseCosts);
+
+	/* Blends are swapped by the game thread and read by the async pathfinding */
+	mutable FCriticalSection CostBlendLock;
+
+	/* Compiled profiles, default jump point data and default hierarchy of each grid are swapped under it, see FHexNavGrid */
+	mutable FCriticalSection CompiledDataLock;
+
+	/* Publish new compiled profiles and default jump point data of a grid, the queries that pinned the old ones keep them */
+	void SwapCompiledData(FHexNavGrid &NavGrid, TArray<FHexCompiledFilterProfilePtr> &&Profiles, TSharedPtr<const FHexJumpPointData, ESPMode::ThreadSafe> &&DefaultJumpPointData);
+
+	/* Trees of PreviewPath */
+	TArray<TUniquePtr<FHexPathPreview>> PathPreviews;
+
+	/* BuildContractionHierarchies for a single grid */
+	void BuildContractionHierarchies(FHexNavGrid &NavGrid);
+
+	/* Registered grids, the first one is the HexGrid. Changed under NavGridsLock */
+	TArray<TUniquePtr<FHexNavGrid>> NavGrids;
+
+	/**
+	 * Lock of NavGrids and of the routing (GridLinks, GridLookupCells and the grid bounds).
+	 * FindPath and HexRaycast can run on the async pathfinding threads, they hold it for reading for the whole query.
+	 * The game thread is the only writer: it changes them under the write lock and reads them without locking.
+	 */
+	mutable FRWLock NavGridsLock;
+
+	FHexNavGrid *GetPrimaryNavGrid() const { return NavGrids.Num() > 0 ? NavGrids[0].Get() : nullptr; }
+
+	/* Add the grid to NavGrids (at the front if primary) and start listening it, the routing is empty until RebuildGridRouting */
+	FHexNavGrid &AddNavGrid(AHexGrid *Grid, const bool bPrimary);
+
+	/* Remove a grid from NavGrids, its paths and derived data go with it. The routing is empty until RebuildGridRouting */
+	void RemoveNavGridAt(const int32 Slot);
+
+	/* Grid connection resolved to NavGrids slots and tile indices */
+	struct FGridLink
+	{
+		int32 FromSlot{ INDEX_NONE };
+		int32 FromTile{ INDEX_NONE };
+		int32 ToSlot{ INDEX_NONE };
+		int32 ToTile{ INDEX_NONE };
+		float Cost{ 0.f };
+	};
+
+	/* Rebuild the grid bounds, the cells of the lookup and the links, after any change of NavGrids or GridConnections */
+	void RebuildGridRouting();
+
+	/* GridConnections resolved by RebuildGridRouting */
+	TArray<FGridLink> GridLinks;
+
+	/* For each lookup cell the NavGrids slots whose bounds overlap it */
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<2>>> GridLookupCells;
+
+	/* NavGrids index of a grid, INDEX_NONE if it isn't registered */
+	int32 GetNavGridSlot(const AHexGrid *Grid) const;
+
+	/* A run of tiles of a path on the same grid */
+	struct FGridSegment
+	{
+		const FHexNavGrid *NavGrid{ nullptr };
+		/* Pinned until the path is built */
+		FHexCompiledFilterProfilePtr Profile;
+		int32 NumTiles{ 0 };
+		/* Cost of the connection that leads to this segment, 0 for the first one */
+		float HopCost{ 0.f };
+	};
+
+	/**
+	 * Search a single grid, with the same choice of algorithm (contraction hierarchy, jump point search or A*) of every query.
+	 * OutProfile is the cost model used.
+	 */
+	EGraphAStarResult SearchGrid(const FHexNavGrid &NavGrid, const FSharedConstNavQueryFilter &QueryFilter, const int32 StartIdx, const int32 EndIdx,
+		TArray<int32> &OutPath, FHexCompiledFilterProfilePtr &OutProfile, const float AgentRadius = 0.f) const;
+
+	/**
+	 * Search across grids: the route with the fewest connections, then on each grid of the route a regular search
+	 * to the closest connection that can be reached. OutSegments tells the grid of each run of OutPath.
+	 */
+	EGraphAStarResult SearchGrids(const FHexNavGrid &StartNavGrid, const int32 StartIdx, const FHexNavGrid &EndNavGrid, const int32 EndIdx,
+		const FSharedConstNavQueryFilter &QueryFilter, TArray<int32> &OutPath, TArray<FGridSegment> &OutSegments, const float AgentRadius = 0.f) const;
+
+	/* Call Func for each tile of the path with the grid it belongs to */
+	void ForEachPathTile(const FHexNavMeshPath &Path, TFunctionRef<void(FHexNavGrid &, int32)> Func) const;
+
+	/* Decode a path code against our grids, false if a grid of the path isn't registered */
+	bool DecodePathCode(const FHexPathCode &PathCode, TArray<int32> &OutPathIndices, TArray<FHexPathGridSpan> &OutSpans) const;
+
+	/* PathPoints of a path after its first point: every tile when bPathPointsDecoded, else only the last one */
+	void AddPathPoints(FHexNavMeshPath &Path, const TArray<int32> &PathIndices, const TArray<FHexPathGridSpan> &Spans) const;
+
+	/* Full path of a preprocessing file */
+	static FString GetPreprocessingFileName(const FString &FileName);
+
+	/* Update the tile of every occupant, once per tick */
+	void UpdateOccupancy();
+
+	/* Swap remove of an occupant slot */
+	void RemoveOccupantAt(int32 Slot);
+
+	/* Occupancy linked lists, add or remove an occupant slot from the list of its tile */
+	void LinkOccupant(int32 Slot, int32 TileIndex);
+	void UnlinkOccupant(int32 Slot);
+
+	/* Agents of the occupancy grid, the Occupant arrays below are parallel to this one */
+	TArray<TWeakObjectPtr<AActor>> Occupants;
+
+	/* Tile of each occupant, INDEX_NONE if outside of the grid */
+	TArray<int32> OccupantTiles;
+
+	/* Doubly linked list of the occupants of a tile, so "who is on tile X" doesn't need a search */
+	TArray<int32> OccupantNext;
+	TArray<int32> OccupantPrev;
+	TArray<int32> TileFirstOccupant;
+
+	/* Number of occupants of each tile, read by the pathfinding threads with atomics */
+	TArray<int32> TileOccupancy;
+
+	/* Scratch arrays of UpdateOccupancy */
+	TArray<FVector> OccupantLocations;
+	TArray<int32> NewOccupantTiles;
+
+
+	/**
+	 * Lock of the inverted index tile -> paths of each grid (FHexNavGrid::TilePaths).
+	 * Mutable because FindPath is static and works on a const navmesh, and it can run on async pathfinding threads.
+	 */
+	mutable FCriticalSection TilePathsLock;
+
+	/* Invalidate the live paths of a grid that cross one of the dirty tiles */
+	void InvalidatePathsOnTiles(FHexNavGrid &NavGrid, const TArray<int32> &DirtyTiles);
+
+	/* Unregister the path and invalidate it, the path following asks the repath */
+	void InvalidateHexPath(const FNavPathSharedPtr &Path);
+
+	/* Paths waiting for PathInvalidationDelay, ordered by time */
+	TArray<FHexPendingPathInvalidation> PendingPathInvalidations;
+
+	/* Thread safe copy of the current capture, FindPath can run on the async pathfinding threads */
+	TSharedPtr<class FHexPathQueryCapture, ESPMode::ThreadSafe> GetQueryCapture() const;
+
+	/* A grid or a connection was added or removed, the snapshot of the capture doesn't match them anymore */
+	void StopPathQueryCaptureOnGridsChange();
+
+	TSharedPtr<class FHexPathQueryCapture, ESPMode::ThreadSafe> QueryCapture;
+	mutable FCriticalSection QueryCaptureLock;
 };
 
@@ -21,4 +21,10 @@ class GRAPHASTAREXAMPLE_API AHGAIController : public AAIController
 public:
 
 	AHGAIController(const FObjectInitializer &ObjectInitializer = FObjectInitializer::Get());
+
+protected:
+
+	/* The occupancy grid tracks the pawn, not us */
+	virtual void OnPossess(APawn *InPawn) override;
+	virtual void OnUnPossess() override;
 };
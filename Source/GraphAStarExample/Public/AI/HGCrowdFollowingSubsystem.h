@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Components/LineBatchComponent.h"
+#include "HGCrowdFollowingSubsystem.generated.h"
+
+class UHGPathFollowingComponent;
+
+DECLARE_CYCLE_STAT(TEXT("Hex Grid Crowd Following"), STAT_HGCrowdFollowing, STATGROUP_Navigation);
+
+/**
+ * Crowd-scale path following for UHGPathFollowingComponent with bUseCrowdFollowing set.
+ *
+ * Instead of ticking hundreds of components (and their virtual FollowPathSegment) we tick this system once per frame,
+ * the per-agent state (current path index, segment endpoints, last requested velocity) lives in contiguous arrays.
+ * Agents far from the camera "think" (read their location, check the segment, compute a new velocity) at a lower rate
+ * and in the meantime they keep moving with the last velocity.
+ *
+ * The engine state machine is still in charge of segment transitions, path end and invalid paths:
+ * we call UpdatePathSegment only when an agent is close to the end of its segment, is on the last one or lost its path.
+ */
+UCLASS()
+class GRAPHASTAREXAMPLE_API UHGCrowdFollowingSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Add an agent to the batch, the component stops ticking by itself */
+	void RegisterAgent(UHGPathFollowingComponent *Agent);
+
+	/* Remove an agent from the batch */
+	void UnregisterAgent(UHGPathFollowingComponent *Agent);
+
+	//~ Begin FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld *GetTickableGameObjectWorld() const override;
+	//~ End FTickableGameObject
+
+	/* Agents closer than this to the camera think every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|CrowdFollowing", meta = (ClampMin = 0))
+	float NearDistance{ 2000.f };
+
+	/* Agents farther than this to the camera think every FarThinkInterval seconds, in between the interval is interpolated */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|CrowdFollowing", meta = (ClampMin = 0))
+	float FarDistance{ 6000.f };
+
+	/* Keep it small, an agent between two thinks can go past the end of its segment */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|CrowdFollowing", meta = (ClampMin = 0))
+	float FarThinkInterval{ 0.1f };
+
+	/* Distance (2D) from the end of the segment at which we let the engine check if the segment is finished */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|CrowdFollowing", meta = (ClampMin = 0))
+	float SegmentReachRadius{ 50.f };
+
+private:
+
+	/* Remove the agent at the given index, the last agent takes its place */
+	void RemoveAgentAt(int32 AgentIndex);
+
+	/* Copy the current segment of the agent from its component */
+	void RefreshSegment(int32 AgentIndex);
+
+	/* Think interval of an agent at the given squared distance from the camera */
+	float GetThinkInterval(float DistanceSquared) const;
+
+	/* The agents, every array below is parallel to this one */
+	UPROPERTY(Transient)
+	TArray<UHGPathFollowingComponent *> Agents;
+
+	/* Path of the cached segment, only compared with the current one */
+	TArray<const FNavigationPath *> CachedPaths;
+
+	/* Index of the path point where the cached segment starts */
+	TArray<int32> SegmentIndices;
+
+	TArray<FVector> SegmentStarts;
+	TArray<FVector> SegmentEnds;
+
+	/* Velocity requested at the last think, requested again in the frames we skip */
+	TArray<FVector> MoveVelocities;
+
+	/* Time since the last think and time between two thinks */
+	TArray<float> ThinkTimes;
+	TArray<float> ThinkIntervals;
+
+#if ENABLE_DRAW_DEBUG
+	/* All the debug lines of the frame, sent to the world LineBatcher in one go */
+	TArray<FBatchedLine> DebugLines;
+#endif
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryGenerator.h"
+#include "DataProviders/AIDataProvider.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "HGEnvQueryGenerator_HexTiles.generated.h"
+
+UENUM()
+enum class EHexTileGeneratorShape : uint8
+{
+	/* Every tile at Radius steps or less from a context tile */
+	Range,
+	/* Tiles at exactly Radius steps from a context tile */
+	Ring,
+	/* Tiles that a path from the closest context tile reaches within CostBudget, same rules of FindPath */
+	Reachable
+};
+
+/**
+ * Generate the tiles of the HexGrid of AGraphAStarNavMesh around the context as UHGEnvQueryItemType_HexTile items.
+ *
+ * Tiles come straight from the grid indices (UHexGridQueryLibrary shapes or one multi-source
+ * AGraphAStarNavMesh::FindTilesInRange for every context), there are no projections and no traces.
+ * A tile shared by the shapes of two context locations is generated once.
+ */
+UCLASS(meta = (DisplayName = "Hex Tiles"))
+class GRAPHASTAREXAMPLE_API UHGEnvQueryGenerator_HexTiles : public UEnvQueryGenerator
+{
+	GENERATED_BODY()
+
+public:
+
+	UHGEnvQueryGenerator_HexTiles(const FObjectInitializer &ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void GenerateItems(FEnvQueryInstance &QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+	virtual FText GetDescriptionDetails() const override;
+
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS")
+	EHexTileGeneratorShape Shape{ EHexTileGeneratorShape::Range };
+
+	/* Tiles around these locations, contexts outside of the HexGrid are skipped */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS")
+	TSubclassOf<UEnvQueryContext> GenerateAround;
+
+	/* Radius in tiles of Range and Ring */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS", meta = (EditCondition = "Shape != EHexTileGeneratorShape::Reachable"))
+	FAIDataProviderIntValue Radius;
+
+	/* Maximum path cost of Reachable */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS", meta = (EditCondition = "Shape == EHexTileGeneratorShape::Reachable"))
+	FAIDataProviderFloatValue CostBudget;
+
+	/* Filter profile of Reachable, same as the FilterClass of a MoveTo */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS", meta = (EditCondition = "Shape == EHexTileGeneratorShape::Reachable"))
+	TSubclassOf<UNavigationQueryFilter> FilterClass;
+
+	/* Skip the blocking tiles in Range and Ring (Reachable never has them) */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS")
+	bool bSkipBlockingTiles{ true };
+};
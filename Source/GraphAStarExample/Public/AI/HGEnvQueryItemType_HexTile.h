@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_Point.h"
+#include "HGEnvQueryItemType_HexTile.generated.h"
+
+class AGraphAStarNavMesh;
+
+DECLARE_CYCLE_STAT(TEXT("Hex Grid EQS"), STAT_Navigation_HGASEnvQuery, STATGROUP_Navigation);
+
+/**
+ * EQS item for a tile of the HexGrid of AGraphAStarNavMesh.
+ *
+ * The value is a FNavLocation like the Point items, the location is the path location of the tile and the NodeRef
+ * is its tile index. Being a Point the item works with every engine test that works on locations
+ * (distance, trace, dot...), while our hex tests read the index directly and never look the tile up again.
+ */
+UCLASS()
+class GRAPHASTAREXAMPLE_API UHGEnvQueryItemType_HexTile : public UEnvQueryItemType_Point
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Tile index stored in the item, INDEX_NONE if it isn't a valid index */
+	static int32 GetTileIndex(const uint8 *RawData);
+
+	/* Our navmesh, the default navigation data of the world. nullptr if the world uses a different one */
+	static AGraphAStarNavMesh *GetNavMesh(const UObject *WorldContextObject);
+
+	/* Index of the HexGrid tile under Location, INDEX_NONE if it's outside of the HexGrid */
+	static int32 GetTileAt(const AGraphAStarNavMesh &NavMesh, const FVector &Location);
+};
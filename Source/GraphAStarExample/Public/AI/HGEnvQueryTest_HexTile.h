@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTest.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "HGEnvQueryTest_HexTile.generated.h"
+
+class AGraphAStarNavMesh;
+class AHexGrid;
+
+UENUM()
+enum class EHexTileTest : uint8
+{
+	/* Path cost from the closest context tile, same rules of FindPath */
+	PathCost,
+	/* Distance in tiles from each context tile */
+	Distance,
+	/* Number of agents on the tile (AGraphAStarNavMesh occupancy) */
+	Occupancy,
+	/* True if the tile is in the field of view (FHexFieldOfView) of each context tile */
+	LineOfSight
+};
+
+/**
+ * Test of UHGEnvQueryItemType_HexTile items, it works on the grid indices of the items.
+ *
+ * Every item is evaluated in a single pass over the grid data: PathCost runs one multi-source flood from all the
+ * contexts and then reads the cost of each item, instead of a path query for each item like the engine
+ * Pathfinding test. LineOfSight shadowcasts the field of view of each context once and then reads a bit for each item.
+ * Distance and occupancy read the packed coordinates and the occupancy counters directly, there are no traces
+ * and no projections.
+ */
+UCLASS(meta = (DisplayName = "Hex Tile"))
+class GRAPHASTAREXAMPLE_API UHGEnvQueryTest_HexTile : public UEnvQueryTest
+{
+	GENERATED_BODY()
+
+public:
+
+	UHGEnvQueryTest_HexTile(const FObjectInitializer &ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void RunTest(FEnvQueryInstance &QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+	virtual FText GetDescriptionDetails() const override;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent) override;
+#endif
+
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS")
+	EHexTileTest TestMode{ EHexTileTest::PathCost };
+
+	/* Tiles of these locations are the other end of PathCost, Distance and LineOfSight */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS", meta = (EditCondition = "TestMode != EHexTileTest::Occupancy"))
+	TSubclassOf<UEnvQueryContext> Context;
+
+	/* Filter profile of PathCost, same as the FilterClass of a MoveTo */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS", meta = (EditCondition = "TestMode == EHexTileTest::PathCost"))
+	TSubclassOf<UNavigationQueryFilter> FilterClass;
+
+	/**
+	 * Items that the flood doesn't reach fail, otherwise they get BIG_NUMBER.
+	 * When the test filters, the flood stops at the FloatValueMax of a Maximum or Range filter and the tiles past it fail too.
+	 * A score only test floods the whole grid.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "GraphAStarExample|EQS", meta = (EditCondition = "TestMode == EHexTileTest::PathCost"))
+	bool bSkipUnreachable{ true };
+
+protected:
+
+	void RunPathCost(FEnvQueryInstance &QueryInstance, const AGraphAStarNavMesh &NavMesh, const TArray<int32> &ContextTiles, const float MinThresholdValue, const float MaxThresholdValue) const;
+	void RunDistance(FEnvQueryInstance &QueryInstance, const AHexGrid &Grid, const TArray<int32> &ContextTiles, const float MinThresholdValue, const float MaxThresholdValue) const;
+	void RunOccupancy(FEnvQueryInstance &QueryInstance, const AGraphAStarNavMesh &NavMesh, const float MinThresholdValue, const float MaxThresholdValue) const;
+	void RunLineOfSight(FEnvQueryInstance &QueryInstance, const AHexGrid &Grid, const TArray<int32> &ContextTiles, const bool bWantsVisible) const;
+
+	/* Tile index of the item */
+	static int32 GetItemTile(const FEnvQueryInstance &QueryInstance, const int32 ItemIndex);
+};
@@ -46,8 +46,53 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|PathFollowingComponent")
 	AGraphAStarNavMesh *GraphAStarNavMesh;
 
+	/**
+	 * If true the component doesn't tick, the path is followed by the UHGCrowdFollowingSubsystem
+	 * together with all the other crowd agents. Use it when you have hundreds of agents.
+	 * Block detection and the other per-tick features of the component are not used in this mode.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|PathFollowingComponent")
+	bool bUseCrowdFollowing{};
+
+	/**
+	 * If true the pawn of our controller is added to the occupancy grid of the GraphAStarNavMesh,
+	 * so the other agents can pay a congestion cost to walk through our tile.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|PathFollowingComponent")
+	bool bRegisterAsOccupant{ true };
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Our paths keep only their tiles, we decode the points before following one */
+	virtual FAIRequestID RequestMove(const FAIMoveRequest &RequestData, FNavPathSharedPtr InPath) override;
+
+	/**
+	 * Pawn to add to the occupancy grid, the previous one is removed. AHGAIController calls it on possess
+	 * and with nullptr on unpossess, the pawn is registered as soon as the navmesh is known.
+	 */
+	void SetOccupant(APawn *NewOccupant);
+
 protected:
 
+	virtual void OnNavigationInitDone() override;
+
 	/** follow current path segment */
 	virtual void FollowPathSegment(float DeltaTime) override;
+
+private:
+
+	/* The crowd system needs our path, movement component and UpdatePathSegment */
+	friend class UHGCrowdFollowingSubsystem;
+
+	/* Our index in the UHGCrowdFollowingSubsystem arrays, INDEX_NONE if we aren't a crowd agent */
+	int32 CrowdAgentIndex{ INDEX_NONE };
+
+	/* Register Occupant if we have a navmesh and it isn't registered yet */
+	void RegisterOccupant();
+
+	TWeakObjectPtr<APawn> Occupant;
+
+	/* What we registered and where, to unregister the same object */
+	TWeakObjectPtr<AActor> RegisteredOccupant;
+	TWeakObjectPtr<AGraphAStarNavMesh> RegisteredNavMesh;
 };
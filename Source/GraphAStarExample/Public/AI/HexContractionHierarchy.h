@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIModule/Public/GraphAStar.h"
+
+class AHexGrid;
+struct FGridPathFilter;
+
+/**
+ * Contraction hierarchy of the grid for one cost model, for static levels where the same grid answers many queries.
+ *
+ * The preprocessing "contracts" the tiles one at a time (least important first): a contracted tile is removed from the
+ * graph and its neighbours get shortcut edges where the only cheapest path went through it. Every tile gets a rank
+ * (the contraction order) and a query is a bidirectional Dijkstra that only goes up in rank, which settles
+ * a few tens of nodes even on the biggest grids. Shortcuts remember the tile they skip, so the path is unpacked
+ * to the full tile sequence and has the same cost of a full search.
+ *
+ * The data is valid only for the grid version it was built on, AGraphAStarNavMesh falls back to the regular
+ * search as soon as a tile changes. A built hierarchy is immutable: FindOrBuildShared gives the grids of every world
+ * with the same map and the same costs a single copy.
+ */
+struct FHexContractionHierarchy
+{
+	/* Edge of the search graph, Middle is the contracted tile of a shortcut (INDEX_NONE for grid edges) */
+	struct FEdge
+	{
+		int32 Target{ INDEX_NONE };
+		int32 Middle{ INDEX_NONE };
+		float Cost{ 0.f };
+
+		friend FArchive &operator<<(FArchive &Ar, FEdge &Edge)
+		{
+			return Ar << Edge.Target << Edge.Middle << Edge.Cost;
+		}
+	};
+
+	/* Preprocess the grid with the given cost model */
+	void Build(const AHexGrid &Grid, const FGridPathFilter &Filter);
+
+	void Reset();
+
+	/* True if it was built (or loaded) for a grid with at least a tile */
+	bool IsBuilt() const { return Ranks.Num() > 0; }
+
+	/**
+	 * Hierarchy of the cost model on the grid, built only if no grid of the process with the same shared data
+	 * (see AHexGrid::GetSharedData) has one for the same costs. Kept alive by its users, freed with the last one.
+	 */
+	static TSharedRef<const FHexContractionHierarchy, ESPMode::ThreadSafe> FindOrBuildShared(const AHexGrid &Grid, const FGridPathFilter &Filter);
+
+	/* Same for a hierarchy already built (or loaded) for the grid, an existing shared copy wins over it */
+	static TSharedRef<const FHexContractionHierarchy, ESPMode::ThreadSafe> Share(const AHexGrid &Grid, FHexContractionHierarchy &&Hierarchy);
+
+	/**
+	 * Same contract of FGraphAStar::FindPath, OutPath contains every tile of the path (start excluded).
+	 * Safe to call from many threads.
+	 */
+	EGraphAStarResult FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath) const;
+
+	/* Sanity check of loaded data, sizes and edge targets must fit a grid of NumNodes tiles */
+	bool IsConsistent(const int32 NumNodes) const;
+
+	/* CRC of the costs of the cost model, to check that saved data still matches the grid */
+	static uint32 ComputeFingerprint(const AHexGrid &Grid, const FGridPathFilter &Filter);
+
+	/* Fingerprint of the costs it was built with */
+	uint32 Fingerprint{ 0 };
+
+	friend FArchive &operator<<(FArchive &Ar, FHexContractionHierarchy &Hierarchy);
+
+private:
+
+	/* Append the tiles of the edge From -> To, shortcuts are expanded recursively */
+	void Unpack(const int32 From, const int32 To, TArray<int32> &OutPath) const;
+
+	/* Contraction order of each tile */
+	TArray<int32> Ranks;
+
+	/* Edges to higher ranked tiles (forward search), in compressed rows: the edges of tile N are [UpOffsets[N], UpOffsets[N + 1]) */
+	TArray<int32> UpOffsets;
+	TArray<FEdge> UpEdges;
+
+	/* Edges coming from higher ranked tiles (backward search), Target is the source of the edge */
+	TArray<int32> DownOffsets;
+	TArray<FEdge> DownEdges;
+
+	/* Middle tile of each edge From -> To (From << 32 | To), to unpack the shortcuts */
+	TMap<uint64, int32> Middles;
+};
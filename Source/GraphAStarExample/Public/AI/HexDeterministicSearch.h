@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIModule/Public/GraphAStar.h"
+
+class AHexGrid;
+struct FGridPathFilter;
+struct FHexJumpPointData;
+
+/**
+ * A* with fixed-point costs for lockstep simulations, every machine finds the same path from the same grid and inputs.
+ *
+ * Float paths can differ between compilers and CPUs because the costs are accumulated in floats and the ties of the
+ * open list are broken by the heap layout. Here each edge cost is read once from the filter and converted to an integer
+ * (CostScale units per cost unit, exact rounding), the sums and the heuristic are integers and the open list has a total
+ * order: F, then the deeper node (higher G), then the smaller grid index. Between two parents of the same cost the smaller
+ * index wins, so the path doesn't depend on the neighbour order either.
+ *
+ * The filter must only read the tiles and the profile: no occupancy and no cost layers, they are local state of each client.
+ * The heuristic only depends on the current tiles and portals, not on how the grid got there.
+ * The nodes are kept in a per thread pool between the queries, a generation counter tells the stale ones.
+ */
+struct FHexDeterministicSearch
+{
+	FHexDeterministicSearch(const AHexGrid &InGrid, const FGridPathFilter &InFilter, const FHexJumpPointData &InData);
+
+	/**
+	 * Same contract of FGraphAStar::FindPath, OutPath contains every tile of the path (start excluded).
+	 * If the goal can't be reached OutPath goes to the closest tile (lowest heuristic, then lowest cost, then lowest index).
+	 */
+	EGraphAStarResult FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath);
+
+	/* Fixed-point cost of the last path found, divide by CostScale for cost units */
+	int64 GetPathCost() const { return PathCost; }
+
+	/* Fixed-point units in a cost unit, a power of two so the conversion of a float cost is exact before the rounding */
+	static constexpr int64 CostScale{ 1024 };
+
+	/* Round a cost to fixed-point, the same bits give the same integer on every platform */
+	static int64 ToFixed(const float Cost);
+
+private:
+
+	struct FOpenEntry
+	{
+		int64 F;
+		int64 G;
+		int32 NodeRef;
+
+		/* A total order, equal entries can only be the same node pushed twice with the same cost */
+		struct FCheapestFirst
+		{
+			bool operator()(const FOpenEntry &A, const FOpenEntry &B) const
+			{
+				if (A.F != B.F)
+				{
+					return A.F < B.F;
+				}
+				if (A.G != B.G)
+				{
+					return A.G > B.G;
+				}
+				return A.NodeRef < B.NodeRef;
+			}
+		};
+	};
+
+	/* Best cost and parent of a tile */
+	struct FSearchNode
+	{
+		int64 G{ MAX_int64 };
+		int32 ParentRef{ INDEX_NONE };
+		/* Query that last wrote the node, any other value means a fresh node */
+		uint32 Generation{ 0 };
+		bool bClosed{ false };
+	};
+
+	/* Nodes of every tile, reused by the queries of a thread */
+	struct FNodePool
+	{
+		TArray<FSearchNode> Nodes;
+		uint32 Generation{ 0 };
+	};
+
+	/* Pool of the calling thread */
+	static FNodePool &GetNodePool();
+
+	/* Node of the current query, a stale one is reset first */
+	FSearchNode &GetNode(const int32 NodeRef);
+
+	int64 GetHeuristic(const int32 NodeRef) const;
+
+	int64 GetEdgeCost(const int32 From, const int32 To) const;
+
+	const AHexGrid &Grid;
+	const FGridPathFilter &Filter;
+
+	/* Cheapest tile and what the cheapest portal step adds to it in fixed-point, the pieces of the heuristic */
+	int64 MinTileCost;
+	int64 MinPortalCost;
+
+	int32 GoalRef{ INDEX_NONE };
+
+	/* Distance from the goal to the closest portal exit, MAX_int32 without portals */
+	int32 GoalExitDistance{ MAX_int32 };
+
+	int64 PathCost{ 0 };
+
+	/* Pool of the thread running the query, set by FindPath */
+	FNodePool *Pool{ nullptr };
+	TArray<FOpenEntry> OpenList;
+};
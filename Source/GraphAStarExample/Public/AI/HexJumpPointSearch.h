@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIModule/Public/GraphAStar.h"
+
+class AHexGrid;
+struct FGridPathFilter;
+
+/**
+ * Per cost model data needed by the jump point search, built by AGraphAStarNavMesh with the filter profiles.
+ */
+struct FHexJumpPointData
+{
+	/**
+	 * One bit for each tile index, set if the tile and its traversable neighbours have the same cost
+	 * and no portal leaves the tile. Blocked neighbours and the border of the grid don't matter here,
+	 * the scans look for the forced neighbours they cause.
+	 * The search can skip these tiles, everything else is expanded normally.
+	 */
+	TBitArray<> UniformTiles;
+
+	/* Cheapest traversal cost of the grid, used to scale the hex distance heuristic. Exact, Build and Update give the same value */
+	float MinTileCost{ 1.f };
+
+	/* Recompute the data of every tile */
+	void Build(const AHexGrid &Grid, const FGridPathFilter &Filter);
+
+	/* Recompute the data of the given tiles and their neighbours */
+	void Update(const AHexGrid &Grid, const FGridPathFilter &Filter, const TArray<int32> &DirtyTiles);
+
+	/**
+	 * Heuristic of the searches on hex grids, it never overestimates: the hex distance to the goal times MinTileCost,
+	 * or the cheapest trip through a portal if it's shorter. A portal step costs MinTileCost + MinPortalCost.
+	 * GoalExitDistance is AHexGrid::GetDistanceFromPortalExit of the goal, computed once per query.
+	 * The int64 version takes the fixed-point costs of FHexDeterministicSearch.
+	 */
+	static float GetHeuristic(const AHexGrid &Grid, const int32 NodeRef, const int32 GoalRef, const int32 GoalExitDistance, const float MinTileCost, const float MinPortalCost);
+	static int64 GetHeuristic(const AHexGrid &Grid, const int32 NodeRef, const int32 GoalRef, const int32 GoalExitDistance, const int64 MinTileCost, const int64 MinPortalCost);
+
+private:
+
+	bool IsUniform(const AHexGrid &Grid, const FGridPathFilter &Filter, const int32 NodeRef) const;
+
+	/* Cost of entering a tile, the max float if it can't be traversed */
+	static float GetEntryCost(const FGridPathFilter &Filter, const int32 NodeRef);
+
+	/* Scan every tile for MinTileCost and MinCostTiles */
+	void RebuildMinTileCost(const AHexGrid &Grid, const FGridPathFilter &Filter);
+
+	/* Tiles that cost MinTileCost, when the last one is raised Update scans the grid for the new minimum */
+	TBitArray<> MinCostTiles;
+	int32 NumMinCostTiles{ 0 };
+};
+
+/**
+ * Jump Point Search adapted to hexagonal grids, a drop-in replacement of FGraphAStar::FindPath with the same results cost.
+ *
+ * In a region of uniform cost any shortest path can be reordered as k steps in a direction D followed by m steps in the
+ * next direction D+1 (the six FHDirections), so from a tile we only "scan" these canonical paths instead of pushing every
+ * tile in the open list: a primary scan along D that, at each tile, starts a secondary scan along D+1.
+ * A scan stops on the jump points and they are expanded in all the six directions:
+ * - the goal;
+ * - tiles that aren't uniform (cost changes), so at cost boundaries we fall back to the regular expansion;
+ * - tiles with a forced neighbour: a side tile of the previous step is blocked but the same side of this tile isn't,
+ *   so the only cheapest way to that neighbour goes through here.
+ * A scan that runs into an obstacle or the border of the grid just ends, the tiles behind it are reached from the jump points.
+ * Portal entrances are never uniform, so they are always jump points and their portals are expanded like a seventh direction.
+ *
+ * The nodes are kept in a per thread pool between the queries, a generation counter tells the stale ones.
+ */
+struct FHexJumpPointSearch
+{
+	FHexJumpPointSearch(const AHexGrid &InGrid, const FGridPathFilter &InFilter, const FHexJumpPointData &InData)
+		: Grid(InGrid), Filter(InFilter), Data(InData) {}
+
+	/**
+	 * Same contract of FGraphAStar::FindPath, OutPath contains every tile of the path (start excluded).
+	 */
+	EGraphAStarResult FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath);
+
+private:
+
+	/* How a node must be expanded */
+	enum class ENodeKind : uint8
+	{
+		/* Start, goal or tile at a boundary: expand in all the directions */
+		Full,
+		/* Tile on a primary scan (one for each direction), continue the primary and secondary scans */
+		Primary
+	};
+
+	/* Search node, there is one for each tile and kind */
+	struct FSearchNode
+	{
+		int32 NodeRef{ INDEX_NONE };
+		int32 ParentId{ INDEX_NONE };
+		float G{ TNumericLimits<float>::Max() };
+		/* Query that last wrote the node, any other value means a fresh node */
+		uint32 Generation{ 0 };
+		bool bClosed{ false };
+		/* Reached from the parent through a portal, not with a straight line */
+		bool bViaPortal{ false };
+	};
+
+	/* Nodes of every tile and kind, reused by the queries of a thread */
+	struct FNodePool
+	{
+		TArray<FSearchNode> Nodes;
+		uint32 Generation{ 0 };
+	};
+
+	struct FOpenEntry
+	{
+		int32 NodeId;
+		float G;
+		float F;
+
+		struct FCheapestFirst
+		{
+			bool operator()(const FOpenEntry &A, const FOpenEntry &B) const
+			{
+				// On equal F prefer the deepest node, it's closer to the goal
+				return A.F < B.F || (A.F == B.F && A.G > B.G);
+			}
+		};
+	};
+
+	/* Full + one Primary for each direction */
+	static constexpr int32 KindsPerTile{ 7 };
+
+	int32 GetNodeId(const int32 NodeRef, const ENodeKind Kind, const int32 Dir) const;
+
+	/* Pool of the calling thread */
+	static FNodePool &GetNodePool();
+
+	/* Node of the current query, a stale one is reset first */
+	FSearchNode &GetNode(const int32 NodeId);
+
+	float GetHeuristic(const int32 NodeRef) const;
+
+	/* Push (or improve) a node in the open list, false if it already had a better cost */
+	bool AddNode(const int32 NodeRef, const ENodeKind Kind, const int32 Dir, const float G, const int32 ParentId, const bool bViaPortal = false);
+
+	/* Push the destinations of the portals leaving a jump point */
+	void ExpandPortals(const int32 NodeId);
+
+	/* NodeRef, reached from PrevRef with a step along Dir, is a jump point */
+	bool IsJumpPoint(const int32 PrevRef, const int32 NodeRef, const int32 Dir) const;
+
+	/* Scan along Dir until a jump point, only straight steps. False if the scan ends on an obstacle or the border */
+	bool ScanSecondary(int32 NodeRef, const int32 Dir, int32 &OutJumpRef, float &OutCost) const;
+
+	/* Scan along Dir starting a secondary scan along Dir + 1 at each step, pushes the jump points found */
+	void ScanPrimary(const int32 NodeId, const int32 Dir);
+
+	/* Neighbour in direction Dir if it exists and it can be traversed, INDEX_NONE otherwise */
+	int32 Step(const int32 NodeRef, const int32 Dir) const;
+
+	/* Rebuild the whole tile sequence from the jump points */
+	void BuildPath(int32 NodeId, TArray<int32> &OutPath) const;
+
+	const AHexGrid &Grid;
+	const FGridPathFilter &Filter;
+	const FHexJumpPointData &Data;
+
+	int32 GoalRef{ INDEX_NONE };
+
+	/* Distance from the goal to the closest portal exit, MAX_int32 without portals */
+	int32 GoalExitDistance{ MAX_int32 };
+
+	/* Pool of the thread running the query, set by FindPath */
+	FNodePool *Pool{ nullptr };
+	TArray<FOpenEntry> OpenList;
+};
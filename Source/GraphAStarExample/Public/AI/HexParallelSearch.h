@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIModule/Public/GraphAStar.h"
+
+class AHexGrid;
+struct FGridPathFilter;
+struct FHexJumpPointData;
+
+/**
+ * Hash distributed A* (HDA*) for a single long query, the search runs on NumWorkers tasks of the task graph.
+ *
+ * Every tile is owned by one worker (a hash of its index) and only the owner keeps its cost and parent, so the workers
+ * never write the same memory. The search goes in rounds: each worker expands a batch of the best nodes of its own open list
+ * and sends the neighbours to their owners, then each worker receives its messages and updates its open list.
+ * Workers expand nodes out of the global best-first order, so a tile can be improved (and expanded) again, and the search stops
+ * only when no open node can beat the cost of the goal: the path has the same cost of the serial search.
+ *
+ * The rounds have a synchronization cost, it pays off only on long queries over big grids, shorter ones must use FGraphAStar.
+ * The nodes are kept in a pool of the thread that runs the query, a generation counter tells the stale ones.
+ */
+struct FHexParallelSearch
+{
+	FHexParallelSearch(const AHexGrid &InGrid, const FGridPathFilter &InFilter, const FHexJumpPointData &InData, const int32 InNumWorkers);
+
+	/**
+	 * Same contract of FGraphAStar::FindPath, OutPath contains every tile of the path (start excluded).
+	 * It doesn't build partial paths: if the goal can't be reached it returns GoalUnreachable with an empty path.
+	 */
+	EGraphAStarResult FindPath(const int32 StartNodeRef, const int32 EndNodeRef, TArray<int32> &OutPath);
+
+	/* Nodes expanded by each worker in a round */
+	static constexpr int32 BatchSize{ 64 };
+
+private:
+
+	struct FOpenEntry
+	{
+		int32 NodeRef;
+		float G;
+		float F;
+
+		struct FCheapestFirst
+		{
+			bool operator()(const FOpenEntry &A, const FOpenEntry &B) const
+			{
+				return A.F < B.F || (A.F == B.F && A.G > B.G);
+			}
+		};
+	};
+
+	/* Best cost and parent of a tile, written only by the owner of the tile */
+	struct FSearchNode
+	{
+		float G{ TNumericLimits<float>::Max() };
+		int32 ParentRef{ INDEX_NONE };
+		/* Query that last wrote the node, any other value means a fresh node */
+		uint32 Generation{ 0 };
+	};
+
+	/* Nodes of every tile, reused by the queries started on a thread */
+	struct FNodePool
+	{
+		TArray<FSearchNode> Nodes;
+		uint32 Generation{ 0 };
+	};
+
+	/* A neighbour sent to its owner */
+	struct FMessage
+	{
+		int32 NodeRef;
+		int32 ParentRef;
+		float G;
+	};
+
+	struct FWorker
+	{
+		TArray<FOpenEntry> OpenList;
+
+		/* Messages for each worker, filled in the expansion phase and read by the recipient in the receive phase */
+		TArray<TArray<FMessage>> Outboxes;
+	};
+
+	int32 GetOwner(const int32 NodeRef) const;
+
+	/* Pool of the calling thread */
+	static FNodePool &GetNodePool();
+
+	/* Node of the current query, a stale one is reset first. In the rounds only the owner of the tile calls it */
+	FSearchNode &GetNode(const int32 NodeRef);
+
+	float GetHeuristic(const int32 NodeRef) const;
+
+	/* Expansion phase of a worker, nodes that can't beat Incumbent aren't expanded */
+	void Expand(FWorker &Worker, const float Incumbent);
+
+	/* Receive phase of a worker, improved nodes go in its open list */
+	void Receive(const int32 WorkerIndex);
+
+	const AHexGrid &Grid;
+	const FGridPathFilter &Filter;
+	const FHexJumpPointData &Data;
+	const int32 NumWorkers;
+
+	int32 GoalRef{ INDEX_NONE };
+
+	/* Distance from the goal to the closest portal exit, MAX_int32 without portals */
+	int32 GoalExitDistance{ MAX_int32 };
+
+	/* Pool of the thread that started the query, set by FindPath */
+	FNodePool *Pool{ nullptr };
+
+	TArray<FWorker> Workers;
+};
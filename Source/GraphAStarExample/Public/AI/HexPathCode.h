@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "HexPathCode.generated.h"
+
+class AHexGrid;
+
+/* Run of tiles of a path on the same grid */
+struct FHexPathGridSpan
+{
+	AHexGrid *Grid{ nullptr };
+	int32 NumTiles{ 0 };
+};
+
+/* Target of a step that isn't a move to a neighbour, see FHexPathCode::PortalHop and FHexPathCode::GridHop */
+USTRUCT()
+struct GRAPHASTAREXAMPLE_API FHexPathHop
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Grid we move to, empty for a portal (it stays on the same grid) */
+	UPROPERTY()
+	TWeakObjectPtr<AHexGrid> Grid;
+
+	UPROPERTY()
+	int32 TileIndex{ INDEX_NONE };
+
+	friend bool operator==(const FHexPathHop &A, const FHexPathHop &B)
+	{
+		return A.Grid == B.Grid && A.TileIndex == B.TileIndex;
+	}
+};
+
+/**
+ * Compact form of a hex path: the start tile and a 3 bit code for each step, the FHDirections index of a move to a neighbour,
+ * PortalHop or GridHop. The few steps that aren't moves to a neighbour keep their target in Hops.
+ * A 50 tiles path is 4 + 4 + 19 bytes instead of 50 FNavPathPoint, use it to store paths or to send them to the clients
+ * (it has a NetSerialize, so it can be a replicated property or an RPC parameter).
+ * World locations are decoded only when needed, see FHexNavMeshPath::DecodePathPoints and AGraphAStarNavMesh::CreatePathFromCode.
+ */
+USTRUCT(BlueprintType)
+struct GRAPHASTAREXAMPLE_API FHexPathCode
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Bits of a step code */
+	static constexpr int32 BitsPerStep{ 3 };
+
+	/* Step through a portal of the grid, the target is the next entry of Hops */
+	static constexpr int32 PortalHop{ 6 };
+
+	/* Step through a connection to another grid, the grid and the target are the next entry of Hops */
+	static constexpr int32 GridHop{ 7 };
+
+	/* Longest path accepted by NetSerialize */
+	static constexpr int32 MaxNetSteps{ 1 << 16 };
+
+	/* Index of the first tile, INDEX_NONE for an empty code */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh|PathCode")
+	int32 StartIndex{ INDEX_NONE };
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh|PathCode")
+	int32 NumSteps{ 0 };
+
+	/* Grid of the first tile, empty means the HexGrid of the navmesh */
+	UPROPERTY()
+	TWeakObjectPtr<AHexGrid> StartGrid;
+
+	/* Filter of the query, it selects the cost model of the path when it's decoded */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|NavMesh|PathCode")
+	TSubclassOf<UNavigationQueryFilter> FilterClass;
+
+	/* Step codes, BitsPerStep bits each, the first step in the lowest bits */
+	UPROPERTY()
+	TArray<uint8> Codes;
+
+	/* One for each PortalHop and GridHop step, in the order of the steps */
+	UPROPERTY()
+	TArray<FHexPathHop> Hops;
+
+	bool IsEmpty() const { return StartIndex == INDEX_NONE; }
+
+	void Reset();
+
+	/**
+	 * Encode a path, PathIndices doesn't contain the start (like the FGraphAStar output).
+	 * Spans tell the grid of each run of PathIndices, empty if the whole path is on InStartGrid.
+	 * @return false (and an empty code) if two consecutive tiles of a grid are neither neighbours nor linked by a portal.
+	 */
+	bool Encode(AHexGrid &InStartGrid, const int32 InStartIndex, const TArray<int32> &PathIndices, const TArray<FHexPathGridSpan> &Spans);
+
+	/**
+	 * Tiles of the path (start excluded) and the grid of each run of them. InStartGrid is used when StartGrid is empty.
+	 * @return false if the code doesn't fit in the grids (missing tile, portal or grid).
+	 */
+	bool Decode(AHexGrid &InStartGrid, TArray<int32> &OutPathIndices, TArray<FHexPathGridSpan> &OutSpans) const;
+
+	/* Code of a step */
+	FORCEINLINE int32 GetStepDirection(const int32 Step) const
+	{
+		const int32 Bit{ Step * BitsPerStep };
+		const uint32 Word{ uint32(Codes[Bit >> 3]) | (Codes.IsValidIndex((Bit >> 3) + 1) ? uint32(Codes[(Bit >> 3) + 1]) << 8 : 0u) };
+		return (Word >> (Bit & 7)) & 7;
+	}
+
+	bool NetSerialize(FArchive &Ar, class UPackageMap *Map, bool &bOutSuccess);
+
+	friend bool operator==(const FHexPathCode &A, const FHexPathCode &B)
+	{
+		return A.StartIndex == B.StartIndex && A.NumSteps == B.NumSteps && A.StartGrid == B.StartGrid && A.FilterClass == B.FilterClass
+			&& A.Codes == B.Codes && A.Hops == B.Hops;
+	}
+
+private:
+
+	void SetStepDirection(const int32 Step, const int32 Dir);
+};
+
+template<>
+struct TStructOpsTypeTraits<FHexPathCode> : public TStructOpsTypeTraitsBase2<FHexPathCode>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
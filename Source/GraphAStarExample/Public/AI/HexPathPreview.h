@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIModule/Public/GraphAStar.h"
+
+class AHexGrid;
+struct FGridPathFilter;
+struct FHexCompiledFilterProfile;
+
+/**
+ * Shortest path tree from a start tile that grows on demand, for the path previews of the cursor hover.
+ *
+ * It's a Dijkstra search without a goal that is paused as soon as the requested goal is settled: the next goal is
+ * answered immediately if the tree already reached it, otherwise the search resumes from where it stopped.
+ * No tile is ever expanded twice while the start, the cost model and the grid don't change.
+ */
+struct FHexPathPreview
+{
+	/* Start a new tree, the filter must stay the same for the whole life of the tree */
+	void Reset(const AHexGrid &InGrid, const TSharedPtr<const FHexCompiledFilterProfile, ESPMode::ThreadSafe> &InProfile, const TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> &InBlendedCosts, const int32 InStartRef);
+
+	/* True if the tree was built for this start and cost model and the grid didn't change since */
+	bool IsValidFor(const AHexGrid &InGrid, const TSharedPtr<const FHexCompiledFilterProfile, ESPMode::ThreadSafe> &InProfile, const TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> &InBlendedCosts, const int32 InStartRef) const;
+
+	/**
+	 * Same contract of FGraphAStar::FindPath, OutPath contains every tile of the path (start excluded).
+	 * No partial paths: GoalUnreachable comes with an empty path.
+	 */
+	EGraphAStarResult FindPath(const FGridPathFilter &Filter, const int32 GoalRef, TArray<int32> &OutPath, float &OutCost);
+
+	int32 GetStartRef() const { return StartRef; }
+
+	/* Tiles settled so far */
+	int32 GetNumSettled() const { return NumSettled; }
+
+	/* Frame of the last FindPath, to drop the least recently used trees */
+	uint64 LastUsedFrame{ 0 };
+
+private:
+
+	struct FOpenEntry
+	{
+		int32 NodeRef;
+		float G;
+
+		struct FCheapestFirst
+		{
+			bool operator()(const FOpenEntry &A, const FOpenEntry &B) const
+			{
+				return A.G < B.G;
+			}
+		};
+	};
+
+	const AHexGrid *Grid{ nullptr };
+	TSharedPtr<const FHexCompiledFilterProfile, ESPMode::ThreadSafe> Profile;
+	TSharedPtr<const TArray<float>, ESPMode::ThreadSafe> BlendedCosts;
+	int32 StartRef{ INDEX_NONE };
+	int32 GridVersion{ INDEX_NONE };
+
+	TArray<float> Costs;
+	TArray<int32> Parents;
+	TBitArray<> Settled;
+	TArray<FOpenEntry> OpenList;
+	int32 NumSettled{ 0 };
+};
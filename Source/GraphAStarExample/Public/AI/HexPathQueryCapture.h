@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HexGrid/HGTypes.h"
+#include "AI/Navigation/NavigationTypes.h"
+
+class AHexGrid;
+class AGraphAStarNavMesh;
+class UNavigationQueryFilter;
+struct FHexGridChange;
+
+/**
+ * Binary log of the path queries received by an AGraphAStarNavMesh, to reproduce a pathfinding workload offline.
+ *
+ * The file starts with a snapshot of the navmesh: its search settings, every registered grid (layout, radius, tiles,
+ * portals and cost layers) and the connections between them. Then it contains a stream of records in the same
+ * order they happened: the tile and portal edits committed on the grids and the cost layers seen by the ticks
+ * (so the replay sees the grids each query saw) and the queries with the agent, their result and timing.
+ * Filter classes are written once and then referenced by id.
+ *
+ * Recording can be called from the async pathfinding threads.
+ */
+class GRAPHASTAREXAMPLE_API FHexPathQueryCapture
+{
+public:
+
+	/* Kind of a record in the stream */
+	enum class ERecordType : uint8
+	{
+		Query,
+		TileChange,
+		FilterClass,
+		End,
+		Portals,
+		CostLayers
+	};
+
+	/* Replay and capture must agree on this */
+	static constexpr uint32 FileMagic{ 0x43514748 };	// "HGQC"
+	static constexpr uint32 FileVersion{ 2 };
+
+	/* A captured query */
+	struct FQueryRecord
+	{
+		/* Seconds from the start of the capture */
+		double Timestamp{ 0.0 };
+
+		/* AHexGrid::GetGridVersion of the HexGrid when the query ran */
+		int32 GridVersion{ 0 };
+
+		FVector StartLocation{ FVector::ZeroVector };
+		FVector EndLocation{ FVector::ZeroVector };
+
+		/* Id of a FilterClass record, INDEX_NONE for the default cost model */
+		int32 FilterId{ INDEX_NONE };
+
+		/* The querier, the clearance uses its AgentRadius */
+		FNavAgentProperties AgentProperties;
+
+		/* ENavigationQueryResult::Type */
+		uint8 Result{ 0 };
+
+		/* Number of tiles of the path, 0 if the search failed */
+		int32 PathLength{ 0 };
+
+		/* Time spent in FindPath */
+		float DurationMs{ 0.f };
+
+		friend FArchive &operator<<(FArchive &Ar, FQueryRecord &Record);
+	};
+
+	/* A tile of the grid snapshot or of a tile change */
+	struct FTileRecord
+	{
+		int32 TileIndex{ INDEX_NONE };
+		float Cost{ 1.f };
+		bool bIsBlocking{ false };
+		uint8 TileClass{ 0 };
+
+		friend FArchive &operator<<(FArchive &Ar, FTileRecord &Record);
+	};
+
+	/* One way portal, a two way portal of the grid is two of them */
+	struct FPortalRecord
+	{
+		FHCubeCoord From;
+		FHCubeCoord To;
+		float Cost{ 0.f };
+
+		friend FArchive &operator<<(FArchive &Ar, FPortalRecord &Record);
+	};
+
+	/* Values of a cost layer, parallel to the coordinates of the grid */
+	struct FCostLayerRecord
+	{
+		FName Name;
+		TArray<float> Values;
+
+		friend FArchive &operator<<(FArchive &Ar, FCostLayerRecord &Record);
+	};
+
+	/* Grid state at the start of the capture */
+	struct FGridSnapshot
+	{
+		FHTileLayout TileLayout;
+		int32 Radius{ 0 };
+		int32 GridVersion{ 0 };
+		TArray<FHCubeCoord> Coordinates;
+		TArray<FTileRecord> Tiles;
+		TArray<FPortalRecord> Portals;
+		TArray<FCostLayerRecord> CostLayers;
+
+		friend FArchive &operator<<(FArchive &Ar, FGridSnapshot &Snapshot);
+	};
+
+	/* A FHexGridConnection, the grids are indices of FNavMeshSnapshot::Grids */
+	struct FConnectionRecord
+	{
+		int32 FromGrid{ INDEX_NONE };
+		FHCubeCoord FromTile;
+		int32 ToGrid{ INDEX_NONE };
+		FHCubeCoord ToTile;
+		float Cost{ 0.f };
+		bool bTwoWay{ true };
+
+		friend FArchive &operator<<(FArchive &Ar, FConnectionRecord &Record);
+	};
+
+	/* Navmesh state at the start of the capture */
+	struct FNavMeshSnapshot
+	{
+		/* Registered grids, the first one is the HexGrid. The other records refer to them by index */
+		TArray<FGridSnapshot> Grids;
+		TArray<FConnectionRecord> Connections;
+
+		/* Navmesh settings that change the search */
+		bool bUseJumpPointSearch{ false };
+		bool bUseParallelSearch{ false };
+		int32 ParallelSearchMinDistance{ 0 };
+		int32 ParallelSearchWorkers{ 0 };
+		bool bDeterministicSearch{ false };
+		bool bUseContractionHierarchy{ false };
+		bool bUseAgentClearance{ false };
+		float CongestionCostWeight{ 0.f };
+		TArray<FHexCostLayerWeight> DefaultCostLayerWeights;
+
+		friend FArchive &operator<<(FArchive &Ar, FNavMeshSnapshot &Snapshot);
+	};
+
+	~FHexPathQueryCapture();
+
+	/**
+	 * Open the file and write the snapshot of NavMesh and its grids.
+	 * @return nullptr if the file can't be created.
+	 */
+	static TSharedPtr<FHexPathQueryCapture, ESPMode::ThreadSafe> Start(const FString &FileName, const AGraphAStarNavMesh &NavMesh);
+
+	/* Append a query, FilterClass can be nullptr */
+	void RecordQuery(const FVector &StartLocation, const FVector &EndLocation, TSubclassOf<UNavigationQueryFilter> FilterClass,
+		const FNavAgentProperties &AgentProperties, const int32 GridVersion, const uint8 Result, const int32 PathLength, const float DurationMs);
+
+	/* Append the new state of the dirty tiles of a committed edit, and the portals of the grid if they changed */
+	void RecordTileChange(const AHexGrid &Grid, const FHexGridChange &Change);
+
+	/* Append the cost layers of the grid if they changed since the last time, game thread only */
+	void RecordCostLayers(const AHexGrid &Grid);
+
+	/* Write the end marker and close the file, called by the destructor too */
+	void Stop();
+
+	const FString &GetFileName() const { return FileName; }
+
+	/* Fill a snapshot from the current state of the navmesh */
+	static void MakeSnapshot(const AGraphAStarNavMesh &NavMesh, FNavMeshSnapshot &OutSnapshot);
+
+	static void MakeGridSnapshot(const AHexGrid &Grid, FGridSnapshot &OutSnapshot);
+
+	static void MakePortalRecords(const AHexGrid &Grid, TArray<FPortalRecord> &OutPortals);
+
+	static void MakeCostLayerRecords(const AHexGrid &Grid, TArray<FCostLayerRecord> &OutCostLayers);
+
+private:
+
+	FHexPathQueryCapture() {}
+
+	FString FileName;
+	TUniquePtr<FArchive> Writer;
+	double StartTime{ 0.0 };
+
+	/* Filter classes already written, the index is the id */
+	TArray<TSubclassOf<UNavigationQueryFilter>> FilterClasses;
+
+	/* Grids of the snapshot, the index is the id. Only compared, never dereferenced */
+	TArray<const AHexGrid *> Grids;
+
+	/* AHexGrid::GetCostLayersVersion last written for each grid */
+	TArray<int32> CostLayersVersions;
+
+	FCriticalSection WriterLock;
+};
+
+/**
+ * Replays a capture against the current build: the navmesh and its grids are restored from the snapshot, the changes
+ * are applied in order and each query runs again through AGraphAStarNavMesh::FindPath with the captured agent.
+ * The report is a CSV with one row for each query (captured and replayed result, path length and time).
+ */
+class GRAPHASTAREXAMPLE_API FHexPathQueryReplay
+{
+public:
+
+	struct FSummary
+	{
+		int32 NumQueries{ 0 };
+		int32 NumTileChanges{ 0 };
+
+		/* Queries with a different result or path length */
+		int32 NumMismatches{ 0 };
+
+		double CapturedTotalMs{ 0.0 };
+		double ReplayedTotalMs{ 0.0 };
+	};
+
+	/**
+	 * Run the capture on the given grid and navmesh, they are reset to the snapshot first.
+	 * Grid becomes the HexGrid, the other grids of the snapshot are spawned in the world of NavMesh.
+	 * @return false if the capture can't be read.
+	 */
+	static bool Run(const FString &CaptureFileName, const FString &ReportFileName, AHexGrid &Grid, AGraphAStarNavMesh &NavMesh, FSummary &OutSummary);
+};
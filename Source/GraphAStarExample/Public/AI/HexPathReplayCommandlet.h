@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "HexPathReplayCommandlet.generated.h"
+
+/**
+ * Headless replay of a path query capture (see AGraphAStarNavMesh::StartPathQueryCapture).
+ *
+ * UE4Editor-Cmd.exe GraphAStarExample.uproject -run=HexPathReplay -Capture=<file> [-Report=<file.csv>] [-NavMeshClass=<class path>]
+ *
+ * NavMeshClass is the navmesh Blueprint used in the level, it brings the filter profiles. The summary goes to the log,
+ * the per query timing and result differences to the CSV report (default: the capture file name + .csv).
+ * Returns 0 if every query has the captured result, 1 otherwise.
+ */
+UCLASS()
+class GRAPHASTAREXAMPLE_API UHexPathReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UHexPathReplayCommandlet();
+
+	virtual int32 Main(const FString &Params) override;
+};
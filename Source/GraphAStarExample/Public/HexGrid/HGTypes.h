@@ -131,6 +131,84 @@ struct FHCubeCoord
 	}
 };
 
+/**
+ * Axial coordinate packed in 4 bytes, used by the lookups of the grid and by the pathfinding hot loops.
+ * The S component isn't stored (S = -Q - R) so it can't be invalid and we don't need the FHCubeCoord check.
+ * Not a USTRUCT, at the Blueprint boundary we keep using FHCubeCoord and convert with the functions below.
+ */
+struct FHPackedCoord
+{
+	FHPackedCoord() {}
+
+	/* Components outside of the int16 range are clamped, use CanPack first if the input can be anything */
+	FHPackedCoord(int32 q, int32 r) : Q(ClampComponent(q)), R(ClampComponent(r)) {}
+
+	explicit FHPackedCoord(const FHCubeCoord &H) : FHPackedCoord(H.QRS.X, H.QRS.Y) {}
+
+	int16 Q{ 0 };
+	int16 R{ 0 };
+
+	FORCEINLINE int32 S() const { return -int32(Q) - int32(R); }
+
+	FORCEINLINE FHCubeCoord ToCube() const { return FHCubeCoord{ FIntVector(Q, R, S()) }; }
+
+	/* True if the coordinate fits in 4 bytes without clamping */
+	static FORCEINLINE bool CanPack(int32 q, int32 r)
+	{
+		return q >= MIN_int16 && q <= MAX_int16 && r >= MIN_int16 && r <= MAX_int16;
+	}
+
+	static FORCEINLINE bool CanPack(const FHCubeCoord &H) { return CanPack(H.QRS.X, H.QRS.Y); }
+
+	/* Same order of FHDirections */
+	static FORCEINLINE FHPackedCoord Direction(int32 Dir)
+	{
+		static const int8 Offsets[6][2]{ { 0, 1 }, { 1, 0 }, { 1, -1 }, { 0, -1 }, { -1, 0 }, { -1, 1 } };
+		return Make(Offsets[Dir][0], Offsets[Dir][1]);
+	}
+
+	/* Distance in tiles */
+	static FORCEINLINE int32 Distance(const FHPackedCoord &A, const FHPackedCoord &B)
+	{
+		const int32 DQ{ int32(A.Q) - B.Q };
+		const int32 DR{ int32(A.R) - B.R };
+		return (FMath::Abs(DQ) + FMath::Abs(DR) + FMath::Abs(DQ + DR)) / 2;
+	}
+
+	/* A grid is at most a few tiles away from the int16 limits, the hot loops step without the clamp */
+	friend FHPackedCoord operator+(const FHPackedCoord &lhs, const FHPackedCoord &rhs)
+	{
+		return Make(lhs.Q + rhs.Q, lhs.R + rhs.R);
+	}
+
+	friend bool operator==(const FHPackedCoord &lhs, const FHPackedCoord &rhs)
+	{
+		return lhs.Q == rhs.Q && lhs.R == rhs.R;
+	}
+
+	friend bool operator!=(const FHPackedCoord &lhs, const FHPackedCoord &rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+private:
+
+	static FORCEINLINE int16 ClampComponent(int32 Value)
+	{
+		ensureMsgf(Value >= MIN_int16 && Value <= MAX_int16, TEXT("FHPackedCoord: %d is out of the packed range, clamped"), Value);
+		return int16(FMath::Clamp<int32>(Value, MIN_int16, MAX_int16));
+	}
+
+	static FORCEINLINE FHPackedCoord Make(int32 q, int32 r)
+	{
+		FHPackedCoord Result;
+		Result.Q = int16(q);
+		Result.R = int16(r);
+		return Result;
+	}
+};
+static_assert(sizeof(FHPackedCoord) == 4, "FHPackedCoord must stay 4 bytes");
+
 /**
  * @see https://www.redblobgames.com/grids/hexagons/implementation.html#fractionalhex
  */
@@ -201,6 +279,22 @@ struct FHDiagonals
 	TArray<FHCubeCoord> Diagonals;
 };
 
+/**
+ * Weight of a cost layer in a blend, the blended cost of a tile is its cost plus the weighted sum of its layer values.
+ */
+USTRUCT(BlueprintType)
+struct FHexCostLayerWeight
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Name given to AHexGrid::AddCostLayer */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|HGTypes|CostLayers")
+	FName Layer;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|HGTypes|CostLayers")
+	float Weight{ 1.f };
+};
+
 /**
  * @see https://www.redblobgames.com/grids/hexagons/implementation.html#layout
  */
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HGTypes.h"
+
+class AHexGrid;
+struct FHexGridChange;
+
+/**
+ * Tiles visible from a tile within a radius, computed with shadowcasting on the blocking flags of the grid.
+ *
+ * The rings around the center are visited in order, each tile of ring N takes 1 / 6N of the full turn.
+ * A blocking tile (or a coordinate outside of the grid) casts its angular interval as a shadow on the rings behind it,
+ * a tile is visible if its center isn't inside a shadow: walls are visible, the tiles behind them aren't.
+ * Every tile of the range is visited once and the search stops as soon as the shadows cover the whole turn.
+ * @see https://www.redblobgames.com/grids/hexagons/#field-of-view
+ *
+ * The result is a bit for each axial offset of the range, so a lookup is O(1) and the bits are reused when
+ * the same object is computed again with the same radius.
+ */
+struct GRAPHASTAREXAMPLE_API FHexFieldOfView
+{
+	/* Compute the tiles visible from InCenterIndex, an invalid index gives an empty field */
+	void Compute(const AHexGrid &Grid, const int32 InCenterIndex, const int32 InRadius);
+
+	/* Forget the result, nothing is visible */
+	void Reset();
+
+	bool IsVisible(const FHPackedCoord &Coord) const;
+
+	/* Same for a tile index */
+	bool IsVisible(const AHexGrid &Grid, const int32 TileIndex) const;
+
+	/* Indices of every visible tile */
+	void GetVisibleTiles(const AHexGrid &Grid, TArray<int32> &OutIndices) const;
+
+	/* Tile index of the center, INDEX_NONE if nothing was computed */
+	int32 GetCenterIndex() const { return CenterIndex; }
+
+	int32 GetRadius() const { return Radius; }
+
+private:
+
+	FORCEINLINE int32 GetBitIndex(const int32 DQ, const int32 DR) const { return (DQ + Radius) * (2 * Radius + 1) + (DR + Radius); }
+
+	int32 CenterIndex{ INDEX_NONE };
+	FHPackedCoord Center;
+	int32 Radius{ 0 };
+
+	/* A bit for each axial offset (DQ, DR) in [-Radius, Radius], the corners outside of the range are never set */
+	TBitArray<> VisibleBits;
+};
+
+/**
+ * Fields of view of many observers (AI perception, fog of war...), kept on the grid they were computed on.
+ *
+ * A field is computed again only when its observer moves, changes radius or when a tile within its radius
+ * changes blocking flag: cost edits, portals and edits far away keep every cached field.
+ * Update computes the stale fields on the task graph with ParallelFor, each field only reads the grid.
+ * Game thread only, like the tile edits it listens to.
+ */
+class GRAPHASTAREXAMPLE_API FHexVisibilityCache
+{
+public:
+
+	explicit FHexVisibilityCache(AHexGrid &InGrid);
+	~FHexVisibilityCache();
+
+	FHexVisibilityCache(const FHexVisibilityCache &) = delete;
+	FHexVisibilityCache &operator=(const FHexVisibilityCache &) = delete;
+
+	/* New observer without a tile, its id stays valid until RemoveObserver */
+	int32 AddObserver();
+
+	void RemoveObserver(const int32 ObserverId);
+
+	/* Move an observer, its field is computed again at the next Update only if the tile or the radius changed */
+	void SetObserver(const int32 ObserverId, const int32 TileIndex, const int32 Radius);
+
+	/* Compute the stale fields, in parallel if there are more than one */
+	void Update();
+
+	/* Field of an observer as of the last Update, nullptr for an invalid id */
+	const FHexFieldOfView *GetFieldOfView(const int32 ObserverId) const;
+
+	/* Is the tile visible by the observer (as of the last Update) */
+	bool IsTileVisible(const int32 ObserverId, const int32 TileIndex) const;
+
+	/* Fields computed by the last Update */
+	int32 GetNumLastUpdated() const { return NumLastUpdated; }
+
+private:
+
+	struct FObserver
+	{
+		int32 TileIndex{ INDEX_NONE };
+		int32 Radius{ 0 };
+		bool bInUse{ false };
+		bool bStale{ false };
+		FHexFieldOfView FieldOfView;
+	};
+
+	void OnTilesChanged(const FHexGridChange &Change);
+
+	TWeakObjectPtr<AHexGrid> Grid;
+	FDelegateHandle TilesChangedHandle;
+
+	TArray<FObserver> Observers;
+	TArray<int32> FreeObserverIds;
+
+	/* Number of tiles at the last Update, a recreated grid makes every field stale */
+	int32 NumGridTiles{ 0 };
+
+	int32 NumLastUpdated{ 0 };
+
+	/* Scratch array of Update */
+	TArray<int32> StaleObservers;
+};
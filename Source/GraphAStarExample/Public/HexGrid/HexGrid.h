@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "HGTypes.h"
+#include "HexGridSharedData.h"
 #include "HexGrid.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogGraphAStarExample_HexGrid, Log, All);
@@ -39,6 +40,13 @@ struct FHexTile
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|HexGrid")
 	bool bIsBlocking{};
 
+	/**
+	 * Gameplay class of the tile (grass, water, rubble...), 0 is the default class.
+	 * AGraphAStarNavMesh filter profiles use it to give each agent type a different cost/blocking rule.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|HexGrid")
+	uint8 TileClass{ 0 };
+
 
 	friend bool operator==(const FHexTile &A, const FHexTile &B)
 	{
@@ -53,6 +61,90 @@ struct FHexTile
 };
 
 
+/* A run of contiguous dirty tile indices, Last is included. */
+USTRUCT(BlueprintType)
+struct FHexTileRange
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	int32 First{ INDEX_NONE };
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	int32 Last{ INDEX_NONE };
+};
+
+/**
+ * What changed in a committed tile edit batch, listeners use it to patch only the tiles that changed.
+ */
+USTRUCT(BlueprintType)
+struct FHexGridChange
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Grid version after the commit */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	int32 GridVersion{ 0 };
+
+	/* Sorted, unique indices of the modified tiles */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	TArray<int32> DirtyTiles;
+
+	/* Same tiles of DirtyTiles merged in contiguous ranges, handy to patch parallel arrays */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	TArray<FHexTileRange> DirtyRanges;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	bool bCostChanged{ false };
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	bool bBlockingChanged{ false };
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	bool bTileClassChanged{ false };
+
+	/* A portal was added or removed, its tiles are in DirtyTiles */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid")
+	bool bPortalsChanged{ false };
+};
+
+/**
+ * One way link between two tiles that aren't neighbours (teleporter, stairs, our BP_Portal...).
+ * The pathfinder uses it like an extra neighbour of the From tile.
+ */
+USTRUCT(BlueprintType)
+struct FHexPortal
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid|Portals")
+	int32 PortalId{ INDEX_NONE };
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid|Portals")
+	FHCubeCoord From;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid|Portals")
+	FHCubeCoord To;
+
+	/* Cost of the travel, the cost of the To tile is added like for a regular step */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GraphAStarExample|HexGrid|Portals")
+	float Cost{ 0.f };
+};
+
+/* Portal as seen by the pathfinder, tile index of the destination and cost */
+struct FHexPortalEdge
+{
+	int32 Target{ INDEX_NONE };
+	float Cost{ 0.f };
+};
+
+/* Native listeners of the committed tile edits (navmesh, path caches...) */
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnHexTilesChangedNative, const FHexGridChange &);
+
+/* Blueprint listeners of the committed tile edits (renderers, UI...) */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnHexTilesChanged, const FHexGridChange &, Change);
+
+
 /* Delegate used in the CreateGrid function, executed if bound on each inner loop step. */
 DECLARE_DYNAMIC_DELEGATE_TwoParams(FCreationStepDelegate, const FHTileLayout &, TileLayout, const FHCubeCoord &, Coord);
 
@@ -76,9 +168,11 @@ public:
 
 	/**
 	 * Create a new grid and fill the CubeCoordinates array.
+	 * If a grid of another world with the same SharedDataKey and radius is already running, its tiles are taken
+	 * from the shared data and the delegate isn't executed: draw the tiles with GetTile, not in the delegate.
 	 * @param TLayout				Tile layout structure.
 	 * @param GridRadius			Radius of the grid in tiles.
-	 * @param CreationStepDelegate	This parameter is optional, if bound is executed at each step.
+	 * @param CreationStepDelegate	This parameter is optional, if bound is executed at each step to add the tiles to GridTiles.
 	 * @see https://www.redblobgames.com/grids/hexagons/implementation.html#map-shapes
 	 */	
 	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid", meta = (AutoCreateRefTerm = "CreationStepDelegate"))
@@ -130,14 +224,341 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid")
 	FHCubeCoord GetNeighbor(const FHCubeCoord &H, const FHCubeCoord &Dir);
 
-	/** Array of HexTiles, in our example we fill it in blueprint with the CreationStepDelegate. */
+	/**
+	 * Return the tile index of the provided Cube coordinate, INDEX_NONE if it isn't part of the grid.
+	 * If the grid was built by CreateGrid this is a direct O(1) lookup, otherwise we fallback to a linear search.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid")
+	int32 GetCoordIndex(const FHCubeCoord &H) const;
+
+	/** Number of tiles of the grid, the tile indices go from 0 to GetNumTiles() - 1. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid")
+	int32 GetNumTiles() const { return PackedCoordinates.Num(); }
+
+	/** Cube coordinate of a tile, computed from the packed one. A zero coordinate for an invalid index. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid")
+	FHCubeCoord GetTileCoord(int32 TileIndex) const
+	{
+		return PackedCoordinates.IsValidIndex(TileIndex) ? PackedCoordinates[TileIndex].ToCube() : FHCubeCoord{};
+	}
+
+	/**
+	 * Copy of a tile as it is now (shared data and the edits of this grid), WorldPosition is the center of the tile.
+	 * A default tile for an index without tile data.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid")
+	FHexTile GetTile(int32 TileIndex);
+
+	/** True if the tile has a cost, a blocking flag and a class: a grid built without tiles (or with fewer) has none. */
+	FORCEINLINE bool HasTileData(const int32 TileIndex) const { return TileBaseCosts.IsValidIndex(TileIndex); }
+
+	/** Number of tiles with tile data, they are the first ones: 0 to GetNumTileData() - 1. */
+	FORCEINLINE int32 GetNumTileData() const { return TileBaseCosts.Num(); }
+
+	/** Cost of a tile with tile data, the edits of this grid over the shared one. */
+	FORCEINLINE float GetTileCost(const int32 TileIndex) const
+	{
+		if (TileOverlay.Num() > 0)
+		{
+			if (const FTileState *Edited{ TileOverlay.Find(TileIndex) })
+			{
+				return Edited->Cost;
+			}
+		}
+		return TileBaseCosts[TileIndex];
+	}
+
+	/** Blocking flag of any tile of the grid, tiles without tile data never block. */
+	FORCEINLINE bool IsTileBlocking(const int32 TileIndex) const
+	{
+		if (TileOverlay.Num() > 0)
+		{
+			if (const FTileState *Edited{ TileOverlay.Find(TileIndex) })
+			{
+				return Edited->bIsBlocking;
+			}
+		}
+		return (*TileBaseBlocking)[TileIndex];
+	}
+
+	/** Gameplay class of a tile with tile data. */
+	FORCEINLINE uint8 GetTileClass(const int32 TileIndex) const
+	{
+		if (TileOverlay.Num() > 0)
+		{
+			if (const FTileState *Edited{ TileOverlay.Find(TileIndex) })
+			{
+				return Edited->TileClass;
+			}
+		}
+		return TileBaseClasses[TileIndex];
+	}
+
+	/**
+	 * Native version of GetCoordIndex for the hot loops (neighbours, heuristics...), it reads only PackedCoordinates.
+	 */
+	FORCEINLINE int32 GetPackedIndex(const FHPackedCoord &P) const
+	{
+		if (HasColumnLayout())
+		{
+			const int32 Q{ P.Q };
+			const int32 R{ P.R };
+			if (FMath::Abs(Q) > Radius)
+			{
+				return INDEX_NONE;
+			}
+
+			const int32 R1{ FMath::Max(-Radius, -Q - Radius) };
+			const int32 R2{ FMath::Min(Radius, -Q + Radius) };
+			if (R < R1 || R > R2)
+			{
+				return INDEX_NONE;
+			}
+
+			return ColumnOffsets[Q + Radius] + (R - R1);
+		}
+		return PackedCoordinates.IndexOfByKey(P);
+	}
+
+	/** Packed coordinate of a tile index. */
+	FORCEINLINE FHPackedCoord GetPackedCoord(int32 Index) const
+	{
+		return PackedCoordinates[Index];
+	}
+
+	//==== FGraphAStar TGraph ====
+	// The grid is the search graph: the six directions, then the portals leaving the tile.
+
+	typedef int32 FNodeRef;
+
+	FORCEINLINE int32 GetNeighbourCount(const FNodeRef NodeRef) const
+	{
+		return 6 + GetPortalCount(NodeRef);
+	}
+
+	FORCEINLINE bool IsValidRef(const FNodeRef NodeRef) const
+	{
+		return PackedCoordinates.IsValidIndex(NodeRef);
+	}
+
+	FORCEINLINE FNodeRef GetNeighbour(const FNodeRef NodeRef, const int32 NeiIndex) const
+	{
+		if (NeiIndex >= 6)
+		{
+			return GetPortalEdge(NodeRef, NeiIndex - 6).Target;
+		}
+
+		// Packed coordinates: a 4 bytes read per tile and no FHCubeCoord temporaries in the A* inner loop
+		return GetPackedIndex(GetPackedCoord(NodeRef) + FHPackedCoord::Direction(NeiIndex));
+	}
+	//==== END OF FGraphAStar TGraph ====
+
+	/** World space box around all the tiles of the grid. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid")
+	FBox GetGridBounds();
+
+	/**
+	 * Rebuild the shared data of the grid, CreateGrid does it for you.
+	 * Call it after you filled GridCoordinates and/or GridTiles by hand: they are moved into the shared data and emptied.
+	 * With an empty GridCoordinates the current coordinates are kept, with an empty GridTiles the grid has no tile data.
+	 * Nothing to do if both are empty (the navmesh calls it in SetHexGrid), the edits of the grid are kept.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid")
+	void RebuildPackedCoordinates();
+
+	/** True if GridCoordinates or GridTiles hold data filled by hand that RebuildPackedCoordinates didn't take yet. */
+	bool HasPendingTiles() const { return GridCoordinates.Num() > 0 || GridTiles.Num() > 0; }
+
+	/**
+	 * True if the tiles are in the CreateGrid layout: a column for each Q, each column sorted by R.
+	 * In this case the tiles of a column between two R values have consecutive indices.
+	 */
+	bool HasColumnLayout() const { return ColumnOffsets.Num() == (2 * Radius + 1); }
+
+	/**
+	 * Immutable data of this grid layout, the same instance for every grid of the process with the same coordinates
+	 * and the same tiles at build time. Invalid before CreateGrid/RebuildPackedCoordinates, the grid has no tiles.
+	 */
+	const FHexGridSharedDataPtr &GetSharedData() const { return SharedData; }
+
+	/**
+	 * Start a batch of tile edits, batches can be nested and only the outermost CommitTileEdit notifies the listeners.
+	 * Setters called outside of a batch are committed immediately.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Edit")
+	void BeginTileEdit();
+
+	/** Set the cost of a tile, the value is clamped to 1 like the FHexTile::Cost property. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Edit")
+	void SetTileCost(int32 TileIndex, float NewCost);
+
+	/** Set the blocking flag of a tile. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Edit")
+	void SetTileBlocking(int32 TileIndex, bool bNewIsBlocking);
+
+	/** Set the gameplay class of a tile. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Edit")
+	void SetTileClass(int32 TileIndex, uint8 NewTileClass);
+
+	/**
+	 * Close the current batch, if it's the outermost and something changed
+	 * bump GridVersion once and notify the listeners with the dirty tiles.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Edit")
+	void CommitTileEdit();
+
+	/**
+	 * Link two tiles that aren't neighbours, if bTwoWay also To -> From. Committed like a tile edit (both tiles are dirty).
+	 * @return id of the portal for RemovePortal, INDEX_NONE if a tile isn't part of the grid or the tiles are neighbours.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Portals")
+	int32 AddPortal(const FHCubeCoord &From, const FHCubeCoord &To, float Cost, bool bTwoWay);
+
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Portals")
+	void RemovePortal(int32 PortalId);
+
+	/** All the portals, a two way portal is here twice with the same id. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|Portals")
+	const TArray<FHexPortal> &GetPortals() const { return Portals; }
+
+	FORCEINLINE bool HasPortals() const { return PortalEdges.Num() > 0; }
+
+	/* Number of portals leaving a tile */
+	FORCEINLINE int32 GetPortalCount(const int32 TileIndex) const
+	{
+		return PortalOffsets.IsValidIndex(TileIndex + 1) ? PortalOffsets[TileIndex + 1] - PortalOffsets[TileIndex] : 0;
+	}
+
+	FORCEINLINE const FHexPortalEdge &GetPortalEdge(const int32 TileIndex, const int32 PortalIndex) const
+	{
+		return PortalEdges[PortalOffsets[TileIndex] + PortalIndex];
+	}
+
+	/* Cost of the portal From -> To, -1 if there isn't one */
+	float FindPortalCost(const int32 From, const int32 To) const;
+
+	/*
+	 * Pieces of a lower bound for the heuristics, a path through portals costs at least
+	 * (DistanceToPortalEntrance + 1 + DistanceFromPortalExit) * cheapest tile + MinPortalCost.
+	 * Both distances are MAX_int32 without portals.
+	 */
+	int32 GetDistanceToPortalEntrance(const FHPackedCoord &From) const;
+	int32 GetDistanceFromPortalExit(const FHPackedCoord &Goal) const;
+	FORCEINLINE float GetMinPortalCost() const { return MinPortalCost; }
+
+	/** Distance between the centers of two neighbour tiles. */
+	FORCEINLINE float GetTileSpacing() const { return FMath::Sqrt(3.f) * TileLayout.TileSize; }
+
+	/** Clearance stops growing here, a bigger footprint is treated like this one. */
+	static constexpr int32 MaxTileClearance{ 15 };
+
+	/**
+	 * Steps to the closest blocking tile or to the edge of the grid: 0 for a blocking tile, 1 for a tile next to one.
+	 * An agent covering the tiles within N steps of its own tile fits only on tiles with a clearance greater than N.
+	 * Kept up to date by CommitTileEdit, only around the tiles whose blocking flag changed.
+	 * Read from the shared data, the tiles changed by the edits of this grid from ClearanceOverlay.
+	 */
+	FORCEINLINE int32 GetTileClearance(const int32 TileIndex) const
+	{
+		if (ClearanceOverlay.Num() > 0)
+		{
+			if (const uint8 *Edited{ ClearanceOverlay.Find(TileIndex) })
+			{
+				return *Edited;
+			}
+		}
+		return TileClearance.IsValidIndex(TileIndex) ? TileClearance[TileIndex] : MaxTileClearance;
+	}
+
+	/** Recompute the clearance of every tile in a copy owned by this grid, CreateGrid and RebuildPackedCoordinates take it from the shared data. */
+	void RebuildClearance();
+
+	/**
+	 * Add a named per tile cost layer (influence, threat...) initialized to 0, nothing if it's already there.
+	 * Layers are meant to change every frame: they aren't tile edits, they don't invalidate paths and don't bump GridVersion.
+	 * @return index of the layer.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|CostLayers")
+	int32 AddCostLayer(FName LayerName);
+
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|CostLayers")
+	void RemoveCostLayer(FName LayerName);
+
+	/** Index of a layer, INDEX_NONE if there isn't one with this name. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|CostLayers")
+	int32 FindCostLayer(FName LayerName) const;
+
+	/** Set every value of the layer to 0. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|CostLayers")
+	void ClearCostLayer(FName LayerName);
+
+	/** Multiply every value of the layer by Factor, e.g. 0.9 each frame to forget old threats. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|CostLayers")
+	void DecayCostLayer(FName LayerName, float Factor);
+
+	/** Add Amount to the tiles within Radius steps of Center, fading linearly to 0 one step past Radius. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|CostLayers")
+	void SplatCostLayer(FName LayerName, const FHCubeCoord &Center, int32 SplatRadius, float Amount);
+
+	/** Move each value towards the average of its neighbours by Rate [0, 1], the influence spreads one step per call. */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|CostLayers")
+	void DiffuseCostLayer(FName LayerName, float Rate);
+
+	int32 GetNumCostLayers() const { return CostLayers.Num(); }
+
+	/** Name of a layer, NAME_None for an invalid index. */
+	FName GetCostLayerName(const int32 LayerIndex) const { return CostLayers.IsValidIndex(LayerIndex) ? CostLayers[LayerIndex].Name : NAME_None; }
+
+	/** Values of a layer, parallel to PackedCoordinates. Empty for an invalid index. */
+	TArrayView<const float> GetCostLayerValues(const int32 LayerIndex) const;
+
+	/** Write access for the bulk updates we don't have, remember to call MarkCostLayersChanged after. */
+	TArrayView<float> GetMutableCostLayerValues(const int32 LayerIndex);
+
+	void MarkCostLayersChanged() { ++CostLayersVersion; }
+
+	/** Incremented at each change of any layer, blends compare it to know if they are stale. */
+	int32 GetCostLayersVersion() const { return CostLayersVersion; }
+
+	/**
+	 * OutCosts = BaseCosts + max(0, sum of Weight * layer value), BaseCosts entries < 0 (blocked) are copied as they are.
+	 * Layers only add cost so the heuristics built on the tile costs stay valid. Layers that don't exist are ignored.
+	 */
+	void BlendCostLayers(const TArray<FHexCostLayerWeight> &Weights, TArrayView<const float> BaseCosts, TArray<float> &OutCosts) const;
+
+	/** Incremented once for each committed batch that changed at least one tile. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|Edit")
+	int32 GetGridVersion() const { return GridVersion; }
+
+	/** Called on commit, for C++ listeners. */
+	FOnHexTilesChangedNative OnTilesChangedNative;
+
+	/** Called on commit, for Blueprint listeners. */
+	UPROPERTY(BlueprintAssignable, Category = "GraphAStarExample|HexGrid|Edit")
+	FOnHexTilesChanged OnTilesChanged;
+
+	/**
+	 * Tiles of a grid being built, in our example we fill it in blueprint with the CreationStepDelegate, one for each coordinate.
+	 * CreateGrid and RebuildPackedCoordinates move them into the shared data and empty the array:
+	 * read the tiles with GetTile and modify them with the BeginTileEdit/CommitTileEdit functions.
+	 */
 	UPROPERTY(BlueprintReadWrite, Category = "GraphAStarExample|HexGrid")
 	TArray<FHexTile> GridTiles;
 
-	/** Array of Cube coordinates that compose the grid. */
+	/**
+	 * Cube coordinates of a grid filled by hand, RebuildPackedCoordinates moves them into PackedCoordinates and empties the array.
+	 * CreateGrid doesn't use it: read the coordinates of the grid with GetNumTiles and GetTileCoord.
+	 */
 	UPROPERTY(BlueprintReadWrite, Category = "GraphAStarExample|HexGrid")
 	TArray<FHCubeCoord> GridCoordinates{};
 
+	/**
+	 * The coordinates of the grid packed in 4 bytes, the tile index is the index in this array.
+	 * It's the only copy of the coordinates, a view of the shared data (see GetSharedData): the cube coordinates
+	 * are computed when asked, see GetTileCoord.
+	 */
+	TArrayView<const FHPackedCoord> PackedCoordinates;
+
 	/**
 	 * Layout of the tile (i know is very misleading, please read the article)
 	 * @see  https://www.redblobgames.com/grids/hexagons/implementation.html#layout
@@ -151,6 +572,15 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = "GraphAStarExample|HexGrid")
 	int32 Radius {};
 
+	/**
+	 * Name of the layout of this grid in the shared data registry (the map name for example), see GetSharedData.
+	 * Grids with the same key and the same size take the registered data without running the CreationStepDelegate,
+	 * building and comparing their own, so give the same key only to grids created with the same coordinates and tiles.
+	 * None: the grids are compared tile by tile.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "GraphAStarExample|HexGrid")
+	FName SharedDataKey;
+
 protected:
 
 	// Called when the game starts or when spawned
@@ -160,6 +590,142 @@ protected:
 private:
 
 	FHDirections HDirections{};
+
+	/**
+	 * Index of the first tile of each Q column (Q + Radius), a view of the shared data.
+	 * A column is contiguous in the array so we can compute the index of any coordinate without searching it.
+	 */
+	TArrayView<const int32> ColumnOffsets;
+
+	/** Tile data the grid was built with, views of the shared data. TileBaseBlocking has a bit for each coordinate. */
+	TArrayView<const float> TileBaseCosts;
+	TArrayView<const uint8> TileBaseClasses;
+	const TBitArray<> *TileBaseBlocking{ nullptr };
+
+	/** A tile changed by the edits of this grid. */
+	struct FTileState
+	{
+		float Cost{ 0.f };
+		bool bIsBlocking{ false };
+		uint8 TileClass{ 0 };
+	};
+
+	/** Tiles that differ from the shared data after the tile edits, tile index -> tile. */
+	TMap<int32, FTileState> TileOverlay;
+
+	/** Current state of a tile with tile data. */
+	FTileState GetTileState(const int32 TileIndex) const;
+
+	/** Write a tile in TileOverlay, a tile back to its shared state is removed from it. */
+	void SetTileState(const int32 TileIndex, const FTileState &State);
+
+	/** Keeps alive the data PackedCoordinates, ColumnOffsets, the tile data and TileClearance point to. */
+	FHexGridSharedDataPtr SharedData;
+
+	/**
+	 * Find the shared data of these coordinates and the tiles of GridTiles, or build and register it.
+	 * Every other grid with the same map skips the clearance flood and keeps no copy of the tiles and the lookups,
+	 * the ones with a SharedDataKey skip the candidate too.
+	 */
+	void AcquireSharedData(TArray<FHPackedCoord> &&Coordinates);
+
+	/** Build a candidate from the coordinates and GridTiles, then take the registered one with the same layout or register it. */
+	void BuildSharedData(TArray<FHPackedCoord> &&Coordinates);
+
+	/** Point the views to the coordinates, the lookups and the tiles of Data. */
+	void SetSharedViews(const FHexGridSharedData &Data);
+
+	/** Take registered data, the edits of the previous data are dropped. */
+	void UseSharedData(FHexGridSharedDataPtr &&Data);
+
+	/** Drop the shared data, the grid has no tiles until the next AcquireSharedData. */
+	void ReleaseSharedData();
+
+	/** Mark a tile as modified in the current batch. */
+	void MarkTileDirty(int32 TileIndex);
+
+	/** Nesting level of BeginTileEdit. */
+	int32 EditDepth{ 0 };
+
+	int32 GridVersion{ 0 };
+
+	/** Tiles modified in the current batch, one bit for each tile. */
+	TBitArray<> DirtyTileBits;
+
+	/** The change we are accumulating in the current batch. */
+	FHexGridChange PendingChange;
+
+	/** Portals registered with AddPortal. */
+	UPROPERTY()
+	TArray<FHexPortal> Portals;
+
+	int32 NextPortalId{ 0 };
+
+	/**
+	 * Portals indexed by tile index of the From tile, in compressed rows:
+	 * the portals of tile N are PortalEdges [PortalOffsets[N], PortalOffsets[N + 1]). Empty without portals.
+	 */
+	TArray<int32> PortalOffsets;
+	TArray<FHexPortalEdge> PortalEdges;
+
+	/** Entrances and exits for the heuristics. */
+	TArray<FHPackedCoord> PortalEntrances;
+	TArray<FHPackedCoord> PortalExits;
+	float MinPortalCost{ 0.f };
+
+	/** Rebuild the arrays above from Portals. */
+	void RebuildPortalIndex();
+
+	/** Dirty the tiles of a portal in the current batch. */
+	void MarkPortalDirty(const FHexPortal &Portal);
+
+	struct FCostLayer
+	{
+		FName Name;
+
+		/* Parallel to PackedCoordinates, contiguous so the bulk operations run 4 tiles at a time */
+		TArray<float> Values;
+	};
+
+	TArray<FCostLayer> CostLayers;
+
+	int32 CostLayersVersion{ 0 };
+
+	/** Scratch buffer of DiffuseCostLayer. */
+	TArray<float> DiffuseScratch;
+
+	/** Resize the layers after the grid changed, values are reset. */
+	void ResetCostLayers();
+
+	/** Clearance of each tile index, see GetTileClearance. Points to the shared BaseClearance or to LocalClearance. */
+	TArrayView<const uint8> TileClearance;
+
+	/** Clearance computed by RebuildClearance, empty while the shared one is used. */
+	TArray<uint8> LocalClearance;
+
+	/** Tiles whose clearance differs from the shared BaseClearance after the tile edits, tile index -> clearance. */
+	TMap<int32, uint8> ClearanceOverlay;
+
+	/** Write the clearance of a tile: in LocalClearance if this grid owns it, in ClearanceOverlay otherwise. */
+	void SetTileClearance(const int32 TileIndex, const int32 Clearance);
+
+	/** Patch the clearance around the dirty tiles whose blocking flag changed. */
+	void UpdateClearance(const TArray<int32> &DirtyTiles);
+
+	/**
+	 * Breadth first spread of the clearance, Buckets[N] holds the tiles set to N (stale entries are skipped).
+	 * A tile only goes down, so it works for the full rebuild and for the updates.
+	 */
+	void PropagateClearance(TArray<TArray<int32>> &Buckets);
+
+	/** A blocking tile, tiles without tile data never block. */
+	bool IsClearanceObstacle(const int32 TileIndex) const { return IsValidRef(TileIndex) && IsTileBlocking(TileIndex); }
+
+	/** A neighbour of the tile isn't part of the grid. */
+	bool IsGridBorder(const int32 TileIndex) const;
+
+	/** Clearance of a tile from itself alone: 0 if blocking, 1 on the border, MaxTileClearance otherwise. */
+	int32 GetClearanceSeed(const int32 TileIndex) const;
 };
 
 
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "HGTypes.h"
+#include "HexGridQueryLibrary.generated.h"
+
+class AHexGrid;
+
+DECLARE_CYCLE_STAT(TEXT("HexGrid Shape Query"), STAT_HexGridShapeQuery, STATGROUP_HEXGRID);
+
+/**
+ * Area queries on an AHexGrid (ring, spiral, range, range intersection, line) returning tile indices.
+ *
+ * The native functions write in a buffer provided by the caller and never allocate: they return the number of indices
+ * written, coordinates outside of the grid are skipped and the result is truncated if the buffer is too small
+ * (use the Get...Capacity functions to size it). With the CreateGrid layout ranges are written column by column
+ * as runs of consecutive indices, without any per tile lookup.
+ *
+ * The Blueprint functions do the whole query in a single call and return a new array.
+ * @see https://www.redblobgames.com/grids/hexagons/#range
+ */
+UCLASS()
+class GRAPHASTAREXAMPLE_API UHexGridQueryLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Maximum number of tiles of a ring */
+	static int32 GetRingCapacity(const int32 Radius) { return Radius > 0 ? 6 * Radius : 1; }
+
+	/* Maximum number of tiles of a range (or a spiral) */
+	static int32 GetRangeCapacity(const int32 Radius) { return Radius >= 0 ? 1 + 3 * Radius * (Radius + 1) : 0; }
+
+	/* Maximum number of tiles of a line */
+	static int32 GetLineCapacity(const FHCubeCoord &A, const FHCubeCoord &B) { return HexDistance(A, B) + 1; }
+
+	/* Distance in tiles between two Cube coordinates */
+	static int32 HexDistance(const FHCubeCoord &A, const FHCubeCoord &B);
+
+	/** Tiles at exactly Radius steps from Center. @see https://www.redblobgames.com/grids/hexagons/#rings */
+	static int32 Ring(const AHexGrid &Grid, const FHCubeCoord &Center, const int32 Radius, TArrayView<int32> OutIndices);
+
+	/** Center first, then the rings from 1 to Radius. @see https://www.redblobgames.com/grids/hexagons/#rings-spiral */
+	static int32 Spiral(const AHexGrid &Grid, const FHCubeCoord &Center, const int32 Radius, TArrayView<int32> OutIndices);
+
+	/** Tiles at Radius steps or less from Center, in tile index order. */
+	static int32 Range(const AHexGrid &Grid, const FHCubeCoord &Center, const int32 Radius, TArrayView<int32> OutIndices);
+
+	/** Tiles in both ranges. @see https://www.redblobgames.com/grids/hexagons/#range-intersection */
+	static int32 RangeIntersection(const AHexGrid &Grid, const FHCubeCoord &CenterA, const int32 RadiusA,
+		const FHCubeCoord &CenterB, const int32 RadiusB, TArrayView<int32> OutIndices);
+
+	/** Tiles crossed by the line from A to B, both included. @see https://www.redblobgames.com/grids/hexagons/#line-drawing */
+	static int32 Line(const AHexGrid &Grid, const FHCubeCoord &A, const FHCubeCoord &B, TArrayView<int32> OutIndices);
+
+
+	/* Blueprint versions, one call for the whole shape */
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|Queries")
+	static TArray<int32> GetRing(const AHexGrid *Grid, const FHCubeCoord &Center, int32 Radius);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|Queries")
+	static TArray<int32> GetSpiral(const AHexGrid *Grid, const FHCubeCoord &Center, int32 Radius);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|Queries")
+	static TArray<int32> GetRange(const AHexGrid *Grid, const FHCubeCoord &Center, int32 Radius);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|Queries")
+	static TArray<int32> GetRangeIntersection(const AHexGrid *Grid, const FHCubeCoord &CenterA, int32 RadiusA, const FHCubeCoord &CenterB, int32 RadiusB);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "GraphAStarExample|HexGrid|Queries")
+	static TArray<int32> GetLine(const AHexGrid *Grid, const FHCubeCoord &A, const FHCubeCoord &B);
+
+	/**
+	 * Ranges around many centers in one call (area of effect of a whole squad...).
+	 * OutIndices contains all the ranges one after the other, the range of Centers[i] starts at OutOffsets[i]
+	 * and ends at OutOffsets[i + 1] (OutOffsets has one more element than Centers).
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GraphAStarExample|HexGrid|Queries")
+	static void GetRangesBatch(const AHexGrid *Grid, const TArray<FHCubeCoord> &Centers, int32 Radius, TArray<int32> &OutIndices, TArray<int32> &OutOffsets);
+
+private:
+
+	/* Write the tiles of column Q with R in [RMin, RMax], returns the new number of written indices */
+	static int32 WriteColumn(const AHexGrid &Grid, const int32 Q, int32 RMin, int32 RMax, TArrayView<int32> OutIndices, int32 NumWritten);
+};
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HGTypes.h"
+
+struct FHexGridSharedData;
+
+typedef TSharedPtr<const FHexGridSharedData, ESPMode::ThreadSafe> FHexGridSharedDataPtr;
+
+/**
+ * Static part of a grid: its coordinates, the tiles it was built with (cost, blocking flag and class),
+ * the lookups derived from them and the clearance of those blocking flags.
+ *
+ * Every AHexGrid of the process built from the same coordinates and tiles (the same map loaded in many worlds,
+ * the match instances of a dedicated server...) points to the same instance, found in a process-wide registry.
+ * A grid with a AHexGrid::SharedDataKey finds it by key without building anything, the others build a candidate
+ * and compare it. Registered data never changes, so it's read from any thread without locks, and it's freed with
+ * the last grid using it. The tiles and the clearance changed by the tile edits are kept per grid
+ * in sparse overlays on top of it.
+ */
+struct GRAPHASTAREXAMPLE_API FHexGridSharedData
+{
+	int32 Radius{ 0 };
+
+	/* The coordinates of the grid, the tile indices are indices of this array. See AHexGrid::PackedCoordinates */
+	TArray<FHPackedCoord> PackedCoordinates;
+
+	/* Index of the first tile of each Q column (Q + Radius), empty if the coordinates aren't in the CreateGrid order */
+	TArray<int32> ColumnOffsets;
+
+	/* Costs and classes of the tiles it was built with, shorter than PackedCoordinates if the grid got fewer tiles (none for a logical grid) */
+	TArray<float> BaseCosts;
+	TArray<uint8> BaseClasses;
+
+	/* Blocking flags of the tiles it was built with, one bit for each coordinate: the ones without a tile don't block */
+	TBitArray<> BaseBlocking;
+
+	/* Clearance of each tile with BaseBlocking, see AHexGrid::GetTileClearance */
+	TArray<uint8> BaseClearance;
+
+	/* CRC of Radius and coordinates, checked by the lookups by key */
+	uint32 LayoutFingerprint{ 0 };
+
+	/* CRC of Radius, coordinates and tiles, the key of the registry */
+	uint32 Fingerprint{ 0 };
+
+	/* AHexGrid::SharedDataKey of the grid that built it, None if it can be found only by layout */
+	FName Key;
+
+	/* Fill everything but BaseClearance, the grid computes it with these lookups */
+	void Init(const int32 InRadius, TArray<FHPackedCoord> &&Coordinates, TArray<float> &&Costs, TBitArray<> &&Blocking, TArray<uint8> &&Classes);
+
+	/* Same layout and same tiles, BaseClearance follows */
+	bool HasSameLayout(const FHexGridSharedData &Other) const;
+
+	/* Registered data with the same layout of Key (a Init'ed candidate), invalid if no grid of the process is using one */
+	static FHexGridSharedDataPtr Find(const FHexGridSharedData &Key);
+
+	/**
+	 * Registered data with this key, invalid if no grid of the process is using one or if its coordinates don't match.
+	 * A key registered with other coordinates is a key given to two different maps, it fires an ensure.
+	 */
+	static FHexGridSharedDataPtr FindByKey(FName InKey, const int32 InRadius, TArrayView<const FHPackedCoord> Coordinates);
+
+	/* LayoutFingerprint of these coordinates */
+	static uint32 ComputeLayoutFingerprint(const int32 InRadius, TArrayView<const FHPackedCoord> Coordinates);
+
+	/* Publish complete data, if another grid registered the same layout in the meantime that one is returned instead */
+	static FHexGridSharedDataPtr Register(const TSharedRef<FHexGridSharedData, ESPMode::ThreadSafe> &Data);
+};